@@ -1,58 +1,281 @@
 #include "Client.hpp"
+#include "../include/Events.hpp"
+#include "../include/GameView.hpp"
+#include "../include/Rules.hpp"
+
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 
 #include <algorithm>
+#include <cerrno>
 #include <chrono>
+#include <cstdlib>
 #include <cstring>
 #include <iomanip>
 #include <iostream>
 #include <sstream>
 #include <vector>
 
-Client::Client()
-    : shm(false), root(shm.root()), current_game_id(-1), in_game(false), in_setup(false),
-      pending_invite_id(-1), rng(std::random_device{}()) {
-    if (!root)
-        throw std::runtime_error("Cannot open shared memory; run server first");
+namespace {
+
+// Сколько ждать места в очереди сервера, прежде чем сдаться
+constexpr uint64_t ENQUEUE_TIMEOUT_MS = 2000;
+
+} // namespace
+
+Client::Client(const ShmOptions& opts)
+    : opts(opts), root(nullptr), shard(0), current_game_id(-1), in_game(false), in_setup(false),
+      rng(std::random_device{}()), epoll_fd(-1), notify_fd(-1), stdin_pollable(true),
+      input_closed(false), notifier_slot(nullptr), cached_slot(nullptr), cached_generation(0),
+      stopping(false), pending_invite_id(-1) {
+    try {
+        directory.reset(new ShardDirectory(false, opts));
+        if (!directory->alive())
+            directory.reset();
+    } catch (const std::exception&) {
+        // Каталога нет: сервер с одним сегментом
+    }
+    if (!directory)
+        connect_shard(0);
+
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    notify_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (epoll_fd < 0 || notify_fd < 0)
+        throw std::runtime_error("epoll/eventfd setup failed");
+
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = STDIN_FILENO;
+    // Обычный файл на stdin epoll не поддерживает: тогда читаем его напрямую
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, STDIN_FILENO, &ev) != 0)
+        stdin_pollable = false;
+
+    ev.data.fd = notify_fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, notify_fd, &ev);
 }
 
 void Client::force_check_state() {
     if (current_game_id != -1) {
         std::cout << "🔄 Проверяем состояние игры...\n";
 
-        Message m;
-        std::memset(&m, 0, sizeof(m));
-        std::strncpy(m.from, login.c_str(), LOGIN_MAX - 1);
-        m.type = MSG_GAME_STATUS;
+        GameData g;
+        if (snapshot_game(g)) {
+            std::cout << "✅ Игра существует: " << g.game_name << "\n";
+        } else {
+            std::cout << "⚠️ Игра не найдена, сбрасываем состояние\n";
+            in_game = false;
+            in_setup = false;
+            current_game_id = -1;
+        }
+    }
+}
 
-        clear_response_buffer();
+bool Client::snapshot_game(GameData& out) {
+    ClientSlot* slot = my_slot();
+    if (!slot)
+        return false;
 
-        if (enqueue_message(m)) {
-            std::string resp;
-            if (wait_for_response(resp, 2000)) {
-                if (resp.find("ERROR") != std::string::npos ||
-                    resp.find("GAME_REMOVED") != std::string::npos ||
-                    resp.find("Not in a game") != std::string::npos) {
-                    std::cout << "⚠️ Игра не найдена, сбрасываем состояние\n";
-                    in_game = false;
-                    in_setup = false;
-                    current_game_id = -1;
+    int game_id = slot->current_game_id;
+    if (game_id < 0)
+        return false;
 
-                    ClientSlot* slot = my_slot();
-                    if (slot) {
-                        slot->current_game_id = -1;
-                        slot->setup_complete = false;
-                    }
-                } else {
-                    std::cout << "✅ Игра существует: " << resp.substr(0, 50) << "...\n";
+    if (!read_game_snapshot(root->games[game_slot(game_id)], out))
+        return false;
+
+    // Слот уже занят другой игрой - снимок не наш
+    return out.used && out.generation == game_generation(game_id) &&
+           (login == out.player1 || login == out.player2);
+}
+
+void Client::list_running_games() {
+    std::cout << "\n👀 Идущие игры:\n";
+    bool any = false;
+    for (size_t i = 0; i < MAX_GAMES; ++i) {
+        GameData g;
+        if (!read_game_snapshot(root->games[i], g) || !g.used || !g.player1[0] || !g.player2[0])
+            continue;
+        any = true;
+        std::cout << "  " << make_game_handle(i, g.generation) << ": " << g.player1 << " vs "
+                  << g.player2
+                  << " (выстрелов: " << g.shot_count << ", зрителей: " << g.watchers << ")\n";
+    }
+    if (!any) {
+        std::cout << "  нет\n";
+    }
+}
+
+bool Client::input_pending() {
+    if (input_buffer.find('\n') != std::string::npos)
+        return true;
+    if (!stdin_pollable || input_closed)
+        return false;
+    pollfd p{STDIN_FILENO, POLLIN, 0};
+    return poll(&p, 1, 0) > 0;
+}
+
+void Client::spectate(int game_id) {
+    // Сервер в наблюдении не участвует: читаем слот игры под seqlock и ждём
+    // futex на его seq, сервер будит всех зрителей одним вызовом
+    GameData* slot = &root->games[game_slot(game_id)];
+    __atomic_fetch_add(&slot->watchers, 1, __ATOMIC_SEQ_CST);
+
+    std::cout << "\n" << std::string(50, '=') << "\n";
+    std::cout << "  👀 НАБЛЮДЕНИЕ ЗА ИГРОЙ " << game_id << " ('q' - выйти)\n";
+    std::cout << std::string(50, '=') << "\n";
+
+    size_t shown = 0;
+    int last_state = -1;
+    bool first = true;
+    while (true) {
+        uint32_t seen = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        GameData g;
+        if (read_game_snapshot(*slot, g)) {
+            if (first) {
+                // Пришедшему посреди партии показываем только последние выстрелы
+                shown = g.shot_count > 10 ? g.shot_count - 10 : 0;
+                first = false;
+            }
+            if (g.generation != game_generation(game_id)) {
+                std::cout << "\n🚪 Игра закрыта\n";
+                break;
+            }
+
+            if (g.shot_count != shown || g.state != last_state) {
+                for (; shown < g.shot_count; ++shown) {
+                    std::cout << "  " << format_public_shot(g, g.shots[shown]) << "\n";
                 }
-            } else {
-                std::cout << "❌ Нет ответа от сервера, сбрасываем состояние\n";
-                in_game = false;
-                in_setup = false;
-                current_game_id = -1;
+                std::cout << format_public_view(g);
+                last_state = g.state;
+            }
+
+            if (g.state == GAME_FINISHED) {
+                std::cout << "\n🏁 Победитель: " << game_winner(g) << "\n";
+                break;
+            }
+            if (!g.used || g.state == GAME_WAITING) {
+                std::cout << "\n🚪 Игра закрыта\n";
+                break;
             }
         }
+
+        // Выход по 'q' проверяем между пробуждениями
+        wait_game_change(slot, seen, 200);
+        if (input_pending()) {
+            std::string line;
+            read_line(line);
+            if (line == "q")
+                break;
+        }
     }
+
+    __atomic_fetch_sub(&slot->watchers, 1, __ATOMIC_SEQ_CST);
+    std::cout << std::string(50, '=') << "\n\n";
+}
+
+void Client::watch_replay(uint16_t stream, const std::string& title, bool paced) {
+    // Кадры кладёт в кольцо слота поток повторов сервера; партия собирается
+    // заново здесь же, в локальной копии слота игры
+    ClientSlot* slot = my_slot();
+    if (!slot)
+        return;
+
+    std::cout << "\n" << std::string(50, '=') << "\n";
+    std::cout << "  📼 ПОВТОР: " << title << " ('q' - выйти)\n";
+    std::cout << std::string(50, '=') << "\n";
+
+    GameData g;
+    std::memset(&g, 0, sizeof(g));
+    g.used = true;
+    bool done = false;
+    bool ok = true;
+    while (!done) {
+        uint32_t seen = notify_counter(slot);
+        uint16_t shots = g.shot_count;
+        ReplayFrame f;
+        while (pop_replay_frame(slot, f)) {
+            // Хвост прерванного повтора
+            if (f.stream != stream)
+                continue;
+            if (f.type == REPLAY_DONE) {
+                done = true;
+                ok = f.result == 0;
+                break;
+            }
+            std::string line = apply_replay_frame(g, f);
+            if (!line.empty()) {
+                std::cout << "  +" << f.t_ms / 1000 << "." << f.t_ms % 1000 / 100 << "с " << line
+                          << "\n";
+            }
+        }
+        if (paced && !done && g.shot_count != shots)
+            std::cout << format_public_view(g);
+        if (done)
+            break;
+
+        wait_notify(slot, seen, 200);
+        if (input_pending()) {
+            std::string line;
+            read_line(line);
+            if (line == "q")
+                break;
+        }
+    }
+
+    if (done) {
+        const RulesInfo& rules = rules_info(g.rules);
+        std::cout << "\nПоле " << g.player1 << "\n"
+                  << render_board(g.board1, rules.width, rules.height, true);
+        std::cout << "Поле " << g.player2 << "\n"
+                  << render_board(g.board2, rules.width, rules.height, true);
+        std::cout << "Выстрелов: " << (int)(g.hits1 + g.misses1) << "/"
+                  << (int)(g.hits2 + g.misses2) << ", попаданий: " << (int)g.hits1 << "/"
+                  << (int)g.hits2 << "\n";
+        if (!ok)
+            std::cout << "❌ Журнал партии прочитан не полностью\n";
+    }
+    std::cout << std::string(50, '=') << "\n\n";
+}
+
+void Client::show_own_board() {
+    GameData g;
+    if (!snapshot_game(g)) {
+        std::cout << "\n❌ ERROR:Not in a game\n";
+        return;
+    }
+    bool is_player1 = (login == g.player1);
+    const RulesInfo& rules = rules_info(g.rules);
+    std::cout << "\n"
+              << render_board(is_player1 ? g.board1 : g.board2, rules.width, rules.height, true)
+              << "\n";
+}
+
+void Client::show_opponent_board() {
+    GameData g;
+    if (!snapshot_game(g)) {
+        std::cout << "\n❌ ERROR:Not in a game\n";
+        return;
+    }
+    if (g.state != GAME_ACTIVE && g.state != GAME_FINISHED) {
+        std::cout << "\n❌ ERROR:Game not started yet\n";
+        return;
+    }
+    bool is_player1 = (login == g.player1);
+    const RulesInfo& rules = rules_info(g.rules);
+    std::cout << "\n"
+              << render_board(is_player1 ? g.board2 : g.board1, rules.width, rules.height, false)
+              << "\n";
+}
+
+void Client::show_game_status() {
+    GameData g;
+    if (!snapshot_game(g)) {
+        std::cout << "\nNot in a game\n";
+        return;
+    }
+    std::cout << "\n"
+              << format_game_status(g, my_slot()->current_game_id) << "\n"
+              << format_game_statistics(g, login) << "\n";
 }
 
 bool Client::is_valid_position(uint8_t x, uint8_t y, uint8_t size, bool horizontal, const std::vector<std::pair<uint8_t, uint8_t>>& placed_positions) {
@@ -93,70 +316,25 @@ void Client::auto_place_ships() {
     std::cout << "  АВТОМАТИЧЕСКАЯ РАССТАНОВКА КОРАБЛЕЙ\n";
     std::cout << std::string(50, '=') << "\n";
 
-    std::vector<std::string> ships = {"4,0,0,H", "3,0,5,H", "3,0,8,H", "2,8,8,H", "2,5,5,V",
-                                      "2,8,4,H", "1,6,0,H", "1,6,2,H", "1,3,2,H", "1,9,0,H"};
-
-    int placed_ships = 0;
-    int total_ships = ships.size();
-
+    // Сервер сам выбирает равномерно случайную расстановку и ставит весь флот
+    // за один запрос; прежние корабли игрока снимаются
     clear_response_buffer();
 
-    for (const auto& ship_cmd : ships) {
-        std::cout << "Размещаем корабль: " << ship_cmd << "... ";
-
-        Message m;
-        std::memset(&m, 0, sizeof(m));
-        std::strncpy(m.from, login.c_str(), LOGIN_MAX - 1);
-        m.type = MSG_PLACE_SHIP;
-        std::strncpy(m.payload, ship_cmd.c_str(), CMD_MAX - 1);
-
-        if (!enqueue_message(m)) {
-            std::cout << "❌ Очередь переполнена\n";
-            continue;
-        }
-
-        std::string resp;
-        if (wait_for_response(resp, 2000)) {
-            if (resp.find("SHIP_PLACED") != std::string::npos ||
-                resp.find("OK") != std::string::npos ||
-                resp.find("YOUR_BOARD") != std::string::npos) {
-                placed_ships++;
-                std::cout << "✅ Успешно\n";
-            } else {
-                std::cout << "❌ Ошибка: " << resp.substr(0, 50) << "\n";
-            }
-        } else {
-            std::cout << "❌ Нет ответа от сервера\n";
-        }
-
-        usleep(100 * 1000);
-    }
-
-    std::cout << "\n" << std::string(50, '-') << "\n";
-    std::cout << "  РАССТАНОВКА ЗАВЕРШЕНА\n";
-    std::cout << "  Размещено кораблей: " << placed_ships << "/" << total_ships << "\n";
-
-    if (placed_ships == total_ships) {
+    std::string resp;
+    if (!enqueue_message(MSG_RANDOM_FLEET)) {
+        std::cout << "  ❌ Очередь переполнена\n";
+    } else if (!wait_for_response(resp, 2000)) {
+        std::cout << "  ❌ Нет ответа от сервера\n";
+    } else if (resp.find("FLEET_PLACED:") == 0) {
+        std::cout << "  Корабли: " << resp.substr(13) << "\n";
         std::cout << "  ✅ Все корабли успешно размещены!\n";
 
         std::cout << "  Показываем поле...\n";
-        Message board_msg;
-        std::memset(&board_msg, 0, sizeof(board_msg));
-        std::strncpy(board_msg.from, login.c_str(), LOGIN_MAX - 1);
-        board_msg.type = MSG_GET_BOARD;
-
-        clear_response_buffer();
-
-        if (enqueue_message(board_msg)) {
-            std::string resp;
-            if (wait_for_response(resp, 2000)) {
-                std::cout << "\n" << resp << "\n";
-            }
-        }
+        show_own_board();
 
         std::cout << "  Для завершения расстановки введите 'ready'\n";
     } else {
-        std::cout << "  ⚠️  Не все корабли удалось разместить\n";
+        std::cout << "  ❌ Ошибка: " << resp.substr(0, 80) << "\n";
         std::cout << "  Завершите расстановку вручную\n";
     }
 
@@ -164,81 +342,292 @@ void Client::auto_place_ships() {
 }
 
 Client::~Client() {
+    stop_notifier();
+    close(notify_fd);
+    close(epoll_fd);
+}
+
+void Client::start_notifier() {
+    ClientSlot* slot = my_slot();
+    if (!slot || notifier.joinable())
+        return;
+
+    notifier_slot = slot;
+    notifier = std::thread([this, slot] {
+        uint32_t seen = notify_counter(slot);
+        while (!stopping.load()) {
+            wait_notify(slot, seen, -1);
+            uint32_t now = notify_counter(slot);
+            if (now != seen) {
+                seen = now;
+                uint64_t one = 1;
+                if (write(notify_fd, &one, sizeof(one)) < 0) {
+                    // eventfd переполнен: основной поток и так проснётся
+                }
+            }
+        }
+    });
+}
+
+void Client::stop_notifier() {
+    if (!notifier.joinable())
+        return;
+    stopping.store(true);
+    // Слот мог быть уже освобождён сервером, но память та же: будим поток через неё
+    notify_client(notifier_slot);
+    notifier.join();
+}
+
+bool Client::read_line(std::string& out) {
+    while (true) {
+        size_t nl = input_buffer.find('\n');
+        if (nl != std::string::npos) {
+            out = input_buffer.substr(0, nl);
+            input_buffer.erase(0, nl + 1);
+            return true;
+        }
+        if (input_closed) {
+            out = input_buffer;
+            input_buffer.clear();
+            return !out.empty();
+        }
+
+        bool stdin_ready = !stdin_pollable;
+        if (stdin_pollable) {
+            epoll_event events[2];
+            int n = epoll_wait(epoll_fd, events, 2, -1);
+            if (n < 0 && errno != EINTR)
+                throw std::runtime_error("epoll_wait failed");
+
+            for (int i = 0; i < n; ++i) {
+                if (events[i].data.fd == notify_fd) {
+                    uint64_t counter;
+                    while (read(notify_fd, &counter, sizeof(counter)) > 0) {
+                    }
+                    process_events();
+                    std::string resp;
+                    if (wait_for_response(resp, 0)) {
+                        handle_game_response(resp);
+                    }
+                } else {
+                    stdin_ready = true;
+                }
+            }
+        }
+
+        if (stdin_ready) {
+            char buf[512];
+            ssize_t got = read(STDIN_FILENO, buf, sizeof(buf));
+            if (got > 0) {
+                input_buffer.append(buf, got);
+            } else if (got == 0 || errno != EINTR) {
+                input_closed = true;
+            }
+        }
+    }
 }
 
 ClientSlot* Client::my_slot() {
+    // Сервер меняет поколение при каждой регистрации в слоте: пока оно то же,
+    // логины не сравниваем
+    if (cached_slot && cached_slot->used &&
+        __atomic_load_n(&cached_slot->generation, __ATOMIC_ACQUIRE) == cached_generation)
+        return cached_slot;
+
+    cached_slot = nullptr;
     for (size_t i = 0; i < MAX_CLIENTS; ++i) {
         if (root->clients[i].used &&
             std::strncmp(root->clients[i].login, login.c_str(), LOGIN_MAX) == 0) {
-            return &root->clients[i];
+            cached_slot = &root->clients[i];
+            cached_generation = __atomic_load_n(&cached_slot->generation, __ATOMIC_ACQUIRE);
+            return cached_slot;
         }
     }
     return nullptr;
 }
 
-bool Client::enqueue_message(const Message& m) {
-    pthread_mutex_lock(&root->mutex);
+void Client::connect_shard(int k) {
+    ShmOptions shard_opts = opts;
+    shard_opts.shard = k;
+    shard_opts.shard_count = directory ? directory->shard_count() : 1;
+    shm.reset(new SharedMemory(false, shard_options(shard_opts)));
+    root = shm->root();
+    shard = k;
+    cached_slot = nullptr;
+    if (!root)
+        throw std::runtime_error("Cannot open shared memory; run server first");
+}
 
-    size_t next_tail = (root->q_tail + 1) % QUEUE_SIZE;
-    if (next_tail == root->q_head) {
-        pthread_mutex_unlock(&root->mutex);
+bool Client::register_login() {
+    std::cout << "\n🔗 Регистрация...\n";
+    if (!enqueue_message(MSG_REGISTER, std::to_string(getpid()))) {
+        std::cerr << "❌ Не удалось отправить запрос\n";
         return false;
     }
 
-    root->queue[root->q_tail] = m;
-    root->queue[root->q_tail].used = true;
-    root->q_tail = next_tail;
-
-    pthread_cond_signal(&root->server_cond);
-    pthread_mutex_unlock(&root->mutex);
+    std::string resp;
+    if (wait_for_response(resp, 2000)) {
+        handle_game_response(resp);
+    }
+    start_notifier();
     return true;
 }
 
-bool Client::wait_for_response(std::string& out, int timeout_ms) {
-    auto start = std::chrono::steady_clock::now();
+bool Client::move_to_shard(int k) {
+    // Выходим из своего сегмента и регистрируемся в чужом: партия
+    // возможна только между клиентами одного сегмента
+    stop_notifier();
+    stopping.store(false);
+
+    enqueue_message(MSG_QUIT);
+    for (int i = 0; i < 200 && directory->lookup(login) == shard; i++)
+        usleep(10 * 1000);
+
+    try {
+        connect_shard(k);
+    } catch (const std::exception& ex) {
+        std::cerr << "❌ " << ex.what() << "\n";
+        // Остаёмся в прежнем сегменте
+        register_login();
+        return false;
+    }
+    return register_login();
+}
+
+bool Client::enqueue_message(MsgType type, const std::string& payload) {
+    // Зарегистрированный клиент ставит в очередь не больше CLIENT_QUEUE_QUOTA
+    // записей; при переполнении ждём место, но не дольше ENQUEUE_TIMEOUT_MS
+    ClientSlot* slot = my_slot();
+    int16_t sender = slot ? static_cast<int16_t>(slot - root->clients) : NO_SENDER;
+    RequestLane lane = lane_of(type);
+    uint64_t ticket;
+    Message* m = claim_root(root, lane, sender, true, ENQUEUE_TIMEOUT_MS * 1000000ull, ticket);
+    if (!m)
+        return false;
+    // Запись уже зарезервирована и заполняется без мьютекса; strncpy дописывает
+    // нули до конца поля, так что каждое поле пишется один раз
+    std::strncpy(m->from, login.c_str(), LOGIN_MAX - 1);
+    m->from[LOGIN_MAX - 1] = '\0';
+    std::memset(m->to, 0, LOGIN_MAX);
+    m->type = type;
+    std::strncpy(m->payload, payload.c_str(), CMD_MAX - 1);
+    m->payload[CMD_MAX - 1] = '\0';
+    return commit_root(root, lane, m, ticket);
+}
 
-    while (std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() -
-                                                                 start)
-               .count() < timeout_ms) {
+bool Client::wait_for_response(std::string& out, int timeout_ms) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
 
-        pthread_mutex_lock(&root->mutex);
+    while (true) {
+        lock_root(root);
         ClientSlot* slot = my_slot();
+        uint32_t seen = slot ? notify_counter(slot) : 0;
 
-        if (!slot) {
-            pthread_mutex_unlock(&root->mutex);
-            usleep(100 * 1000);
-            continue;
-        }
-
-        if (slot->has_response) {
+        if (slot && slot->has_response) {
             out = slot->response;
             slot->has_response = false;
             std::memset(slot->response, 0, RESP_MAX);
             pthread_mutex_unlock(&root->mutex);
             return true;
         }
-
         pthread_mutex_unlock(&root->mutex);
-        usleep(100 * 1000);
-    }
 
-    return false;
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+                        deadline - std::chrono::steady_clock::now())
+                        .count();
+        if (left <= 0)
+            return false;
+
+        if (!slot) {
+            // Сервер ещё не обработал регистрацию
+            usleep(std::min<long>(left, 10) * 1000);
+        } else {
+            wait_notify(slot, seen, static_cast<int>(left));
+        }
+    }
 }
 
 bool Client::check_for_async_messages() {
+    bool got = process_events();
+
     std::string resp;
     if (wait_for_response(resp, 20)) {
         std::cout << "[DEBUG] check_for_async_messages got: "
                   << (resp.length() > 50 ? resp.substr(0, 50) + "..." : resp) << std::endl;
         handle_game_response(resp);
-        return true;
+        got = true;
+    }
+    return process_events() || got;
+}
+
+bool Client::process_events() {
+    ClientSlot* slot = my_slot();
+    if (!slot)
+        return false;
+
+    bool any = false;
+    GameEvent e;
+    while (pop_event(slot, e)) {
+        handle_event(e);
+        any = true;
+    }
+    return any;
+}
+
+void Client::handle_event(const GameEvent& e) {
+    switch (e.type) {
+    case EVT_OPPONENT_JOINED:
+        std::cout << "\n🎯 Противник " << e.who
+                  << " присоединился! Начинайте расставлять корабли.\n";
+        in_game = true;
+        current_game_id = e.game_id;
+        break;
+    case EVT_GAME_STARTED:
+        std::cout << "\n⚔️ Игра началась! Противник: " << e.who << "\n";
+        in_game = true;
+        in_setup = false;
+        current_game_id = e.game_id;
+        break;
+    case EVT_YOUR_TURN:
+        std::cout << "\n🎯 ВАШ ХОД!\n";
+        break;
+    case EVT_INCOMING_SHOT: {
+        const char* result = e.result == SHOT_SUNK  ? "ПОТОПЛЕН"
+                             : e.result == SHOT_HIT ? "ПОПАДАНИЕ"
+                                                    : "ПРОМАХ";
+        std::cout << "\n💥 ПРОТИВНИК СТРЕЛЯЕТ: " << (int)e.x << "," << (int)e.y << " - " << result
+                  << "\n";
+        break;
+    }
+    case EVT_MATCH_ASSIGNED:
+        std::cout << "\n🏆 Турнир: ваша партия против " << e.who << " (ID: " << e.game_id
+                  << "). Расставляйте корабли.\n";
+        in_game = true;
+        in_setup = true;
+        current_game_id = e.game_id;
+        break;
+    case EVT_GAME_OVER:
+        std::cout << "\n" << std::string(50, '=') << "\n";
+        std::cout << (e.result ? "  🎉 ПОБЕДА! 🎉\n" : "  💀 ПОРАЖЕНИЕ 💀\n");
+        std::cout << std::string(50, '=') << "\n\n";
+        in_game = false;
+        in_setup = false;
+        current_game_id = -1;
+        break;
+    default:
+        break;
     }
-    return false;
 }
 
 void Client::handle_game_response(const std::string& response) {
     if (response.find("GAME_REMOVED:") == 0) {
         std::cout << "\n🗑️ " << response.substr(13) << "\n";
+        // Турнир мог уже посадить нас в следующую партию
+        ClientSlot* current = my_slot();
+        if (current && current->current_game_id != -1) {
+            current_game_id = current->current_game_id;
+            return;
+        }
         in_game = false;
         in_setup = false;
         current_game_id = -1;
@@ -308,6 +697,55 @@ void Client::handle_game_response(const std::string& response) {
 
             show_main_menu();
         }
+    } else if (response.find("MATCH_FOUND:") == 0) {
+        size_t first = response.find(':');
+        size_t second = response.find(':', first + 1);
+        size_t third = response.find(':', second + 1);
+        if (second != std::string::npos && third != std::string::npos) {
+            std::cout << "\n⚔️ Соперник найден: " << response.substr(first + 1, second - first - 1)
+                      << " (рейтинг " << response.substr(second + 1, third - second - 1) << ")\n";
+            try {
+                current_game_id = std::stoi(response.substr(third + 1));
+            } catch (...) {
+                current_game_id = -1;
+            }
+            in_game = true;
+            in_setup = true;
+        }
+    } else if (response.find("MATCH_QUEUED:") == 0 || response.find("MATCH_CANCELLED:") == 0) {
+        std::cout << "\n⏳ " << response.substr(response.find(':') + 1) << "\n";
+        if (response.find("MATCH_QUEUED:") == 0) {
+            std::cout << "  Отменить поиск: cancel\n";
+        }
+    } else if (response.find("BOT_GAME:") == 0) {
+        try {
+            current_game_id = std::stoi(response.substr(9));
+        } catch (...) {
+            current_game_id = -1;
+        }
+        std::cout << "\n🤖 Бот готов к игре (ID: " << current_game_id << ")\n";
+        in_game = true;
+        in_setup = true;
+    } else if (response.find("TOURNAMENT:") == 0) {
+        std::cout << "\n🏆 Турнир создан: " << response.substr(11) << "\n";
+    } else if (response.find("TOURNAMENT_OVER:") == 0) {
+        std::cout << "\n🏆 Турнир " << response.substr(16) << "\n";
+    } else if (response.find("TOURNAMENT_FAIL:") == 0) {
+        std::cout << "\n❌ " << response.substr(16) << "\n";
+    } else if (response.find("TIMEOUT:") == 0) {
+        std::cout << "\n⏰ " << response.substr(8) << "\n";
+    } else if (response.find("REPLAYS:") == 0) {
+        std::cout << "\n📼 Завершённые партии" << response.substr(8) << "\n";
+    } else if (response.find("REPLAY_FAIL:") == 0) {
+        std::cout << "\n❌ " << response.substr(12) << "\n";
+    } else if (response.find("LEADERBOARD:") == 0) {
+        std::cout << "\n🏅 Таблица лидеров" << response.substr(12) << "\n";
+    } else if (response.find("METRICS:") == 0) {
+        std::cout << "\n📈 Очереди сервера" << response.substr(8) << "\n";
+    } else if (response.find("BOT_FAIL:") == 0) {
+        std::cout << "\n❌ " << response.substr(9) << "\n";
+    } else if (response.find("MATCH_FAIL:") == 0) {
+        std::cout << "\n❌ " << response.substr(11) << "\n";
     } else if (response.find("OPPONENT_JOINED:") == 0) {
         std::cout << "\n🎯 Противник присоединился! Начинайте расставлять корабли.\n";
     } else if (response.find("YOUR_BOARD:") == 0) {
@@ -387,7 +825,8 @@ void Client::handle_game_response(const std::string& response) {
     } else if (response.find("FINAL_STATS:") == 0) {
         std::cout << "\n📊 " << response.substr(12) << "\n";
     } else if (response.find("ERROR:") == 0 || response.find("FAIL:") == 0 ||
-               response.find("INVALID") == 0 || response.find("SHIP_ERROR") == 0) {
+               response.find("INVALID") == 0 || response.find("SHIP_ERROR") == 0 ||
+               response.find("FLEET_FAIL:") == 0 || response.find("SPECTATE_FAIL:") == 0) {
         std::cout << "\n❌ " << response << "\n";
     } else if (response.find("REGISTERED:") == 0) {
         std::cout << "\n✅ " << response.substr(11) << "\n";
@@ -396,6 +835,11 @@ void Client::handle_game_response(const std::string& response) {
         in_game = false;
         in_setup = false;
         current_game_id = -1;
+    } else if (response.find("MATCH_") == 0 || response.find("BOT_") == 0 ||
+               response.find("TOURNAMENT") == 0 || response.find("LEADERBOARD:") == 0 ||
+               response.find("REPLAY") == 0 || response.find("TIMEOUT:") == 0 ||
+               response.find("METRICS:") == 0) {
+        // Уже разобраны выше
     } else if (!response.empty() && response.find("===") != 0) {
         if (response != "\n" && response.length() > 2) {
             std::cout << "\n" << response << "\n";
@@ -412,6 +856,13 @@ void Client::show_main_menu() {
     std::cout << "  4 - Пригласить игрока\n";
     std::cout << "  5 - Проверить приглашения\n";
     std::cout << "  6 - Выйти\n";
+    std::cout << "  7 - Быстрая игра (подбор по рейтингу)\n";
+    std::cout << "  8 - Игра с ботом\n";
+    std::cout << "  9 - Наблюдать за игрой\n";
+    std::cout << "  10 - Турнир\n";
+    std::cout << "  11 - Таблица лидеров\n";
+    std::cout << "  12 - Повтор партии\n";
+    std::cout << "  13 - Метрики сервера\n";
 
     if (pending_invite_id != -1) {
         std::cout << std::string(50, '=') << "\n";
@@ -432,17 +883,23 @@ void Client::place_ships_interactive() {
     std::cout << std::string(50, '=') << "\n";
     std::cout << "  Формат: размер,x,y,ориентация(H/V)\n";
     std::cout << "  Пример: 4,0,0,H\n\n";
+    // Флот берётся из правил игры: на большом поле он другой
+    GameData g;
+    const RulesInfo& rules = rules_info(snapshot_game(g) ? g.rules : static_cast<uint8_t>(RULES_CLASSIC));
+    std::cout << "  Поле " << rules.width << "x" << rules.height
+              << (rules.ships_may_touch ? ", корабли могут касаться" : "") << "\n";
     std::cout << "  Корабли для размещения:\n";
-    std::cout << "    1 авианосец (4 клеток)\n";
-    std::cout << "    2 линкора (3 клетки)\n";
-    std::cout << "    3 крейсера (2 клетки)\n";
-    std::cout << "    4 эсминца (1 клетки)\n";
+    for (int size = MAX_SHIP_SIZE; size >= 1; size--) {
+        if (rules.fleet[size])
+            std::cout << "    " << (int)rules.fleet[size] << " x " << size << " клет.\n";
+    }
     std::cout << std::string(50, '-') << "\n";
     std::cout << "  Команды:\n";
     std::cout << "    auto - автоматическая расстановка\n";
     std::cout << "    ready - готов к игре\n";
     std::cout << "    board - посмотреть поле\n";
     std::cout << "    invite <логин> - пригласить игрока в эту игру\n";
+    std::cout << "    bot [random|hunt|density|exact] - позвать бота в эту игру\n";
     std::cout << "    menu - выйти в меню\n";
     std::cout << std::string(50, '-') << "\n";
 }
@@ -462,7 +919,7 @@ void Client::show_game_menu() {
 }
 
 void Client::clear_response_buffer() {
-    pthread_mutex_lock(&root->mutex);
+    lock_root(root);
     ClientSlot* slot = my_slot();
     if (slot && slot->has_response) {
         std::string resp = slot->response;
@@ -484,32 +941,38 @@ void Client::run() {
     std::cout << "  ДОБРО ПОЖАЛОВАТЬ В МОРСКОЙ ГОЙ!\n";
     std::cout << std::string(50, '=') << "\n";
     std::cout << "  Введите ваш логин: ";
-    std::getline(std::cin, login);
+    read_line(login);
 
     if (login.empty()) {
         std::cerr << "\n❌ Логин не может быть пустым\n";
         return;
     }
-
-    Message reg;
-    std::memset(&reg, 0, sizeof(reg));
-    std::strncpy(reg.from, login.c_str(), LOGIN_MAX - 1);
-    reg.type = MSG_REGISTER;
-
-    std::cout << "\n🔗 Регистрация...\n";
-    if (!enqueue_message(reg)) {
-        std::cerr << "❌ Не удалось отправить запрос\n";
+    if (is_bot_login(login.c_str())) {
+        std::cerr << "\n❌ Это имя зарезервировано\n";
         return;
     }
 
-    std::string resp;
-    if (wait_for_response(resp, 2000)) {
-        handle_game_response(resp);
+    if (directory) {
+        try {
+            connect_shard(shard_of(login, directory->shard_count()));
+        } catch (const std::exception& ex) {
+            std::cerr << "\n❌ " << ex.what() << "\n";
+            return;
+        }
     }
+    if (!register_login())
+        return;
+
+    std::string resp;
 
     bool running = true;
 
     while (running) {
+        if (input_closed && input_buffer.empty()) {
+            enqueue_message(MSG_QUIT);
+            break;
+        }
+
         static int check_counter = 0;
         check_counter++;
         if (check_counter >= 10 && current_game_id != -1) {
@@ -517,28 +980,20 @@ void Client::run() {
             check_counter = 0;
         }
 
-        for (int i = 0; i < 3; i++) {
-            if (check_for_async_messages()) {
-                break;
-            }
-            usleep(50 * 1000);
+        process_events();
+        if (wait_for_response(resp, 0)) {
+            handle_game_response(resp);
         }
 
         if (!in_game) {
             show_main_menu();
             std::string line;
-            std::getline(std::cin, line);
+            read_line(line);
 
             if (line.find("join ") == 0 && !pending_invite_game_name.empty()) {
                 std::string game_id_str = line.substr(5);
 
-                Message m;
-                std::memset(&m, 0, sizeof(m));
-                std::strncpy(m.from, login.c_str(), LOGIN_MAX - 1);
-                m.type = MSG_JOIN;
-                std::strncpy(m.payload, game_id_str.c_str(), CMD_MAX - 1);
-
-                if (!enqueue_message(m)) {
+                if (!enqueue_message(MSG_JOIN, game_id_str)) {
                     std::cout << "\n❌ Очередь переполнена\n";
                 } else {
                     if (wait_for_response(resp, 2000)) {
@@ -551,12 +1006,7 @@ void Client::run() {
                 pending_invite_from.clear();
                 pending_invite_id = -1;
             } else if (line == "1") {
-                Message m;
-                std::memset(&m, 0, sizeof(m));
-                std::strncpy(m.from, login.c_str(), LOGIN_MAX - 1);
-                m.type = MSG_LIST;
-
-                if (!enqueue_message(m)) {
+                if (!enqueue_message(MSG_LIST)) {
                     std::cout << "\n❌ Очередь переполнена\n";
                 } else {
                     if (wait_for_response(resp, 2000)) {
@@ -566,20 +1016,26 @@ void Client::run() {
             } else if (line == "2") {
                 std::cout << "\n🎮 Введите имя для новой игры: ";
                 std::string game_name;
-                std::getline(std::cin, game_name);
+                read_line(game_name);
 
                 if (game_name.empty()) {
                     std::cout << "\n❌ Имя игры не может быть пустым\n";
                     continue;
                 }
 
-                Message m;
-                std::memset(&m, 0, sizeof(m));
-                std::strncpy(m.from, login.c_str(), LOGIN_MAX - 1);
-                m.type = MSG_CREATE;
-                std::strncpy(m.payload, game_name.c_str(), CMD_MAX - 1);
+                std::cout << "📐 Правила (classic, large; Enter - classic): ";
+                std::string rules_name;
+                read_line(rules_name);
+                RulesId rules = RULES_CLASSIC;
+                if (!rules_name.empty() && !parse_rules(rules_name, rules)) {
+                    std::cout << "\n❌ Неизвестные правила\n";
+                    continue;
+                }
+                // Сервер читает правила из последнего слова имени
+                if (rules != RULES_CLASSIC)
+                    game_name += " " + rules_name;
 
-                if (!enqueue_message(m)) {
+                if (!enqueue_message(MSG_CREATE, game_name)) {
                     std::cout << "\n❌ Очередь переполнена\n";
                 } else {
                     if (wait_for_response(resp, 2000)) {
@@ -589,20 +1045,14 @@ void Client::run() {
             } else if (line == "3") {
                 std::cout << "\n🎮 Введите имя или ID игры: ";
                 std::string game_target;
-                std::getline(std::cin, game_target);
+                read_line(game_target);
 
                 if (game_target.empty()) {
                     std::cout << "\n❌ Имя/ID не может быть пустым\n";
                     continue;
                 }
 
-                Message m;
-                std::memset(&m, 0, sizeof(m));
-                std::strncpy(m.from, login.c_str(), LOGIN_MAX - 1);
-                m.type = MSG_JOIN;
-                std::strncpy(m.payload, game_target.c_str(), CMD_MAX - 1);
-
-                if (!enqueue_message(m)) {
+                if (!enqueue_message(MSG_JOIN, game_target)) {
                     std::cout << "\n❌ Очередь переполнена\n";
                 } else {
                     if (wait_for_response(resp, 2000)) {
@@ -612,17 +1062,19 @@ void Client::run() {
             } else if (line == "4") {
                 std::cout << "\n👥 Введите логин игрока для приглашения: ";
                 std::string target;
-                std::getline(std::cin, target);
+                read_line(target);
 
-                std::string game_name = login + "_vs_" + target + "_private";
+                // Соперник в другом сегменте: партия создаётся там, куда переходим мы
+                int where = directory ? directory->lookup(target) : -1;
+                if (where != -1 && where != shard) {
+                    std::cout << "\n🔀 " << target << " в сегменте " << where << ", переходим...\n";
+                    if (!move_to_shard(where))
+                        continue;
+                }
 
-                Message create_msg;
-                std::memset(&create_msg, 0, sizeof(create_msg));
-                std::strncpy(create_msg.from, login.c_str(), LOGIN_MAX - 1);
-                create_msg.type = MSG_CREATE;
-                std::strncpy(create_msg.payload, game_name.c_str(), CMD_MAX - 1);
+                std::string game_name = login + "_vs_" + target + "_private";
 
-                if (!enqueue_message(create_msg)) {
+                if (!enqueue_message(MSG_CREATE, game_name)) {
                     std::cout << "\n❌ Очередь переполнена\n";
                     continue;
                 }
@@ -630,13 +1082,7 @@ void Client::run() {
                 std::string resp;
                 if (wait_for_response(resp, 2000)) {
                     if (resp.find("GAME_CREATED") != std::string::npos) {
-                        Message invite_msg;
-                        std::memset(&invite_msg, 0, sizeof(invite_msg));
-                        std::strncpy(invite_msg.from, login.c_str(), LOGIN_MAX - 1);
-                        invite_msg.type = MSG_INVITE_TO_GAME;
-                        std::strncpy(invite_msg.payload, target.c_str(), CMD_MAX - 1);
-
-                        if (!enqueue_message(invite_msg)) {
+                        if (!enqueue_message(MSG_INVITE_TO_GAME, target)) {
                             std::cout << "\n❌ Очередь переполнена\n";
                         } else {
                             std::string invite_resp;
@@ -674,31 +1120,114 @@ void Client::run() {
 
                 std::cout << "\n🚪 Вы уверены? (да/нет): ";
                 std::string confirm;
-                std::getline(std::cin, confirm);
+                read_line(confirm);
 
                 std::string confirm_lower = confirm;
                 std::transform(confirm_lower.begin(), confirm_lower.end(), confirm_lower.begin(), ::tolower);
 
                 if (confirm_lower == "да" || confirm_lower == "y" || confirm_lower == "yes" ||
                     confirm_lower == "д") {
-                    Message m;
-                    std::memset(&m, 0, sizeof(m));
-                    std::strncpy(m.from, login.c_str(), LOGIN_MAX - 1);
-                    m.type = MSG_QUIT;
-                    enqueue_message(m);
+                    enqueue_message(MSG_QUIT);
                     running = false;
                     std::cout << "\n👋 Выход...\n";
                 }
+            } else if (line == "8") {
+                std::cout << "\n🤖 Сложность (random, hunt, density, exact; Enter - density): ";
+                std::string level;
+                read_line(level);
+
+                if (!enqueue_message(MSG_PLAY_BOT, level)) {
+                    std::cout << "\n❌ Очередь переполнена\n";
+                } else {
+                    if (wait_for_response(resp, 2000)) {
+                        handle_game_response(resp);
+                    }
+                }
+            } else if (line == "12") {
+                resp.clear();
+                if (!enqueue_message(MSG_REPLAY)) {
+                    std::cout << "\n❌ Очередь переполнена\n";
+                } else if (wait_for_response(resp, 2000)) {
+                    handle_game_response(resp);
+                }
+                if (resp.find("REPLAYS:") != 0)
+                    continue;
+
+                std::cout << "\n📼 Номер партии (Enter - назад): ";
+                std::string number;
+                read_line(number);
+                if (number.empty())
+                    continue;
+                std::cout << "📼 Скорость (1 - как шла партия, 10 - в 10 раз быстрее, all - сразу; "
+                             "Enter - 10): ";
+                std::string speed;
+                read_line(speed);
+                if (speed.empty())
+                    speed = "10";
+
+                if (!enqueue_message(MSG_REPLAY, number + " " + speed)) {
+                    std::cout << "\n❌ Очередь переполнена\n";
+                } else if (wait_for_response(resp, 2000)) {
+                    size_t colon = resp.find(':', 7);
+                    if (resp.find("REPLAY:") == 0 && colon != std::string::npos) {
+                        watch_replay(static_cast<uint16_t>(std::atoi(resp.c_str() + 7)),
+                                     resp.substr(colon + 1), speed != "all");
+                    } else {
+                        handle_game_response(resp);
+                    }
+                }
+            } else if (line == "11") {
+                if (!enqueue_message(MSG_LEADERBOARD)) {
+                    std::cout << "\n❌ Очередь переполнена\n";
+                } else if (wait_for_response(resp, 2000)) {
+                    handle_game_response(resp);
+                }
+            } else if (line == "13") {
+                if (!enqueue_message(MSG_METRICS)) {
+                    std::cout << "\n❌ Очередь переполнена\n";
+                } else if (wait_for_response(resp, 2000)) {
+                    handle_game_response(resp);
+                }
+            } else if (line == "10") {
+                std::cout << "\n🏆 Формат (knockout, roundrobin): ";
+                std::string format;
+                read_line(format);
+                std::cout << "🏆 Участники через запятую (логины, bot[:стратегия][*N]): ";
+                std::string entrants;
+                read_line(entrants);
+
+                if (!enqueue_message(MSG_TOURNAMENT, format + " " + entrants)) {
+                    std::cout << "\n❌ Очередь переполнена\n";
+                } else if (wait_for_response(resp, 2000)) {
+                    handle_game_response(resp);
+                }
+            } else if (line == "9") {
+                list_running_games();
+                std::cout << "\n👀 Введите ID игры: ";
+                std::string game_id_str;
+                read_line(game_id_str);
+
+                if (!enqueue_message(MSG_SPECTATE, game_id_str)) {
+                    std::cout << "\n❌ Очередь переполнена\n";
+                } else if (wait_for_response(resp, 2000)) {
+                    if (resp.find("SPECTATE:") == 0) {
+                        spectate(std::atoi(resp.c_str() + 9));
+                    } else {
+                        handle_game_response(resp);
+                    }
+                }
+            } else if (line == "7" || line == "cancel") {
+                if (!enqueue_message(MSG_QUICK_MATCH, line == "cancel" ? "cancel" : "")) {
+                    std::cout << "\n❌ Очередь переполнена\n";
+                } else {
+                    if (wait_for_response(resp, 2000)) {
+                        handle_game_response(resp);
+                    }
+                }
             } else if (line.find("join ") == 0) {
                 std::string game_id_str = line.substr(5);
 
-                Message m;
-                std::memset(&m, 0, sizeof(m));
-                std::strncpy(m.from, login.c_str(), LOGIN_MAX - 1);
-                m.type = MSG_JOIN;
-                std::strncpy(m.payload, game_id_str.c_str(), CMD_MAX - 1);
-
-                if (!enqueue_message(m)) {
+                if (!enqueue_message(MSG_JOIN, game_id_str)) {
                     std::cout << "\n❌ Очередь переполнена\n";
                 } else {
                     if (wait_for_response(resp, 2000)) {
@@ -724,7 +1253,7 @@ void Client::run() {
 
                 std::cout << "\n⚓ Команда: ";
                 std::string command;
-                std::getline(std::cin, command);
+                read_line(command);
 
                 clear_response_buffer();
 
@@ -734,14 +1263,9 @@ void Client::run() {
                 if (cmd_lower == "ready" || cmd_lower == "готово") {
                     clear_response_buffer();
 
-                    Message m;
-                    std::memset(&m, 0, sizeof(m));
-                    std::strncpy(m.from, login.c_str(), LOGIN_MAX - 1);
-                    m.type = MSG_SETUP_COMPLETE;
-
                     std::cout << "🔄 Отправляем 'ready' на сервер...\n";
 
-                    if (!enqueue_message(m)) {
+                    if (!enqueue_message(MSG_SETUP_COMPLETE)) {
                         std::cout << "\n❌ Очередь переполнена\n";
                     } else {
                         std::string resp;
@@ -756,18 +1280,7 @@ void Client::run() {
                     std::cout << "\n🔄 Запускаем автоматическую расстановку...\n";
                     auto_place_ships();
                 } else if (cmd_lower == "board") {
-                    Message m;
-                    std::memset(&m, 0, sizeof(m));
-                    std::strncpy(m.from, login.c_str(), LOGIN_MAX - 1);
-                    m.type = MSG_GET_BOARD;
-
-                    if (!enqueue_message(m)) {
-                        std::cout << "\n❌ Очередь переполнена\n";
-                    } else {
-                        if (wait_for_response(resp, 2000)) {
-                            handle_game_response(resp);
-                        }
-                    }
+                    show_own_board();
                 }
 
                 else if (cmd_lower.find("invite ") == 0) {
@@ -778,13 +1291,19 @@ void Client::run() {
                         continue;
                     }
 
-                    Message m;
-                    std::memset(&m, 0, sizeof(m));
-                    std::strncpy(m.from, login.c_str(), LOGIN_MAX - 1);
-                    m.type = MSG_INVITE_TO_GAME;
-                    std::strncpy(m.payload, target.c_str(), CMD_MAX - 1);
+                    if (!enqueue_message(MSG_INVITE_TO_GAME, target)) {
+                        std::cout << "\n❌ Очередь переполнена\n";
+                    } else {
+                        std::string resp;
+                        if (wait_for_response(resp, 2000)) {
+                            handle_game_response(resp);
+                        }
+                    }
+                }
 
-                    if (!enqueue_message(m)) {
+                else if (cmd_lower == "bot" || cmd_lower.find("bot ") == 0) {
+                    std::string level = cmd_lower.size() > 4 ? cmd_lower.substr(4) : "";
+                    if (!enqueue_message(MSG_PLAY_BOT, level)) {
                         std::cout << "\n❌ Очередь переполнена\n";
                     } else {
                         std::string resp;
@@ -795,24 +1314,14 @@ void Client::run() {
                 }
 
                 else if (cmd_lower == "menu") {
-                    Message m;
-                    std::memset(&m, 0, sizeof(m));
-                    std::strncpy(m.from, login.c_str(), LOGIN_MAX - 1);
-                    m.type = MSG_LEAVE_GAME;
-                    enqueue_message(m);
+                    enqueue_message(MSG_LEAVE_GAME);
 
                     in_game = false;
                     in_setup = false;
                     current_game_id = -1;
                     std::cout << "\n🏳️ Вы вышли из игры\n";
                 } else {
-                    Message m;
-                    std::memset(&m, 0, sizeof(m));
-                    std::strncpy(m.from, login.c_str(), LOGIN_MAX - 1);
-                    m.type = MSG_PLACE_SHIP;
-                    std::strncpy(m.payload, command.c_str(), CMD_MAX - 1);
-
-                    if (!enqueue_message(m)) {
+                    if (!enqueue_message(MSG_PLACE_SHIP, command)) {
                         std::cout << "\n❌ Очередь переполнена\n";
                     } else {
                         if (wait_for_response(resp, 2000)) {
@@ -821,35 +1330,21 @@ void Client::run() {
                     }
                 }
             } else {
-                bool has_async = check_for_async_messages();
-
-                if (has_async) {
-                    std::cout << "\nНажмите Enter для продолжения...";
-                    std::string dummy;
-                    std::getline(std::cin, dummy);
-                }
-
                 show_game_menu();
 
                 std::string line;
-                std::getline(std::cin, line);
+                read_line(line);
 
                 if (line == "1") {
                     std::cout << "\n🎯 Координаты выстрела (x,y): ";
                     std::string shot;
-                    std::getline(std::cin, shot);
+                    read_line(shot);
 
                     clear_response_buffer();
 
-                    Message m;
-                    std::memset(&m, 0, sizeof(m));
-                    std::strncpy(m.from, login.c_str(), LOGIN_MAX - 1);
-                    m.type = MSG_SHOT;
-                    std::strncpy(m.payload, shot.c_str(), CMD_MAX - 1);
-
                     std::cout << "🔄 Отправляем выстрел...\n";
 
-                    if (!enqueue_message(m)) {
+                    if (!enqueue_message(MSG_SHOT, shot)) {
                         std::cout << "\n❌ Очередь переполнена\n";
                     } else {
                         std::string resp;
@@ -861,51 +1356,18 @@ void Client::run() {
                         }
                     }
                 } else if (line == "2") {
-                    Message m;
-                    std::memset(&m, 0, sizeof(m));
-                    std::strncpy(m.from, login.c_str(), LOGIN_MAX - 1);
-                    m.type = MSG_GET_BOARD;
-
-                    if (!enqueue_message(m)) {
-                        std::cout << "\n❌ Очередь переполнена\n";
-                    } else {
-                        if (wait_for_response(resp, 2000)) {
-                            handle_game_response(resp);
-                        }
-                    }
+                    show_own_board();
                 } else if (line == "3") {
-                    Message m;
-                    std::memset(&m, 0, sizeof(m));
-                    std::strncpy(m.from, login.c_str(), LOGIN_MAX - 1);
-                    m.type = MSG_GET_OPPONENT_BOARD;
-
-                    if (!enqueue_message(m)) {
-                        std::cout << "\n❌ Очередь переполнена\n";
-                    } else {
-                        if (wait_for_response(resp, 2000)) {
-                            handle_game_response(resp);
-                        }
-                    }
+                    show_opponent_board();
                 } else if (line == "4") {
-                    Message m;
-                    std::memset(&m, 0, sizeof(m));
-                    std::strncpy(m.from, login.c_str(), LOGIN_MAX - 1);
-                    m.type = MSG_GAME_STATUS;
-
-                    if (!enqueue_message(m)) {
-                        std::cout << "\n❌ Очередь переполнена\n";
-                    } else {
-                        if (wait_for_response(resp, 2000)) {
-                            handle_game_response(resp);
-                        }
-                    }
+                    show_game_status();
                 } else if (line == "5") {
 
                     force_check_state();
 
                     std::cout << "\n🏳️ Вы уверены? (да/нет): ";
                     std::string confirm;
-                    std::getline(std::cin, confirm);
+                    read_line(confirm);
 
                     std::string confirm_lower = confirm;
                     std::transform(confirm_lower.begin(), confirm_lower.end(),
@@ -913,12 +1375,7 @@ void Client::run() {
 
                     if (confirm_lower == "да" || confirm_lower == "y" || confirm_lower == "yes" ||
                         confirm_lower == "д") {
-                        Message m;
-                        std::memset(&m, 0, sizeof(m));
-                        std::strncpy(m.from, login.c_str(), LOGIN_MAX - 1);
-                        m.type = MSG_SURRENDER;
-
-                        if (!enqueue_message(m)) {
+                        if (!enqueue_message(MSG_SURRENDER)) {
                             std::cout << "\n❌ Очередь переполнена\n";
                         } else {
                             if (wait_for_response(resp, 2000)) {
@@ -930,7 +1387,7 @@ void Client::run() {
                     std::cout << "\n⚠️ Выход приравнивается к сдаче!\n";
                     std::cout << "Вы уверены? (да/нет): ";
                     std::string confirm;
-                    std::getline(std::cin, confirm);
+                    read_line(confirm);
 
                     std::string confirm_lower = confirm;
                     std::transform(confirm_lower.begin(), confirm_lower.end(),
@@ -938,14 +1395,9 @@ void Client::run() {
 
                     if (confirm_lower == "да" || confirm_lower == "y" || confirm_lower == "yes" ||
                         confirm_lower == "д") {
-                        Message m;
-                        std::memset(&m, 0, sizeof(m));
-                        std::strncpy(m.from, login.c_str(), LOGIN_MAX - 1);
-                        m.type = MSG_LEAVE_GAME;
-
                         clear_response_buffer();
 
-                        if (!enqueue_message(m)) {
+                        if (!enqueue_message(MSG_LEAVE_GAME)) {
                             std::cout << "\n❌ Очередь переполнена\n";
                         } else {
                             std::string resp;
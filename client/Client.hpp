@@ -1,19 +1,28 @@
 #pragma once
 #include "../include/SharedTypes.hpp"
 #include "../include/SharedMemory.hpp"
+#include "../include/ShardDirectory.hpp"
+#include <atomic>
+#include <memory>
 #include <string>
 #include <random>
+#include <thread>
 
 class Client {
 public:
-    Client();
+    explicit Client(const ShmOptions& opts = ShmOptions());
     ~Client();
 
     void run();
 
 private:
-    SharedMemory shm;
+    ShmOptions opts;
+    // Сегмент выбирается по логину, поэтому подключение откладывается до входа
+    std::unique_ptr<SharedMemory> shm;
     SharedMemoryRoot* root;
+    // Каталог логинов; нет, если сервер работает с одним сегментом
+    std::unique_ptr<ShardDirectory> directory;
+    int shard;
     std::string login;
     int current_game_id;
     bool in_game;
@@ -22,21 +31,51 @@ private:
     bool setup_show_menu;
 
     std::mt19937 rng;
+
+    // Цикл ввода: epoll по stdin и eventfd, который будит поток-наблюдатель
+    // за futex-словом слота, когда сервер присылает ответ или событие
+    int epoll_fd;
+    int notify_fd;
+    bool stdin_pollable;
+    bool input_closed;
+    std::string input_buffer;
+    std::thread notifier;
+    ClientSlot* notifier_slot;
+    // Найденный слот и его поколение: пока поколение то же, слот наш
+    ClientSlot* cached_slot;
+    uint32_t cached_generation;
+    std::atomic<bool> stopping;
     
     std::string pending_invite_game_name;
     std::string pending_invite_from;
     int pending_invite_id;
 
-    bool enqueue_message(const Message& m);
+    void connect_shard(int k);
+    bool register_login();
+    bool move_to_shard(int k);
+    // Запрос от имени login пишется сразу в очередь сервера
+    bool enqueue_message(MsgType type, const std::string& payload = std::string());
     bool wait_for_response(std::string &out, int timeout_ms = 1000);
     ClientSlot* my_slot();
+    bool read_line(std::string& out);
+    void start_notifier();
+    void stop_notifier();
     bool check_for_async_messages();
+    bool process_events();
+    void handle_event(const GameEvent& e);
     void handle_game_response(const std::string& response);
     
     void show_main_menu();
     void show_game_menu();
     void place_ships_interactive();
     void show_game_status();
+    void show_own_board();
+    void show_opponent_board();
+    bool snapshot_game(GameData& out);
+    void list_running_games();
+    void spectate(int game_id);
+    void watch_replay(uint16_t stream, const std::string& title, bool paced);
+    bool input_pending();
     void clear_response_buffer();
 
     void auto_place_ships();
@@ -1,13 +1,32 @@
 #include "Client.hpp"
+#include <cstring>
 #include <iostream>
 
-int main() {
+int main(int argc, char** argv) {
+    ShmOptions opts;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--file") == 0 && i + 1 < argc) {
+            opts.file = argv[++i];
+        } else if (std::strcmp(argv[i], "--huge-pages") == 0) {
+            opts.huge_pages = true;
+        } else if (std::strcmp(argv[i], "--populate") == 0) {
+            opts.populate = true;
+        } else if (std::strcmp(argv[i], "--mlock") == 0) {
+            opts.lock_memory = true;
+        } else {
+            std::cerr << "Usage: " << argv[0]
+                      << " [--file <segment file>] [--huge-pages] [--populate] [--mlock]"
+                      << std::endl;
+            return 1;
+        }
+    }
+
     try {
-        Client c;
+        Client c(opts);
         c.run();
     } catch (const std::exception &ex) {
         std::cerr << "Client error: " << ex.what() << std::endl;
         return 1;
     }
     return 0;
-}
\ No newline at end of file
+}
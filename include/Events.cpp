@@ -0,0 +1,109 @@
+#include "Events.hpp"
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <ctime>
+
+bool push_event(ClientSlot* slot, const GameEvent& e) {
+    uint32_t tail = __atomic_load_n(&slot->ev_tail, __ATOMIC_RELAXED);
+    uint32_t head = __atomic_load_n(&slot->ev_head, __ATOMIC_ACQUIRE);
+    if (tail - head >= EVENT_QUEUE_SIZE)
+        return false;
+
+    slot->events[tail % EVENT_QUEUE_SIZE] = e;
+    __atomic_store_n(&slot->ev_tail, tail + 1, __ATOMIC_RELEASE);
+    notify_client(slot);
+    return true;
+}
+
+bool pop_event(ClientSlot* slot, GameEvent& e) {
+    uint32_t head = __atomic_load_n(&slot->ev_head, __ATOMIC_RELAXED);
+    uint32_t tail = __atomic_load_n(&slot->ev_tail, __ATOMIC_ACQUIRE);
+    if (head == tail)
+        return false;
+
+    e = slot->events[head % EVENT_QUEUE_SIZE];
+    __atomic_store_n(&slot->ev_head, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+void reset_events(ClientSlot* slot) {
+    __atomic_store_n(&slot->ev_head, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->ev_tail, 0, __ATOMIC_RELEASE);
+}
+
+size_t push_replay_frames(ClientSlot* slot, const ReplayFrame* frames, size_t n) {
+    uint32_t tail = __atomic_load_n(&slot->rp_tail, __ATOMIC_RELAXED);
+    uint32_t head = __atomic_load_n(&slot->rp_head, __ATOMIC_ACQUIRE);
+    size_t room = REPLAY_QUEUE_SIZE - (tail - head);
+    if (n > room)
+        n = room;
+    if (n == 0)
+        return 0;
+
+    for (size_t i = 0; i < n; ++i)
+        slot->replay[(tail + i) % REPLAY_QUEUE_SIZE] = frames[i];
+    __atomic_store_n(&slot->rp_tail, tail + static_cast<uint32_t>(n), __ATOMIC_RELEASE);
+    notify_client(slot);
+    return n;
+}
+
+bool pop_replay_frame(ClientSlot* slot, ReplayFrame& f) {
+    uint32_t head = __atomic_load_n(&slot->rp_head, __ATOMIC_RELAXED);
+    uint32_t tail = __atomic_load_n(&slot->rp_tail, __ATOMIC_ACQUIRE);
+    if (head == tail)
+        return false;
+
+    f = slot->replay[head % REPLAY_QUEUE_SIZE];
+    __atomic_store_n(&slot->rp_head, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+void reset_replay(ClientSlot* slot) {
+    __atomic_store_n(&slot->rp_head, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->rp_tail, 0, __ATOMIC_RELEASE);
+}
+
+void notify_client(ClientSlot* slot) {
+    __atomic_fetch_add(&slot->notify_seq, 1, __ATOMIC_RELEASE);
+    syscall(SYS_futex, &slot->notify_seq, FUTEX_WAKE, INT32_MAX, nullptr, nullptr, 0);
+}
+
+uint32_t notify_counter(const ClientSlot* slot) {
+    return __atomic_load_n(&slot->notify_seq, __ATOMIC_ACQUIRE);
+}
+
+bool wait_notify(ClientSlot* slot, uint32_t seen, int timeout_ms) {
+    timespec ts;
+    ts.tv_sec = timeout_ms / 1000;
+    ts.tv_nsec = (timeout_ms % 1000) * 1000000L;
+
+    long rc = syscall(SYS_futex, &slot->notify_seq, FUTEX_WAIT, seen, timeout_ms < 0 ? nullptr : &ts,
+                      nullptr, 0);
+    if (rc == 0 || errno == EAGAIN || errno == EINTR)
+        return notify_counter(slot) != seen;
+    return false;
+}
+
+void wake_watchers(GameData* g) {
+    // Пара к fetch_add зрителя: либо мы увидим его, либо он увидит новый seq
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&g->watchers, __ATOMIC_RELAXED) == 0)
+        return;
+    syscall(SYS_futex, &g->seq, FUTEX_WAKE, INT32_MAX, nullptr, nullptr, 0);
+}
+
+bool wait_game_change(const GameData* g, uint32_t seen, int timeout_ms) {
+    timespec ts;
+    ts.tv_sec = timeout_ms / 1000;
+    ts.tv_nsec = (timeout_ms % 1000) * 1000000L;
+
+    uint32_t* word = const_cast<uint32_t*>(&g->seq);
+    long rc = syscall(SYS_futex, word, FUTEX_WAIT, seen, timeout_ms < 0 ? nullptr : &ts, nullptr, 0);
+    if (rc == 0 || errno == EAGAIN || errno == EINTR)
+        return __atomic_load_n(&g->seq, __ATOMIC_ACQUIRE) != seen;
+    return false;
+}
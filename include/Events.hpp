@@ -0,0 +1,44 @@
+#pragma once
+#include "SeqLock.hpp"
+#include "SharedTypes.hpp"
+
+// Доставка событий сервер -> клиент через кольцо в ClientSlot и futex на
+// notify_seq. Ожидающий клиент просыпается сразу, без опроса по таймеру.
+
+bool push_event(ClientSlot* slot, const GameEvent& e);
+bool pop_event(ClientSlot* slot, GameEvent& e);
+void reset_events(ClientSlot* slot);
+
+// Кадры повтора: пачка публикуется одной записью rp_tail и одним пробуждением.
+// Возвращает, сколько кадров поместилось
+size_t push_replay_frames(ClientSlot* slot, const ReplayFrame* frames, size_t n);
+bool pop_replay_frame(ClientSlot* slot, ReplayFrame& f);
+void reset_replay(ClientSlot* slot);
+
+void notify_client(ClientSlot* slot);
+uint32_t notify_counter(const ClientSlot* slot);
+// Ждёт, пока notify_seq не изменится относительно seen; false по таймауту.
+// Отрицательный timeout_ms - ждать без ограничения
+bool wait_notify(ClientSlot* slot, uint32_t seen, int timeout_ms);
+
+// Зрители партии читают слот игры напрямую и ждут futex на GameData::seq.
+// Один FUTEX_WAKE будит всех сразу, сколько бы их ни было.
+void wake_watchers(GameData* g);
+// Ждёт, пока seq слота не станет отличным от seen; false по таймауту
+bool wait_game_change(const GameData* g, uint32_t seen, int timeout_ms);
+
+// Запись в слот игры под seqlock; по окончании будит зрителей
+class GameWriteGuard {
+  public:
+    explicit GameWriteGuard(GameData* g) : g(g) { seq_write_begin(g->seq); }
+    ~GameWriteGuard() {
+        seq_write_end(g->seq);
+        wake_watchers(g);
+    }
+
+    GameWriteGuard(const GameWriteGuard&) = delete;
+    GameWriteGuard& operator=(const GameWriteGuard&) = delete;
+
+  private:
+    GameData* g;
+};
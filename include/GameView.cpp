@@ -0,0 +1,252 @@
+#include "GameView.hpp"
+
+#include <sched.h>
+
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+
+#include "Rules.hpp"
+#include "SeqLock.hpp"
+
+bool read_game_snapshot(const GameData& src, GameData& out) {
+    for (int attempt = 0; attempt < 1000; attempt++) {
+        uint32_t start = seq_read_begin(src.seq);
+        std::memcpy(&out, &src, sizeof(GameData));
+        if (!seq_read_retry(src.seq, start))
+            return true;
+        sched_yield();
+    }
+    return false;
+}
+
+std::string render_board(const CellState board[MAX_BOARD_SIZE][MAX_BOARD_SIZE], int width,
+                         int height, bool show_ships) {
+    std::stringstream ss;
+
+    ss << "   ";
+    for (int i = 0; i < width; i++) {
+        ss << std::setw(2) << i << " ";
+    }
+    ss << "\n";
+
+    for (int y = 0; y < height; y++) {
+        ss << std::setw(2) << y << " ";
+        for (int x = 0; x < width; x++) {
+            char symbol = '.';
+            switch(board[y][x]) {
+                case CELL_EMPTY: symbol = '.'; break;
+                case CELL_SHIP: symbol = show_ships ? 'S' : '.'; break;
+                case CELL_HIT: symbol = 'X'; break;
+                case CELL_MISS: symbol = 'O'; break;
+                case CELL_SUNK: symbol = '#'; break;
+            }
+            ss << " " << symbol << " ";
+        }
+        ss << "\n";
+    }
+
+    return ss.str();
+}
+
+std::string game_winner(const GameData& g) {
+    if (g.state != GAME_FINISHED) return "";
+
+    bool all_sunk1 = true;
+    for (int i = 0; i < g.ship_count1; i++) {
+        if (!g.ships1[i].sunk) {
+            all_sunk1 = false;
+            break;
+        }
+    }
+
+    bool all_sunk2 = true;
+    for (int i = 0; i < g.ship_count2; i++) {
+        if (!g.ships2[i].sunk) {
+            all_sunk2 = false;
+            break;
+        }
+    }
+
+    if (all_sunk1) return std::string(g.player2);
+    if (all_sunk2) return std::string(g.player1);
+    return "";
+}
+
+std::string format_game_status(const GameData& g, int game_id) {
+    std::stringstream ss;
+
+    ss << "Игра: " << g.game_name << " (ID: " << game_id << ")\n";
+    ss << "Игрок 1: " << g.player1 << "\n";
+    ss << "Игрок 2: " << (g.player2[0] ? g.player2 : "ожидает...") << "\n";
+    ss << "Тип: " << (g.is_public ? "публичная" : "приватная") << "\n";
+    const RulesInfo& rules = rules_info(g.rules);
+    ss << "Правила: " << rules.name << " (" << rules.width << "x" << rules.height << ")\n";
+    ss << "Статус: ";
+
+    switch(g.state) {
+        case GAME_WAITING: ss << "Ожидание второго игрока"; break;
+        case GAME_SETUP: ss << "Расстановка кораблей"; break;
+        case GAME_ACTIVE: ss << "Идет игра (ход: " << g.current_turn << ")"; break;
+        case GAME_FINISHED:
+            ss << "Завершена. Победитель: " << game_winner(g);
+            break;
+    }
+
+    return ss.str();
+}
+
+std::string format_game_statistics(const GameData& g, const std::string& player) {
+    std::stringstream ss;
+
+    bool is_player1 = (player == std::string(g.player1));
+
+    ss << "Статистика:\n";
+    ss << "Сбито кораблей: " << (is_player1 ? (int)g.sunk1 : (int)g.sunk2) << "\n";
+    ss << "Попаданий: " << (is_player1 ? (int)g.hits1 : (int)g.hits2) << "\n";
+    ss << "Промахов: " << (is_player1 ? (int)g.misses1 : (int)g.misses2) << "\n";
+
+    if (g.state == GAME_FINISHED) {
+        ss << "Игра завершена!\n";
+        std::string winner = game_winner(g);
+        if (winner == player) {
+            ss << "Вы победили!\n";
+        } else {
+            ss << "Победил: " << winner << "\n";
+        }
+    } else if (g.state == GAME_ACTIVE) {
+        ss << "Текущий ход: " << g.current_turn << "\n";
+        if (player == g.current_turn) {
+            ss << "Ваш ход!\n";
+        } else {
+            ss << "Ход противника\n";
+        }
+    }
+
+    return ss.str();
+}
+
+std::string format_public_view(const GameData& g) {
+    std::stringstream ss;
+    const RulesInfo& rules = rules_info(g.rules);
+
+    ss << "Поле " << g.player1 << " (попаданий по нему: " << (int)g.hits2
+       << ", потоплено: " << (int)g.sunk2 << ")\n";
+    ss << render_board(g.board1, rules.width, rules.height, false);
+    ss << "Поле " << g.player2 << " (попаданий по нему: " << (int)g.hits1
+       << ", потоплено: " << (int)g.sunk1 << ")\n";
+    ss << render_board(g.board2, rules.width, rules.height, false);
+
+    if (g.state == GAME_ACTIVE) {
+        ss << "Ход: " << g.current_turn << "\n";
+    }
+    return ss.str();
+}
+
+std::string format_public_shot(const GameData& g, const PublicShot& shot) {
+    std::stringstream ss;
+
+    ss << (shot.shooter == 1 ? g.player1 : g.player2) << " -> " << (int)shot.x << ","
+       << (int)shot.y << ": ";
+    switch (shot.result) {
+        case SHOT_MISS: ss << "мимо"; break;
+        case SHOT_HIT: ss << "попадание"; break;
+        case SHOT_SUNK: ss << "потоплен"; break;
+    }
+    return ss.str();
+}
+
+std::string apply_replay_frame(GameData& g, const ReplayFrame& f) {
+    if (f.type == JR_RULES) {
+        g.rules = f.result < RULES_COUNT ? f.result : static_cast<uint8_t>(RULES_CLASSIC);
+        return std::string("правила ") + rules_info(g.rules).name;
+    }
+    if (f.seat != 1 && f.seat != 2 && f.type != JR_END)
+        return "";
+    const RulesInfo& rules = rules_info(g.rules);
+    char* name = f.seat == 1 ? g.player1 : g.player2;
+    CellState (*own)[MAX_BOARD_SIZE] = f.seat == 1 ? g.board1 : g.board2;
+    Ship* ships = f.seat == 1 ? g.ships1 : g.ships2;
+    uint8_t& ship_count = f.seat == 1 ? g.ship_count1 : g.ship_count2;
+    std::stringstream ss;
+
+    switch (f.type) {
+    case JR_PLAYER:
+        std::strncpy(name, f.login, LOGIN_MAX - 1);
+        if (g.player1[0] && g.player2[0])
+            g.state = GAME_SETUP;
+        ss << "за стол " << (int)f.seat << " сел " << f.login;
+        break;
+    case JR_LEAVE:
+        ss << name << " вышел";
+        break;
+    case JR_PLACE:
+        if (ship_count >= MAX_SHIPS || f.x >= rules.width || f.y >= rules.height)
+            break;
+        ships[ship_count++] = Ship{f.size, f.size, f.horizontal, f.x, f.y, false};
+        for (int i = 0; i < f.size; i++) {
+            int x = f.x + (f.horizontal ? i : 0);
+            int y = f.y + (f.horizontal ? 0 : i);
+            if (x < rules.width && y < rules.height)
+                own[y][x] = CELL_SHIP;
+        }
+        break;
+    case JR_CLEAR:
+        std::memset(own, CELL_EMPTY, sizeof(g.board1));
+        ship_count = 0;
+        break;
+    case JR_READY:
+        (f.seat == 1 ? g.ready1 : g.ready2) = true;
+        ss << name << " расставил флот";
+        if (g.ready1 && g.ready2) {
+            g.state = GAME_ACTIVE;
+            std::strncpy(g.current_turn, g.player1, LOGIN_MAX - 1);
+        }
+        break;
+    case JR_SHOT: {
+        if (f.x >= rules.width || f.y >= rules.height)
+            break;
+        bool first = f.seat == 1;
+        CellState (*target)[MAX_BOARD_SIZE] = first ? g.board2 : g.board1;
+        target[f.y][f.x] = f.result == SHOT_MISS ? CELL_MISS : CELL_HIT;
+        if (f.result == SHOT_MISS) {
+            (first ? g.misses1 : g.misses2)++;
+            std::strncpy(g.current_turn, first ? g.player2 : g.player1, LOGIN_MAX - 1);
+        } else {
+            (first ? g.hits1 : g.hits2)++;
+        }
+        if (f.result == SHOT_SUNK) {
+            (first ? g.sunk1 : g.sunk2)++;
+            Ship* enemy = first ? g.ships2 : g.ships1;
+            uint8_t count = first ? g.ship_count2 : g.ship_count1;
+            for (uint8_t i = 0; i < count; i++) {
+                Ship& s = enemy[i];
+                int dx = f.x - s.start_x;
+                int dy = f.y - s.start_y;
+                bool on = s.horizontal ? dy == 0 && dx >= 0 && dx < s.size
+                                       : dx == 0 && dy >= 0 && dy < s.size;
+                if (!on)
+                    continue;
+                s.sunk = true;
+                s.health = 0;
+                for (int k = 0; k < s.size; k++)
+                    target[s.start_y + (s.horizontal ? 0 : k)][s.start_x + (s.horizontal ? k : 0)] =
+                        CELL_SUNK;
+            }
+        }
+        PublicShot shot{f.seat, f.x, f.y, f.result};
+        if (g.shot_count < PUBLIC_LOG_SIZE)
+            g.shots[g.shot_count++] = shot;
+        return format_public_shot(g, shot);
+    }
+    case JR_END:
+        g.state = GAME_FINISHED;
+        if (f.seat == 1 || f.seat == 2)
+            ss << "победил " << name
+               << (f.result == JOURNAL_END_SURRENDER ? " (соперник сдался)" : "");
+        else
+            ss << "партия закрыта без результата";
+        break;
+    }
+    return ss.str();
+}
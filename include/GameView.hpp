@@ -0,0 +1,25 @@
+#pragma once
+#include <string>
+
+#include "SharedTypes.hpp"
+
+// Чтение и отображение состояния игры прямо из разделяемой памяти.
+// Используется и сервером (Game), и клиентом для запросов без участия сервера.
+
+// Согласованная копия слота игры; false, если писатель не дал снять копию
+bool read_game_snapshot(const GameData& src, GameData& out);
+
+// Поле width x height в левом верхнем углу доски
+std::string render_board(const CellState board[MAX_BOARD_SIZE][MAX_BOARD_SIZE], int width,
+                         int height, bool show_ships);
+std::string game_winner(const GameData& g);
+std::string format_game_status(const GameData& g, int game_id);
+std::string format_game_statistics(const GameData& g, const std::string& player);
+
+// Для зрителей: обе доски без нетронутых кораблей и одна строка на выстрел
+std::string format_public_view(const GameData& g);
+std::string format_public_shot(const GameData& g, const PublicShot& shot);
+
+// Для повтора: восстанавливает слот игры по кадрам журнала без сервера.
+// Возвращает строку для показа или пустую, если кадр показывать не нужно
+std::string apply_replay_frame(GameData& g, const ReplayFrame& f);
@@ -0,0 +1,98 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+#include "SharedTypes.hpp"
+
+// Правила партии: размер поля, состав флота и можно ли кораблям касаться.
+// Каждый вариант - политика с constexpr-таблицами; сервер собирает под неё
+// свой движок (RulesGame<Rules>), а клиент, вид и журналы узнают правила
+// по RulesId из слота игры.
+enum RulesId : uint8_t {
+    RULES_CLASSIC = 0,
+    RULES_LARGE = 1
+};
+constexpr size_t RULES_COUNT = 2;
+
+// 10x10, флот 4-3-3-2-2-2-1-1-1-1, корабли не касаются даже углами
+struct ClassicRules {
+    static constexpr RulesId ID = RULES_CLASSIC;
+    static constexpr int WIDTH = 10;
+    static constexpr int HEIGHT = 10;
+    // FLEET[size] - сколько кораблей длины size
+    static constexpr uint8_t FLEET[MAX_SHIP_SIZE + 1] = {0, 4, 3, 2, 1, 0};
+    static constexpr bool SHIPS_MAY_TOUCH = false;
+};
+
+// 16x16, флот 5-4-4-3-3-3-2-2-2-2-1-1-1-1-1; касаться можно, пересекаться нельзя
+struct LargeRules {
+    static constexpr RulesId ID = RULES_LARGE;
+    static constexpr int WIDTH = 16;
+    static constexpr int HEIGHT = 16;
+    static constexpr uint8_t FLEET[MAX_SHIP_SIZE + 1] = {0, 5, 4, 3, 2, 1};
+    static constexpr bool SHIPS_MAY_TOUCH = true;
+};
+
+template <class Rules>
+constexpr int fleet_ship_count() {
+    int n = 0;
+    for (int size = 1; size <= MAX_SHIP_SIZE; size++)
+        n += Rules::FLEET[size];
+    return n;
+}
+
+static_assert(ClassicRules::WIDTH == BOARD_SIZE && ClassicRules::HEIGHT == BOARD_SIZE,
+              "bots and bitboards assume the classic board");
+static_assert(LargeRules::WIDTH <= MAX_BOARD_SIZE && LargeRules::HEIGHT <= MAX_BOARD_SIZE,
+              "game slot is too small for the large board");
+static_assert(fleet_ship_count<LargeRules>() <= MAX_SHIPS, "game slot is too small for the fleet");
+
+// Те же правила для кода, которому они известны только во время работы
+struct RulesInfo {
+    RulesId id;
+    const char* name;
+    int width;
+    int height;
+    const uint8_t* fleet;
+    int ship_count;
+    bool ships_may_touch;
+};
+
+template <class Rules>
+constexpr RulesInfo make_rules_info(const char* name) {
+    return RulesInfo{Rules::ID, name, Rules::WIDTH, Rules::HEIGHT, Rules::FLEET,
+                     fleet_ship_count<Rules>(), Rules::SHIPS_MAY_TOUCH};
+}
+
+// Неизвестный номер считается классикой
+inline const RulesInfo& rules_info(uint8_t id) {
+    static const RulesInfo table[RULES_COUNT] = {
+        make_rules_info<ClassicRules>("classic"),
+        make_rules_info<LargeRules>("large"),
+    };
+    return table[id < RULES_COUNT ? id : static_cast<uint8_t>(RULES_CLASSIC)];
+}
+
+// "1x4, 2x3, 3x2, 4x1": сколько кораблей какой длины, от длинных к коротким
+inline std::string fleet_summary(const RulesInfo& rules) {
+    std::string res;
+    for (int size = MAX_SHIP_SIZE; size >= 1; size--) {
+        if (!rules.fleet[size])
+            continue;
+        if (!res.empty())
+            res += ", ";
+        res += std::to_string(rules.fleet[size]) + "x" + std::to_string(size);
+    }
+    return res;
+}
+
+// false, если имя не распознано
+inline bool parse_rules(const std::string& name, RulesId& out) {
+    for (size_t i = 0; i < RULES_COUNT; i++) {
+        if (name == rules_info(static_cast<uint8_t>(i)).name) {
+            out = static_cast<RulesId>(i);
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <cstdint>
+
+// Seqlock для структур в разделяемой памяти. Пишет только сервер: на время
+// изменения счётчик нечётный. Читатель копирует данные и повторяет попытку,
+// если счётчик был нечётным или изменился за время копирования.
+
+inline void seq_write_begin(uint32_t& seq) {
+    __atomic_store_n(&seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+inline void seq_write_end(uint32_t& seq) {
+    __atomic_store_n(&seq, seq + 1, __ATOMIC_RELEASE);
+}
+
+inline uint32_t seq_read_begin(const uint32_t& seq) {
+    return __atomic_load_n(&seq, __ATOMIC_ACQUIRE);
+}
+
+inline bool seq_read_retry(const uint32_t& seq, uint32_t start) {
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return (start & 1) || __atomic_load_n(&seq, __ATOMIC_RELAXED) != start;
+}
+
+class SeqWriteGuard {
+  public:
+    explicit SeqWriteGuard(uint32_t& seq) : seq(seq) { seq_write_begin(seq); }
+    ~SeqWriteGuard() { seq_write_end(seq); }
+
+    SeqWriteGuard(const SeqWriteGuard&) = delete;
+    SeqWriteGuard& operator=(const SeqWriteGuard&) = delete;
+
+  private:
+    uint32_t& seq;
+};
@@ -0,0 +1,162 @@
+#include "ShardDirectory.hpp"
+#include <cerrno>
+#include <csignal>
+
+ShmOptions shard_options(const ShmOptions& base) {
+    ShmOptions o = base;
+    if (base.shard_count > 1) {
+        std::string suffix = std::to_string(base.shard);
+        o.name += "_" + suffix;
+        if (!o.file.empty())
+            o.file += "." + suffix;
+    }
+    return o;
+}
+
+namespace {
+
+uint32_t fnv1a(const char* s) {
+    uint32_t h = 2166136261u;
+    for (const unsigned char* p = reinterpret_cast<const unsigned char*>(s); *p; ++p) {
+        h ^= *p;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+size_t slot_of(const char* login) {
+    // Перемешиваем, чтобы слот в каталоге не повторял номер сегмента
+    return (fnv1a(login) * 2654435761u) & (DIRECTORY_SIZE - 1);
+}
+
+} // namespace
+
+int shard_of(const std::string& login, int shard_count) {
+    return shard_count > 1 ? static_cast<int>(fnv1a(login.c_str()) % shard_count) : 0;
+}
+
+ShardDirectory::ShardDirectory(bool create, const ShmOptions& base, int shard_count)
+    : name(base.file.empty() ? base.name + "_dir" : base.file + ".dir"),
+      file_backed(!base.file.empty()), owner(create), fd(-1), dir(nullptr)
+{
+    int flags = create ? (O_CREAT | O_RDWR) : O_RDWR;
+    fd = file_backed ? open(name.c_str(), flags, 0666) : shm_open(name.c_str(), flags, 0666);
+    if (fd < 0) throw std::runtime_error("shard directory not found: " + name);
+
+    struct stat st;
+    if (create) {
+        if (ftruncate(fd, sizeof(ShardDirectoryRoot)) != 0) {
+            close(fd);
+            throw std::runtime_error("ftruncate failed");
+        }
+    } else if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(ShardDirectoryRoot))) {
+        close(fd);
+        throw std::runtime_error("shard directory has wrong size; server version mismatch?");
+    }
+
+    void* addr = mmap(nullptr, sizeof(ShardDirectoryRoot), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED) {
+        close(fd);
+        throw std::runtime_error("mmap failed");
+    }
+    dir = reinterpret_cast<ShardDirectoryRoot*>(addr);
+
+    if (create) {
+        // Каталог всегда собирается заново: сегменты при тёплом старте
+        // сами перезаписывают в него своих клиентов
+        dir->magic = 0;
+        pthread_mutexattr_t mattr;
+        pthread_mutexattr_init(&mattr);
+        pthread_mutexattr_setpshared(&mattr, PTHREAD_PROCESS_SHARED);
+        pthread_mutexattr_setrobust(&mattr, PTHREAD_MUTEX_ROBUST);
+        pthread_mutex_init(&dir->mutex, &mattr);
+        pthread_mutexattr_destroy(&mattr);
+
+        for (size_t i = 0; i < DIRECTORY_SIZE; ++i) {
+            dir->entries[i].shard = DIRECTORY_FREE;
+            std::memset(dir->entries[i].login, 0, LOGIN_MAX);
+        }
+        dir->shard_count = static_cast<uint32_t>(shard_count);
+        dir->server_pid = getpid();
+        dir->magic = DIRECTORY_MAGIC;
+    } else if (dir->magic != DIRECTORY_MAGIC || dir->shard_count < 1 ||
+               dir->shard_count > MAX_SHARDS) {
+        munmap(dir, sizeof(ShardDirectoryRoot));
+        close(fd);
+        throw std::runtime_error("shard directory is not initialized");
+    }
+}
+
+ShardDirectory::~ShardDirectory() {
+    if (dir) munmap(dir, sizeof(ShardDirectoryRoot));
+    if (fd >= 0) close(fd);
+    if (owner && !file_backed) shm_unlink(name.c_str());
+}
+
+bool ShardDirectory::alive() const {
+    return dir->server_pid > 0 && (kill(dir->server_pid, 0) == 0 || errno == EPERM);
+}
+
+void ShardDirectory::lock() {
+    // Всякое изменение таблицы - одно присваивание shard (логин пишется в
+    // ещё не действующую запись), поэтому после смерти владельца таблица
+    // согласована и чинить нечего
+    if (pthread_mutex_lock(&dir->mutex) == EOWNERDEAD)
+        pthread_mutex_consistent(&dir->mutex);
+}
+
+size_t ShardDirectory::find(const std::string& login) const {
+    size_t i = slot_of(login.c_str());
+    size_t vacant = DIRECTORY_SIZE;
+    for (size_t n = 0; n < DIRECTORY_SIZE; ++n, i = (i + 1) & (DIRECTORY_SIZE - 1)) {
+        const DirectoryEntry& e = dir->entries[i];
+        if (e.shard == DIRECTORY_FREE)
+            return vacant < DIRECTORY_SIZE ? vacant : i;
+        if (e.shard == DIRECTORY_REMOVED) {
+            if (vacant == DIRECTORY_SIZE)
+                vacant = i;
+        } else if (std::strncmp(e.login, login.c_str(), LOGIN_MAX) == 0) {
+            return i;
+        }
+    }
+    return vacant;
+}
+
+int ShardDirectory::lookup(const std::string& login) {
+    lock();
+    size_t i = find(login);
+    int shard = i < DIRECTORY_SIZE && dir->entries[i].shard >= 0 ? dir->entries[i].shard : -1;
+    pthread_mutex_unlock(&dir->mutex);
+    return shard;
+}
+
+bool ShardDirectory::assign(const std::string& login, int shard) {
+    lock();
+    size_t i = find(login);
+    if (i < DIRECTORY_SIZE) {
+        DirectoryEntry& e = dir->entries[i];
+        // Свободная запись становится действующей только с присваиванием shard
+        if (e.shard < 0)
+            std::strncpy(e.login, login.c_str(), LOGIN_MAX - 1);
+        e.shard = static_cast<int16_t>(shard);
+    }
+    pthread_mutex_unlock(&dir->mutex);
+    return i < DIRECTORY_SIZE;
+}
+
+void ShardDirectory::release(const std::string& login, int shard) {
+    lock();
+    size_t i = find(login);
+    if (i < DIRECTORY_SIZE && dir->entries[i].shard == shard) {
+        // Надгробие - одно присваивание. Если за ним цепочка кончается,
+        // надгробия в её хвосте снова становятся свободными записями (тоже
+        // по одному присваиванию), и цепочки не растут от входов и выходов
+        dir->entries[i].shard = DIRECTORY_REMOVED;
+        if (dir->entries[(i + 1) & (DIRECTORY_SIZE - 1)].shard == DIRECTORY_FREE) {
+            for (size_t j = i; dir->entries[j].shard == DIRECTORY_REMOVED;
+                 j = (j - 1) & (DIRECTORY_SIZE - 1))
+                dir->entries[j].shard = DIRECTORY_FREE;
+        }
+    }
+    pthread_mutex_unlock(&dir->mutex);
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include "SharedMemory.hpp"
+#include <pthread.h>
+#include <sys/types.h>
+#include <string>
+
+constexpr int MAX_SHARDS = 16;
+constexpr uint32_t DIRECTORY_MAGIC = 0x42534452; // "BSDR"
+// Открытая адресация с линейным пробированием; степень двойки, вдвое больше всех слотов
+constexpr size_t DIRECTORY_SIZE = 2 * MAX_SHARDS * MAX_CLIENTS;
+
+// Запись никогда не была занята: на ней цепочка пробирования кончается
+constexpr int16_t DIRECTORY_FREE = -1;
+// Запись снята (надгробие): цепочка идёт дальше, новая запись может её занять
+constexpr int16_t DIRECTORY_REMOVED = -2;
+
+struct DirectoryEntry {
+    char login[LOGIN_MAX];
+    // Сегмент игрока, DIRECTORY_FREE или DIRECTORY_REMOVED. Только это поле
+    // делает запись действующей, и меняется оно одним присваиванием
+    int16_t shard;
+};
+
+// Каталог: логин -> сегмент. Нужен только при входе, выходе и приглашении
+// игрока с другого сегмента, поэтому его блокировка не стоит на пути партий.
+struct ShardDirectoryRoot {
+    uint32_t magic;
+    uint32_t shard_count;
+    // Родительский процесс сервера: по нему клиент отличает живой каталог от брошенного
+    pid_t server_pid;
+    pthread_mutex_t mutex;
+    DirectoryEntry entries[DIRECTORY_SIZE];
+};
+
+// Опции сегмента base.shard; при одном сегменте имена не меняются
+ShmOptions shard_options(const ShmOptions& base);
+// Сегмент по умолчанию для логина (FNV-1a)
+int shard_of(const std::string& login, int shard_count);
+
+class ShardDirectory {
+public:
+    // create: родитель сервера создаёт пустой каталог на shard_count сегментов
+    ShardDirectory(bool create, const ShmOptions& base, int shard_count = 0);
+    ~ShardDirectory();
+
+    int shard_count() const { return static_cast<int>(dir->shard_count); }
+    // Процесс, создавший каталог, ещё жив
+    bool alive() const;
+
+    // -1, если игрок не зарегистрирован ни на одном сегменте
+    int lookup(const std::string& login);
+    // false, если каталог переполнен
+    bool assign(const std::string& login, int shard);
+    // Снимает запись, только если она всё ещё указывает на shard:
+    // игрок мог уже перейти на другой сегмент
+    void release(const std::string& login, int shard);
+
+private:
+    std::string name;
+    bool file_backed;
+    bool owner;
+    int fd;
+    ShardDirectoryRoot* dir;
+
+    void lock();
+    // Действующая запись логина, иначе первое место, куда его можно вписать
+    // (надгробие или свободная запись); DIRECTORY_SIZE, если мест нет
+    size_t find(const std::string& login) const;
+};
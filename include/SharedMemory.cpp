@@ -1,34 +1,372 @@
 #include "SharedMemory.hpp"
+#include <linux/magic.h>
+#include <signal.h>
+#include <sys/statfs.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <ctime>
+#include <fstream>
 #include <iostream>
+#include <sstream>
 
-SharedMemory::SharedMemory(bool create)
-    : fd(-1), _root(nullptr), owner(false)
+namespace {
+
+constexpr size_t THP_SIZE = 2 * 1024 * 1024;
+
+size_t round_up(size_t n, size_t to) {
+    return (n + to - 1) / to * to;
+}
+
+} // namespace
+
+SharedMemory::SharedMemory(bool create, const ShmOptions& opts)
+    : opts(opts), fd(-1), _root(nullptr), owner(false), existed(false), map_size(0),
+      page_size(static_cast<size_t>(sysconf(_SC_PAGESIZE))), hugetlb(false), locked(false)
 {
-    bool do_create = create;
-    if (do_create) {
-        fd = shm_open(SHM_NAME, O_CREAT | O_RDWR, 0666);
-        if (fd < 0) throw std::runtime_error("shm_open create failed");
-        if (ftruncate(fd, sizeof(SharedMemoryRoot)) != 0) {
+    bool file_backed = !opts.file.empty();
+    const char* what = file_backed ? opts.file.c_str() : opts.name.c_str();
+
+    if (create) {
+        fd = file_backed ? open(what, O_CREAT | O_RDWR, 0666)
+                         : shm_open(what, O_CREAT | O_RDWR, 0666);
+        if (fd < 0) throw std::runtime_error(std::string("shm_open create failed: ") + what);
+    } else {
+        fd = file_backed ? open(what, O_RDWR) : shm_open(what, O_RDWR, 0666);
+        if (fd < 0) throw std::runtime_error("shm_open open failed; run server first");
+    }
+
+    // На hugetlbfs длина файла и отображения кратна размеру огромной страницы
+    struct statfs fs;
+    if (fstatfs(fd, &fs) == 0 && fs.f_type == HUGETLBFS_MAGIC) {
+        hugetlb = true;
+        page_size = static_cast<size_t>(fs.f_bsize);
+    } else if (opts.huge_pages) {
+        page_size = THP_SIZE;
+    }
+    map_size = round_up(sizeof(SharedMemoryRoot), page_size);
+
+    struct stat st;
+    if (create) {
+        if (fstat(fd, &st) == 0 && st.st_size >= static_cast<off_t>(sizeof(SharedMemoryRoot))) {
+            existed = true;
+        }
+        // Файл только растёт: тёплый старт с другим размером страниц не теряет состояние
+        if ((fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(map_size)) &&
+            ftruncate(fd, map_size) != 0) {
             close(fd);
             throw std::runtime_error("ftruncate failed");
         }
         owner = true;
     } else {
-        fd = shm_open(SHM_NAME, O_RDWR, 0666);
-        if (fd < 0) throw std::runtime_error("shm_open open failed; run server first");
+        if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(SharedMemoryRoot))) {
+            close(fd);
+            throw std::runtime_error("shared segment has wrong size; server version mismatch?");
+        }
+        // Клиент без --huge-pages отображает столько, сколько нужно; с ним — не больше файла
+        map_size = std::min(map_size, static_cast<size_t>(st.st_size));
     }
-    void* addr = mmap(nullptr, sizeof(SharedMemoryRoot), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+    // С MADV_HUGEPAGE страницы создаются после пометки, иначе ядро сразу возьмёт обычные
+    bool thp = opts.huge_pages && !hugetlb;
+    int flags = MAP_SHARED | (opts.populate && !thp ? MAP_POPULATE : 0);
+    void* addr = mmap(nullptr, map_size, PROT_READ | PROT_WRITE, flags, fd, 0);
     if (addr == MAP_FAILED) {
         close(fd);
         throw std::runtime_error("mmap failed");
     }
     _root = reinterpret_cast<SharedMemoryRoot*>(addr);
+
+    if (thp && madvise(addr, map_size, MADV_HUGEPAGE) != 0)
+        std::cerr << "madvise(MADV_HUGEPAGE) failed: " << std::strerror(errno) << std::endl;
+    if (thp && opts.populate)
+        prefault();
+    if (opts.lock_memory) {
+        locked = mlock(addr, map_size) == 0;
+        if (!locked)
+            std::cerr << "mlock failed (RLIMIT_MEMLOCK?): " << std::strerror(errno) << std::endl;
+    }
 }
 
 SharedMemory::~SharedMemory() {
-    if (_root) munmap(_root, sizeof(SharedMemoryRoot));
+    if (_root) munmap(_root, map_size);
     if (fd >= 0) close(fd);
-    if (owner) {
-        shm_unlink(SHM_NAME);
+    if (owner && !is_persistent()) {
+        shm_unlink(opts.name.c_str());
+    }
+}
+
+void SharedMemory::prefault() {
+#ifdef MADV_POPULATE_WRITE
+    if (madvise(_root, map_size, MADV_POPULATE_WRITE) == 0)
+        return;
+#endif
+    // Старое ядро: читаем по байту со страницы. Разделяемое отображение
+    // сразу получает запись, так что повторного сбоя на запись не будет
+    const volatile char* p = reinterpret_cast<const volatile char*>(_root);
+    for (size_t off = 0; off < map_size; off += static_cast<size_t>(sysconf(_SC_PAGESIZE)))
+        (void)p[off];
+}
+
+std::string SharedMemory::mapping_report() const {
+    std::ostringstream ss;
+    ss << (opts.file.empty() ? opts.name : opts.file) << ": " << sizeof(SharedMemoryRoot)
+       << " bytes in " << map_size / 1024 << " kB mapping, "
+       << (hugetlb ? "hugetlbfs" : opts.huge_pages ? "THP requested" : "base pages");
+
+    // Запись smaps нашего отображения: адрес начала совпадает с _root
+    std::ifstream smaps("/proc/self/smaps");
+    std::string line;
+    bool ours = false;
+    uintptr_t base = reinterpret_cast<uintptr_t>(_root);
+    while (std::getline(smaps, line)) {
+        if (!line.empty() && std::isxdigit(static_cast<unsigned char>(line[0])) &&
+            line.find('-') != std::string::npos && line.find(':') > line.find(' ')) {
+            ours = std::stoull(line.substr(0, line.find('-')), nullptr, 16) == base;
+            continue;
+        }
+        if (!ours)
+            continue;
+        for (const char* key : {"KernelPageSize:", "Rss:", "ShmemPmdMapped:", "FilePmdMapped:",
+                                "Locked:"}) {
+            if (line.compare(0, std::strlen(key), key) == 0) {
+                std::string value = line.substr(std::strlen(key));
+                value.erase(0, value.find_first_not_of(' '));
+                ss << ", " << std::string(key, std::strlen(key) - 1) << " " << value;
+            }
+        }
+    }
+    if (opts.lock_memory && !locked)
+        ss << ", mlock failed";
+    return ss.str();
+}
+
+bool SharedMemory::has_valid_state() const {
+    return existed && _root->magic == SHM_MAGIC &&
+           _root->layout_version == SHM_LAYOUT_VERSION &&
+           _root->root_size == sizeof(SharedMemoryRoot);
+}
+
+namespace {
+
+uint64_t monotonic_now_ns() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + ts.tv_nsec;
+}
+
+void recover_if_owner_died(SharedMemoryRoot* root, int rc) {
+    if (rc == EOWNERDEAD) {
+        pthread_mutex_consistent(&root->mutex);
+        repair_root(root);
+    } else if (rc != 0 && rc != ETIMEDOUT) {
+        throw std::runtime_error("shared mutex is not recoverable");
+    }
+}
+
+} // namespace
+
+void lock_root(SharedMemoryRoot* root) {
+    recover_if_owner_died(root, pthread_mutex_lock(&root->mutex));
+}
+
+void wait_root(SharedMemoryRoot* root, pthread_cond_t* cond) {
+    recover_if_owner_died(root, pthread_cond_wait(cond, &root->mutex));
+}
+
+bool wait_root_for(SharedMemoryRoot* root, pthread_cond_t* cond, uint64_t timeout_ns) {
+    // Разделяемые условные переменные ждут по CLOCK_REALTIME
+    timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    uint64_t ns = deadline.tv_nsec + timeout_ns;
+    deadline.tv_sec += static_cast<time_t>(ns / 1000000000ull);
+    deadline.tv_nsec = static_cast<long>(ns % 1000000000ull);
+    int rc = pthread_cond_timedwait(cond, &root->mutex, &deadline);
+    recover_if_owner_died(root, rc);
+    return rc != ETIMEDOUT;
+}
+
+bool enqueue_root(SharedMemoryRoot* root, const Message& m) {
+    RequestLane lane = lane_of(m.type);
+    uint64_t ticket;
+    Message* slot = claim_root(root, lane, m.sender, false, 0, ticket);
+    if (!slot)
+        return false;
+    // Состояние, claimer и sender уже выставлены резервированием
+    std::memcpy(slot->from, m.from, LOGIN_MAX);
+    std::memcpy(slot->to, m.to, LOGIN_MAX);
+    slot->type = m.type;
+    std::memcpy(slot->payload, m.payload, CMD_MAX);
+    return commit_root(root, lane, slot, ticket);
+}
+
+Message* claim_root(SharedMemoryRoot* root, RequestLane lane, int16_t sender, bool quota,
+                    uint64_t timeout_ns, uint64_t& ticket) {
+    ClientSlot* owner = sender >= 0 && static_cast<size_t>(sender) < MAX_CLIENTS
+                            ? &root->clients[sender]
+                            : nullptr;
+    SharedMemoryRoot::RequestQueue& q = root->lanes[lane];
+    uint64_t deadline = monotonic_now_ns() + timeout_ns;
+    lock_root(root);
+
+    for (;;) {
+        bool full = (q.tail + 1) % QUEUE_SIZE == q.head;
+        if (!full && !(quota && owner && owner->in_flight[lane] >= CLIENT_QUEUE_QUOTA))
+            break;
+        // Место может держать отправитель, умерший посреди заполнения
+        if (full && reclaim_abandoned_root(root) > 0)
+            continue;
+        uint64_t now = monotonic_now_ns();
+        if (now >= deadline) {
+            pthread_mutex_unlock(&root->mutex);
+            return nullptr;
+        }
+        root->queue_waiters++;
+        wait_root_for(root, &root->queue_cond, deadline - now);
+        root->queue_waiters--;
+    }
+    Message* m = &q.entries[q.tail];
+    m->state = MSG_FILLING;
+    m->claimer = getpid();
+    m->ticket = ticket = ++q.tickets;
+    m->sender = owner ? sender : NO_SENDER;
+    if (owner)
+        owner->in_flight[lane]++;
+    q.tail = (q.tail + 1) % QUEUE_SIZE;
+    pthread_mutex_unlock(&root->mutex);
+    return m;
+}
+
+bool commit_root(SharedMemoryRoot* root, RequestLane lane, Message* m, uint64_t ticket) {
+    uint64_t now = monotonic_now_ns();
+    lock_root(root);
+    // Запись могли снять при починке индексов или у отправителя, сочтённого
+    // мёртвым (pid переиспользован), и отдать другому: чужую не публикуем
+    bool ours = m->state == MSG_FILLING && m->ticket == ticket;
+    if (ours) {
+        m->t_ns = now;
+        m->state = MSG_READY;
+        root->lanes[lane].ready++;
+        pthread_cond_signal(&root->server_cond);
     }
+    pthread_mutex_unlock(&root->mutex);
+    return ours;
+}
+
+namespace {
+
+void free_entry(SharedMemoryRoot* root, RequestLane lane, Message& m) {
+    m.state = MSG_FREE;
+    if (m.sender >= 0 && static_cast<size_t>(m.sender) < MAX_CLIENTS &&
+        root->clients[m.sender].in_flight[lane] > 0)
+        root->clients[m.sender].in_flight[lane]--;
+}
+
+void advance_head(SharedMemoryRoot::RequestQueue& q) {
+    // Голова проходит через все уже разобранные записи
+    while (q.head != q.tail && q.entries[q.head].state == MSG_FREE)
+        q.head = (q.head + 1) % QUEUE_SIZE;
+}
+
+bool in_window(const SharedMemoryRoot::RequestQueue& q, size_t i) {
+    return q.head <= q.tail ? (i >= q.head && i < q.tail) : (i >= q.head || i < q.tail);
+}
+
+// Зомби ещё отвечает на kill(pid, 0), но писать в очередь уже не будет
+bool process_alive(pid_t pid) {
+    if (pid <= 0 || (kill(pid, 0) != 0 && errno == ESRCH))
+        return false;
+    std::ifstream stat("/proc/" + std::to_string(pid) + "/stat");
+    std::string line;
+    if (!std::getline(stat, line))
+        return true;
+    size_t paren = line.rfind(')');
+    return paren == std::string::npos || paren + 2 >= line.size() || line[paren + 2] != 'Z';
+}
+
+} // namespace
+
+void release_entry_root(SharedMemoryRoot* root, RequestLane lane, size_t index) {
+    SharedMemoryRoot::RequestQueue& q = root->lanes[lane];
+    free_entry(root, lane, q.entries[index]);
+    if (q.ready > 0)
+        q.ready--;
+    advance_head(q);
+
+    if (root->queue_waiters)
+        pthread_cond_broadcast(&root->queue_cond);
+}
+
+size_t reclaim_abandoned_root(SharedMemoryRoot* root) {
+    size_t reclaimed = 0;
+    for (size_t lane = 0; lane < LANE_COUNT; ++lane) {
+        SharedMemoryRoot::RequestQueue& q = root->lanes[lane];
+        for (size_t i = q.head; i != q.tail; i = (i + 1) % QUEUE_SIZE) {
+            Message& m = q.entries[i];
+            if (m.state == MSG_FILLING && !process_alive(m.claimer)) {
+                free_entry(root, static_cast<RequestLane>(lane), m);
+                reclaimed++;
+            }
+        }
+        advance_head(q);
+    }
+    if (reclaimed && root->queue_waiters)
+        pthread_cond_broadcast(&root->queue_cond);
+    return reclaimed;
+}
+
+bool requests_pending_root(const SharedMemoryRoot* root) {
+    for (const SharedMemoryRoot::RequestQueue& q : root->lanes) {
+        if (q.ready > 0)
+            return true;
+    }
+    return false;
+}
+
+void repair_root(SharedMemoryRoot* root) {
+    // Под мьютексом клиент только резервирует запись или читает ответ:
+    // достаточно вернуть индексы в допустимый диапазон и снять пометки вне
+    // окна очереди. Записи, которые мёртвый отправитель не успел заполнить,
+    // снимает reclaim_abandoned_root. Квоты и число опубликованных записей
+    // пересчитываются по тому, что действительно осталось в очередях
+    for (size_t i = 0; i < MAX_CLIENTS; ++i) {
+        for (uint16_t& n : root->clients[i].in_flight)
+            n = 0;
+    }
+    for (size_t lane = 0; lane < LANE_COUNT; ++lane) {
+        SharedMemoryRoot::RequestQueue& q = root->lanes[lane];
+        if (q.head >= QUEUE_SIZE || q.tail >= QUEUE_SIZE) {
+            q.head = q.tail = 0;
+        }
+        q.ready = 0;
+        for (size_t i = 0; i < QUEUE_SIZE; ++i) {
+            Message& m = q.entries[i];
+            if (!in_window(q, i) || m.state > MSG_READY) {
+                m.state = MSG_FREE;
+            }
+            m.from[LOGIN_MAX - 1] = '\0';
+            m.to[LOGIN_MAX - 1] = '\0';
+            m.payload[CMD_MAX - 1] = '\0';
+            if (m.state == MSG_FREE)
+                continue;
+            q.ready += m.state == MSG_READY;
+            if (m.sender >= 0 && static_cast<size_t>(m.sender) < MAX_CLIENTS)
+                root->clients[m.sender].in_flight[lane]++;
+        }
+    }
+    reclaim_abandoned_root(root);
+
+    for (size_t i = 0; i < MAX_CLIENTS; ++i) {
+        ClientSlot& c = root->clients[i];
+        c.login[LOGIN_MAX - 1] = '\0';
+        c.response[RESP_MAX - 1] = '\0';
+        if (c.has_response && c.response[0] == '\0') {
+            c.has_response = false;
+        }
+    }
+
+    root->lock_recoveries++;
+    std::cerr << "Shared mutex recovered after owner death (total "
+              << root->lock_recoveries << ")" << std::endl;
 }
@@ -9,16 +9,83 @@
 #include <string>
 #include <iostream>
 
+struct ShmOptions {
+    std::string name = SHM_NAME;
+    // Если задан, сегмент отображается из обычного файла вместо shm_open
+    std::string file;
+    // Не удалять сегмент при завершении сервера (файловый сегмент не удаляется никогда)
+    bool persist = false;
+    // Огромные страницы. Файл на hugetlbfs (--file /dev/hugepages/...) распознаётся
+    // сам по себе; для shm отображение выравнивается по 2 МБ и помечается MADV_HUGEPAGE
+    bool huge_pages = false;
+    // Создать все страницы при отображении, а не при первом касании
+    bool populate = false;
+    // mlock: сегмент не вытесняется в своп
+    bool lock_memory = false;
+    // Номер сегмента и их общее число (--shards); имя сегмента даёт shard_options()
+    int shard = 0;
+    int shard_count = 1;
+};
+
 class SharedMemory {
 public:
-    SharedMemory(bool create = false);
+    SharedMemory(bool create = false, const ShmOptions& opts = ShmOptions());
     ~SharedMemory();
 
     SharedMemoryRoot* root() { return _root; }
     bool is_owner() const { return owner; }
+    // Сегмент существовал до запуска и содержит корректно инициализированное состояние
+    bool has_valid_state() const;
+    bool is_persistent() const { return !opts.file.empty() || opts.persist; }
+    size_t mapping_size() const { return map_size; }
+    // Размер отображения и страниц, сколько памяти резидентно, на огромных страницах
+    // и закреплено (по /proc/self/smaps) — то, что ядро дало на самом деле
+    std::string mapping_report() const;
 
 private:
+    ShmOptions opts;
     int fd;
     SharedMemoryRoot* _root;
     bool owner;
+    bool existed;
+    size_t map_size;
+    size_t page_size;
+    bool hugetlb;
+    bool locked;
+
+    void prefault();
 };
+
+// Захват root->mutex (robust). Если владелец умер внутри критической секции,
+// мьютекс помечается согласованным, а очередь и слоты клиентов чинятся.
+void lock_root(SharedMemoryRoot* root);
+// pthread_cond_wait на root->mutex с тем же восстановлением
+void wait_root(SharedMemoryRoot* root, pthread_cond_t* cond);
+// То же с ограничением timeout_ns (pthread_cond_timedwait); false по таймауту
+bool wait_root_for(SharedMemoryRoot* root, pthread_cond_t* cond, uint64_t timeout_ns);
+void repair_root(SharedMemoryRoot* root);
+// Кладёт сообщение в очередь сервера по его типу (lane_of) без ожидания и
+// без квоты (m.sender задаёт только очередь отправителя при разборе); false,
+// если очередь заполнена
+bool enqueue_root(SharedMemoryRoot* root, const Message& m);
+// Резервирует место в хвосте очереди lane: под мьютексом запись помечается
+// MSG_FILLING и tail сдвигается, заполнять её можно уже без мьютекса, прямо
+// в сегменте. С quota клиент sender ждёт, пока у него в этой очереди меньше
+// CLIENT_QUEUE_QUOTA записей (считая резервированные); места в очереди ждут
+// все. Ожидание не дольше timeout_ns, потом nullptr. ticket - номер этого
+// резервирования, его ждёт commit_root
+Message* claim_root(SharedMemoryRoot* root, RequestLane lane, int16_t sender, bool quota,
+                    uint64_t timeout_ns, uint64_t& ticket);
+// Публикует заполненную запись из claim_root той же очереди (MSG_READY) и
+// будит сервер; мьютекс берётся только на это. Запись, которую за это время
+// сняли или отдали другому (другой ticket), не трогается; тогда false
+bool commit_root(SharedMemoryRoot* root, RequestLane lane, Message* m, uint64_t ticket);
+// Сервер закончил с записью index очереди lane, которую разбирал на месте:
+// место и квота освобождаются, ждущие отправители просыпаются. Вызывается
+// под root->mutex
+void release_entry_root(SharedMemoryRoot* root, RequestLane lane, size_t index);
+// Снимает записи MSG_FILLING, чей процесс умер, не опубликовав их; сколько
+// снято. Под root->mutex
+size_t reclaim_abandoned_root(SharedMemoryRoot* root);
+// Есть ли опубликованные записи хотя бы в одной очереди; под root->mutex
+bool requests_pending_root(const SharedMemoryRoot* root);
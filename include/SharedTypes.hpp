@@ -1,17 +1,62 @@
 #pragma once
 #include <pthread.h>
+#include <sys/types.h>
 #include <cstdint>
 #include <cstring>
 
 constexpr const char* SHM_NAME = "/battleship_shm_v3";
+constexpr uint32_t SHM_MAGIC = 0x42534852; // "BSHR"
+constexpr uint32_t SHM_LAYOUT_VERSION = 15;
 constexpr size_t MAX_CLIENTS = 32;
+// Размер каждой из очередей запросов (см. RequestLane)
 constexpr size_t QUEUE_SIZE = 128;
+// Сколько записей одного клиента может одновременно стоять в одной очереди
+constexpr uint16_t CLIENT_QUEUE_QUOTA = 8;
 constexpr size_t LOGIN_MAX = 32;
 constexpr size_t CMD_MAX = 256;
 constexpr size_t RESP_MAX = 512;
+constexpr size_t EVENT_QUEUE_SIZE = 32;
+constexpr size_t REPLAY_QUEUE_SIZE = 64;
+constexpr size_t MAX_GAMES = 256;
 
+// Логин встроенного бота; клиенты не могут зарегистрироваться под ним.
+// Боты турниров получают логины с тем же префиксом: "[bot]exact#3"
+constexpr const char* BOT_LOGIN = "[bot]";
+
+inline bool is_bot_login(const char* login) {
+    return std::strncmp(login, BOT_LOGIN, std::strlen(BOT_LOGIN)) == 0;
+}
+
+// Номер игры, который видят клиенты, - дескриптор: младшие биты - слот в
+// games, старшие - поколение слота. Слот отдаётся новой игре сразу, а
+// поколение меняется, поэтому запоздалое сообщение со старым номером не
+// попадает в чужую партию. Поколение не бывает нулём: -1 остаётся "нет игры"
+constexpr int GAME_SLOT_BITS = 8;
+static_assert(MAX_GAMES == size_t(1) << GAME_SLOT_BITS, "slot bits must cover MAX_GAMES");
+constexpr uint32_t GAME_GENERATION_MASK = (uint32_t(1) << (31 - GAME_SLOT_BITS)) - 1;
+
+inline int make_game_handle(size_t slot, uint32_t generation) {
+    return static_cast<int>(((generation & GAME_GENERATION_MASK) << GAME_SLOT_BITS) | slot);
+}
+inline size_t game_slot(int handle) {
+    return static_cast<uint32_t>(handle) & (MAX_GAMES - 1);
+}
+inline uint32_t game_generation(int handle) {
+    return static_cast<uint32_t>(handle) >> GAME_SLOT_BITS;
+}
+inline uint32_t next_generation(uint32_t generation) {
+    generation = (generation + 1) & GAME_GENERATION_MASK;
+    return generation ? generation : 1;
+}
+
+// Классическое поле: на нём играют боты, решатель и битборды
 constexpr int BOARD_SIZE = 10;
-constexpr int MAX_SHIPS = 10;
+// Слот игры вмещает самое большое поле и самый большой флот из Rules.hpp
+constexpr int MAX_BOARD_SIZE = 16;
+constexpr int MAX_SHIPS = 16;
+constexpr int MAX_SHIP_SIZE = 5;
+// Больше выстрелов за партию не бывает: каждый открывает новую клетку
+constexpr size_t PUBLIC_LOG_SIZE = 2 * MAX_BOARD_SIZE * MAX_BOARD_SIZE;
 
 enum CellState : uint8_t {
     CELL_EMPTY = 0,
@@ -44,7 +89,27 @@ struct Ship {
     bool sunk;
 };
 
+// Выстрел в открытом журнале партии
+struct PublicShot {
+    // 1 или 2: какой игрок стрелял
+    uint8_t shooter;
+    uint8_t x;
+    uint8_t y;
+    // ShotResult
+    uint8_t result;
+};
+
 struct GameData {
+    // Seqlock-счётчик: сервер увеличивает его до и после каждого изменения,
+    // клиенты читают слот напрямую (см. read_game_snapshot). Зрители ждут
+    // его изменения через futex
+    uint32_t seq;
+    // Сколько зрителей ждут на seq; сервер будит их, только если они есть.
+    // Стоит до used и не обнуляется новой игрой в слоте: зрители прежней
+    // игры вычитают себя сами, когда заметят смену
+    uint32_t watchers;
+    // Поколение слота: растёт при каждой новой игре в нём (см. make_game_handle)
+    uint32_t generation;
     bool used;
     char game_name[LOGIN_MAX];
     char player1[LOGIN_MAX];
@@ -52,14 +117,20 @@ struct GameData {
     GameState state;
     char current_turn[LOGIN_MAX];
     bool is_public;
+    // RulesId: размер поля и состав флота (см. rules_info); поле занимает
+    // левый верхний угол досок
+    uint8_t rules;
     
-    CellState board1[BOARD_SIZE][BOARD_SIZE];
-    CellState board2[BOARD_SIZE][BOARD_SIZE];
+    CellState board1[MAX_BOARD_SIZE][MAX_BOARD_SIZE];
+    CellState board2[MAX_BOARD_SIZE][MAX_BOARD_SIZE];
     
     Ship ships1[MAX_SHIPS];
     Ship ships2[MAX_SHIPS];
     uint8_t ship_count1;
     uint8_t ship_count2;
+    // Игрок подтвердил расстановку (ready)
+    bool ready1;
+    bool ready2;
     
     uint8_t hits1;
     uint8_t hits2;
@@ -70,6 +141,10 @@ struct GameData {
     
     time_t start_time;
     time_t end_time;
+
+    // Все выстрелы партии по порядку; только дописывается
+    PublicShot shots[PUBLIC_LOG_SIZE];
+    uint16_t shot_count;
 };
 
 enum MsgType : uint8_t {
@@ -88,37 +163,202 @@ enum MsgType : uint8_t {
     MSG_GAME_STATUS = 12,
     MSG_CREATE = 13,
     MSG_JOIN = 14,
-    MSG_LEAVE_GAME = 15
+    MSG_LEAVE_GAME = 15,
+    MSG_QUICK_MATCH = 18,
+    MSG_PLAY_BOT = 19,
+    // Случайная расстановка всего флота за один запрос
+    MSG_RANDOM_FLEET = 20,
+    MSG_SPECTATE = 21,
+    MSG_TOURNAMENT = 22,
+    MSG_LEADERBOARD = 23,
+    // Пустой payload - список завершённых партий, "<номер> [скорость|all]" - повтор
+    MSG_REPLAY = 24,
+    // Ожидание и обработка запросов по очередям
+    MSG_METRICS = 25,
+    // Внутреннее: процесс клиента завершился (payload = pid)
+    MSG_CLIENT_GONE = 17
+};
+
+// Запросы идут двумя очередями. Игровая (выстрелы, расстановка, готовность)
+// разбирается первой; лобби и служебные - когда игровая пуста или слишком
+// долго ждут (см. Server::next_lane)
+enum RequestLane : uint8_t {
+    LANE_GAME = 0,
+    LANE_LOBBY = 1
+};
+constexpr size_t LANE_COUNT = 2;
+
+inline RequestLane lane_of(uint8_t type) {
+    switch (type) {
+    case MSG_SHOT:
+    case MSG_PLACE_SHIP:
+    case MSG_RANDOM_FLEET:
+    case MSG_SETUP_COMPLETE:
+    case MSG_SURRENDER:
+    case MSG_GET_BOARD:
+    case MSG_GET_OPPONENT_BOARD:
+    case MSG_GAME_STATUS:
+        return LANE_GAME;
+    default:
+        return LANE_LOBBY;
+    }
+}
+
+// Отправитель записи очереди, у которого нет слота клиента (регистрация, сервер)
+constexpr int16_t NO_SENDER = -1;
+
+// Запись очереди резервируется под мьютексом (FILLING), заполняется
+// отправителем без него и публикуется в READY; сервер берёт только READY
+enum MessageState : uint8_t {
+    MSG_FREE = 0,
+    MSG_FILLING = 1,
+    MSG_READY = 2
 };
 
 struct Message {
-    bool used;
+    uint8_t state;
+    // Процесс, зарезервировавший запись: если он умер, не опубликовав её,
+    // запись снимается (reclaim_abandoned_root)
+    pid_t claimer;
+    // Номер резервирования: commit_root публикует запись, только если её
+    // не сняли и не зарезервировали заново, пока она заполнялась
+    uint64_t ticket;
     char from[LOGIN_MAX];
     char to[LOGIN_MAX];
     uint8_t type;
+    // Номер слота клиента в clients или NO_SENDER: по нему считается квота
+    // и идёт круговой разбор очереди
+    int16_t sender;
+    // Когда запись опубликована (CLOCK_MONOTONIC): от него считается ожидание
+    uint64_t t_ns;
     char payload[CMD_MAX];
 };
 
+enum EventType : uint8_t {
+    EVT_NONE = 0,
+    EVT_OPPONENT_JOINED = 1,
+    EVT_GAME_STARTED = 2,
+    EVT_YOUR_TURN = 3,
+    EVT_INCOMING_SHOT = 4,
+    EVT_GAME_OVER = 5,
+    // Турнир назначил игроку партию: game_id, who = соперник
+    EVT_MATCH_ASSIGNED = 6
+};
+
+enum ShotResult : uint8_t {
+    SHOT_MISS = 0,
+    SHOT_HIT = 1,
+    SHOT_SUNK = 2
+};
+
+// Записи журнала партии; в том же виде они приходят клиенту при повторе
+enum JournalRecordType : uint8_t {
+    JR_PLAYER = 1, // seat, login
+    JR_LEAVE = 2,  // seat
+    JR_PLACE = 3,  // seat, size, x, y, horizontal
+    JR_CLEAR = 4,  // seat
+    JR_READY = 5,  // seat
+    JR_SHOT = 6,   // seat, x, y, ShotResult
+    JR_END = 7,    // seat победителя (0 — нет), JournalEndReason
+    JR_RULES = 8   // RulesId (в result); первая запись журнала
+};
+
+enum JournalEndReason : uint8_t {
+    JOURNAL_END_SUNK = 0,
+    JOURNAL_END_SURRENDER = 1,
+    // Игра удалена без результата: вышли, отключились, не доиграли
+    JOURNAL_END_CLOSED = 2
+};
+
+// Кадр повтора партии: одна запись журнала. Кадр REPLAY_DONE закрывает поток
+constexpr uint8_t REPLAY_DONE = 0;
+
+struct ReplayFrame {
+    // Номер потока из ответа REPLAY: кадры прерванного повтора отбрасываются
+    uint16_t stream;
+    // JournalRecordType или REPLAY_DONE
+    uint8_t type;
+    uint8_t seat;
+    uint8_t x;
+    uint8_t y;
+    uint8_t size;
+    // ShotResult для JR_SHOT, JournalEndReason для JR_END, RulesId для JR_RULES
+    uint8_t result;
+    bool horizontal;
+    // Миллисекунды от начала партии
+    uint32_t t_ms;
+    char login[LOGIN_MAX];
+};
+
+// Событие, которое сервер сам кладёт во входящий ящик клиента
+struct GameEvent {
+    uint8_t type;
+    uint8_t x;
+    uint8_t y;
+    // ShotResult для EVT_INCOMING_SHOT, 1 = победа для EVT_GAME_OVER
+    uint8_t result;
+    int32_t game_id;
+    char who[LOGIN_MAX];
+};
+
 struct ClientSlot {
+    // Растёт при каждой регистрации в слоте: клиент запоминает свой слот и
+    // проверяет, что он всё ещё его, одним сравнением
+    uint32_t generation;
     bool used;
     char login[LOGIN_MAX];
+    pid_t pid;
     pthread_cond_t cond;
     char response[RESP_MAX];
     bool has_response;
     int current_game_id;
     bool setup_complete;
+    // Записи этого слота в очередях сервера (см. CLIENT_QUEUE_QUOTA)
+    uint16_t in_flight[LANE_COUNT];
+
+    // Кольцо событий: пишет только сервер (ev_tail), читает только клиент (ev_head)
+    GameEvent events[EVENT_QUEUE_SIZE];
+    uint32_t ev_head;
+    uint32_t ev_tail;
+    // Кольцо кадров повтора: пишет только поток повторов сервера (rp_tail)
+    ReplayFrame replay[REPLAY_QUEUE_SIZE];
+    uint32_t rp_head;
+    uint32_t rp_tail;
+    // futex-слово: увеличивается при каждом событии и каждом ответе
+    uint32_t notify_seq;
 };
 
 struct SharedMemoryRoot {
+    // Заполняется сервером последним: по нему перезапущенный сервер
+    // решает, можно ли подхватить состояние сегмента
+    uint32_t magic;
+    uint32_t layout_version;
+    uint64_t root_size;
+
     pthread_mutex_t mutex;
     pthread_cond_t server_cond;
+    // Сколько раз мьютекс восстанавливался после смерти владельца
+    uint64_t lock_recoveries;
     
-    Message queue[QUEUE_SIZE];
-    size_t q_head;
-    size_t q_tail;
+    // Сервер разбирает записи очереди не строго по порядку (круговой обход
+    // по отправителям): разобранные освобождаются на месте, head сдвигается
+    // через них, когда до них доходит. Окно [head, tail) включает и ещё
+    // заполняемые записи; ready — сколько в нём опубликованных
+    struct RequestQueue {
+        Message entries[QUEUE_SIZE];
+        size_t head;
+        size_t tail;
+        uint32_t ready;
+        // Последний выданный номер резервирования (Message::ticket)
+        uint64_t tickets;
+    };
+    RequestQueue lanes[LANE_COUNT];
+    // Ждут места в очереди или в своей квоте
+    pthread_cond_t queue_cond;
+    uint32_t queue_waiters;
     
     ClientSlot clients[MAX_CLIENTS];
     
-    GameData games[16];
+    GameData games[MAX_GAMES];
     size_t game_count;
 };
\ No newline at end of file
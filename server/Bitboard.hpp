@@ -0,0 +1,133 @@
+#pragma once
+#include <cstdint>
+
+#include "../include/SharedTypes.hpp"
+
+// Доска 10x10 в одном 128-битном слове. Строка занимает 11 бит, старший
+// (11-й) всегда ноль: сдвиг на 1 не переносит клетку в соседнюю строку,
+// сдвиг на STRIDE двигает на строку вверх/вниз.
+struct Bitboard {
+    using word = unsigned __int128;
+
+    static constexpr int STRIDE = BOARD_SIZE + 1;
+
+    word bits;
+
+    constexpr Bitboard() : bits(0) {}
+    constexpr explicit Bitboard(word b) : bits(b) {}
+
+    static Bitboard valid() {
+        word row = (word(1) << BOARD_SIZE) - 1;
+        word b = 0;
+        for (int y = 0; y < BOARD_SIZE; y++)
+            b |= row << (y * STRIDE);
+        return Bitboard(b);
+    }
+
+    static int index(int x, int y) { return y * STRIDE + x; }
+
+    void set(int x, int y) { bits |= word(1) << index(x, y); }
+    bool test(int x, int y) const { return (bits >> index(x, y)) & 1; }
+    bool empty() const { return bits == 0; }
+
+    int count() const {
+        return __builtin_popcountll(static_cast<uint64_t>(bits)) +
+               __builtin_popcountll(static_cast<uint64_t>(bits >> 64));
+    }
+
+    // Номер младшей установленной клетки; доска не должна быть пустой
+    int lowest() const {
+        uint64_t lo = static_cast<uint64_t>(bits);
+        if (lo)
+            return __builtin_ctzll(lo);
+        return 64 + __builtin_ctzll(static_cast<uint64_t>(bits >> 64));
+    }
+
+    // n-я по счёту установленная клетка (n < count())
+    int nth(int n) const {
+        word b = bits;
+        int lo_count = __builtin_popcountll(static_cast<uint64_t>(b));
+        if (n >= lo_count) {
+            b >>= 64;
+            b <<= 64;
+            n -= lo_count;
+        }
+        for (; n > 0; n--)
+            b &= b - 1;
+        return Bitboard(b).lowest();
+    }
+
+    Bitboard operator|(Bitboard o) const { return Bitboard(bits | o.bits); }
+    Bitboard operator&(Bitboard o) const { return Bitboard(bits & o.bits); }
+    Bitboard operator~() const { return Bitboard(~bits); }
+    Bitboard operator<<(int n) const { return Bitboard(bits << n); }
+    Bitboard operator>>(int n) const { return Bitboard(bits >> n); }
+    Bitboard& operator|=(Bitboard o) { bits |= o.bits; return *this; }
+    Bitboard& operator&=(Bitboard o) { bits &= o.bits; return *this; }
+};
+
+// Клетки, из которых помещается корабль длины size в направлении step
+// (1 = по горизонтали, STRIDE = по вертикали), если все его клетки в free
+inline Bitboard ship_starts(Bitboard free, int size, int step) {
+    Bitboard starts = free;
+    for (int k = 1; k < size; k++)
+        starts &= free >> (k * step);
+    return starts;
+}
+
+// Клетки доски, покрытые кораблями длины size с началами в starts
+inline Bitboard ship_cover(Bitboard starts, int size, int step) {
+    Bitboard cover;
+    for (int k = 0; k < size; k++)
+        cover |= starts << (k * step);
+    return cover;
+}
+
+// Клетки с соседями по горизонтали, вертикали и диагонали (включая сами клетки)
+inline Bitboard neighbourhood(Bitboard b) {
+    Bitboard valid = Bitboard::valid();
+    Bitboard rows = (b | (b << 1) | (b >> 1)) & valid;
+    return (rows | (rows << Bitboard::STRIDE) | (rows >> Bitboard::STRIDE)) & valid;
+}
+
+// Только диагональные соседи
+inline Bitboard diagonals(Bitboard b) {
+    Bitboard valid = Bitboard::valid();
+    Bitboard sides = ((b << 1) | (b >> 1)) & valid;
+    return ((sides << Bitboard::STRIDE) | (sides >> Bitboard::STRIDE)) & valid;
+}
+
+// Поклеточные счётчики в битовых срезах: planes[i] хранит i-й бит счётчика
+// каждой клетки, так что прибавление доски — несколько операций над словами
+struct BitCounter {
+    static constexpr int PLANES = 7;
+
+    Bitboard planes[PLANES];
+
+    void add(Bitboard b) {
+        Bitboard carry = b;
+        for (int i = 0; i < PLANES && !carry.empty(); i++) {
+            Bitboard t = planes[i] & carry;
+            planes[i] = Bitboard(planes[i].bits ^ carry.bits);
+            carry = t;
+        }
+    }
+
+    // Клетки из candidates с наибольшим значением счётчика
+    Bitboard argmax(Bitboard candidates) const {
+        for (int i = PLANES - 1; i >= 0; i--) {
+            Bitboard t = candidates & planes[i];
+            if (!t.empty())
+                candidates = t;
+        }
+        return candidates;
+    }
+
+    bool any(Bitboard mask) const {
+        for (const Bitboard& p : planes) {
+            if (!(p & mask).empty())
+                return true;
+        }
+        return false;
+    }
+};
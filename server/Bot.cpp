@@ -0,0 +1,169 @@
+#include "Bot.hpp"
+#include "Game.hpp"
+
+namespace {
+
+constexpr double MIN_SOLVER_SAMPLES = 1000;
+
+Bitboard checkerboard() {
+    Bitboard b;
+    for (int y = 0; y < BOARD_SIZE; y++) {
+        for (int x = (y & 1); x < BOARD_SIZE; x += 2)
+            b.set(x, y);
+    }
+    return b;
+}
+
+} // namespace
+
+const char* bot_strategy_name(BotStrategy s) {
+    switch (s) {
+    case BOT_RANDOM: return "random";
+    case BOT_HUNT_TARGET: return "hunt";
+    case BOT_DENSITY: return "density";
+    case BOT_EXACT: return "exact";
+    }
+    return "?";
+}
+
+bool parse_bot_strategy(const std::string& name, BotStrategy& out) {
+    for (BotStrategy s : {BOT_RANDOM, BOT_HUNT_TARGET, BOT_DENSITY, BOT_EXACT}) {
+        if (name == bot_strategy_name(s)) {
+            out = s;
+            return true;
+        }
+    }
+    return false;
+}
+
+Bot::Bot(uint64_t seed, BotStrategy strategy, const SolverOptions& solver_opts)
+    : rng(seed ? seed : 0x9E3779B97F4A7C15ull), strategy(strategy), solver(solver_opts),
+      fleets(seed ^ 0xA0761D6478BD642Full) {}
+
+uint64_t Bot::next() {
+    // xorshift64*
+    rng ^= rng >> 12;
+    rng ^= rng << 25;
+    rng ^= rng >> 27;
+    return rng * 0x2545F4914F6CDD1Dull;
+}
+
+int Bot::pick(Bitboard b) {
+    return b.nth(static_cast<int>(next() % b.count()));
+}
+
+bool Bot::place_fleet(Game& game, const std::string& login) {
+    Fleet fleet;
+    fleets.generate(fleet);
+    for (const FleetShip& s : fleet.ships) {
+        if (!game.place_ship(login, s.size, s.x, s.y, s.horizontal))
+            return false;
+    }
+    return true;
+}
+
+bool Bot::choose_open_cell(const CellState view[MAX_BOARD_SIZE][MAX_BOARD_SIZE], int width,
+                           int height, uint8_t& x, uint8_t& y) {
+    int open = 0;
+    for (int cy = 0; cy < height; cy++) {
+        for (int cx = 0; cx < width; cx++)
+            open += view[cy][cx] == CELL_EMPTY;
+    }
+    if (open == 0)
+        return false;
+    int n = static_cast<int>(next() % open);
+    for (int cy = 0; cy < height; cy++) {
+        for (int cx = 0; cx < width; cx++) {
+            if (view[cy][cx] == CELL_EMPTY && n-- == 0) {
+                x = static_cast<uint8_t>(cx);
+                y = static_cast<uint8_t>(cy);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool Bot::choose_shot(const CellState view[MAX_BOARD_SIZE][MAX_BOARD_SIZE], uint8_t& x, uint8_t& y) {
+    if (strategy != BOT_EXACT)
+        return choose_shot(view, nullptr, x, y);
+    SolverResult exact;
+    bool solved = solver.solve(read_board(view), next(), exact);
+    return choose_shot(view, solved ? &exact : nullptr, x, y);
+}
+
+bool Bot::choose_shot(const CellState view[MAX_BOARD_SIZE][MAX_BOARD_SIZE],
+                      const SolverResult* solved, uint8_t& x, uint8_t& y) {
+    BoardKnowledge k = read_board(view);
+    if (k.unknown.empty())
+        return false;
+
+    if (strategy == BOT_RANDOM) {
+        int cell = pick(k.unknown);
+        x = static_cast<uint8_t>(cell % Bitboard::STRIDE);
+        y = static_cast<uint8_t>(cell / Bitboard::STRIDE);
+        return true;
+    }
+
+    // Малая выборка шумнее карты плотности: тогда стреляем по карте
+    if (strategy == BOT_EXACT && solved &&
+        (solved->exact || solved->configurations >= MIN_SOLVER_SAMPLES)) {
+        double best = -1;
+        for (int cy = 0; cy < BOARD_SIZE; cy++) {
+            for (int cx = 0; cx < BOARD_SIZE; cx++) {
+                if (k.unknown.test(cx, cy) && solved->probability[cy][cx] > best) {
+                    best = solved->probability[cy][cx];
+                    x = static_cast<uint8_t>(cx);
+                    y = static_cast<uint8_t>(cy);
+                }
+            }
+        }
+        return true;
+    }
+
+    const Bitboard unknown = k.unknown;
+    const Bitboard hits = k.hits;
+    const Bitboard free = k.free;
+    const int* remaining = k.remaining;
+
+    BitCounter hunt, target;
+    for (int size = 1; size <= 4; size++) {
+        for (int step : {1, Bitboard::STRIDE}) {
+            if (size == 1 && step != 1)
+                break;
+
+            Bitboard starts = ship_starts(free, size, step);
+            // Положения, проходящие хотя бы через одно попадание
+            Bitboard hit_starts;
+            for (int k = 0; k < size; k++)
+                hit_starts |= hits >> (k * step);
+            hit_starts &= starts;
+
+            for (int r = 0; r < remaining[size]; r++) {
+                for (int k = 0; k < size; k++) {
+                    hunt.add(starts << (k * step));
+                    if (!hit_starts.empty())
+                        target.add(hit_starts << (k * step));
+                }
+            }
+        }
+    }
+
+    Bitboard best;
+    if (target.any(unknown)) {
+        best = target.argmax(unknown);
+    } else if (strategy == BOT_HUNT_TARGET) {
+        // Самый короткий корабль длиннее 1 всегда задевает чёрную клетку
+        best = unknown & free & checkerboard();
+        if (best.empty())
+            best = unknown & free;
+        if (best.empty())
+            best = unknown;
+    } else {
+        best = hunt.argmax(unknown);
+    }
+    int cell = pick(best);
+    x = static_cast<uint8_t>(cell % Bitboard::STRIDE);
+    y = static_cast<uint8_t>(cell / Bitboard::STRIDE);
+    return true;
+}
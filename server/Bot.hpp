@@ -0,0 +1,60 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+#include "../include/SharedTypes.hpp"
+#include "Bitboard.hpp"
+#include "FleetGenerator.hpp"
+#include "Solver.hpp"
+
+class Game;
+
+enum BotStrategy : uint8_t {
+    // Случайная нетронутая клетка
+    BOT_RANDOM = 0,
+    // Охота по шахматной раскраске, добивание по карте плотности
+    BOT_HUNT_TARGET = 1,
+    // Карта плотности и при охоте, и при добивании
+    BOT_DENSITY = 2,
+    // Точные вероятности по всем согласованным расстановкам (Solver)
+    BOT_EXACT = 3
+};
+
+const char* bot_strategy_name(BotStrategy s);
+// false, если имя не распознано
+bool parse_bot_strategy(const std::string& name, BotStrategy& out);
+
+// Встроенный соперник. Играет через обычный интерфейс Game и видит только
+// то же, что видел бы игрок: промахи, попадания и потопленные корабли.
+// Выстрел выбирается по карте плотности: для каждой клетки считается, сколько
+// допустимых положений оставшихся кораблей её покрывают (охота), а если есть
+// раненый корабль — только положений через известные попадания (добивание).
+class Bot {
+  public:
+    explicit Bot(uint64_t seed, BotStrategy strategy = BOT_DENSITY,
+                 const SolverOptions& solver_opts = SolverOptions());
+
+    // Равномерно случайная расстановка флота через Game::place_ship
+    bool place_fleet(Game& game, const std::string& login);
+    // false, если стрелять некуда
+    // Только классическое поле BOARD_SIZE x BOARD_SIZE в углу view
+    bool choose_shot(const CellState view[MAX_BOARD_SIZE][MAX_BOARD_SIZE], uint8_t& x, uint8_t& y);
+    // То же по вероятностям, посчитанным заранее (SolverWorker); без них или
+    // по слишком малой выборке - по карте плотности
+    bool choose_shot(const CellState view[MAX_BOARD_SIZE][MAX_BOARD_SIZE],
+                     const SolverResult* solved, uint8_t& x, uint8_t& y);
+    // Ходу нужен перебор Solver
+    bool wants_solver() const { return strategy == BOT_EXACT; }
+    // Случайная нетронутая клетка поля любых правил; false, если таких нет
+    bool choose_open_cell(const CellState view[MAX_BOARD_SIZE][MAX_BOARD_SIZE], int width,
+                          int height, uint8_t& x, uint8_t& y);
+
+  private:
+    uint64_t rng;
+    BotStrategy strategy;
+    Solver solver;
+    FleetGenerator fleets;
+
+    uint64_t next();
+    int pick(Bitboard b);
+};
@@ -0,0 +1,154 @@
+#include "ClientReaper.hpp"
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+#include "../include/SharedMemory.hpp"
+
+#ifndef SYS_pidfd_open
+#define SYS_pidfd_open 434
+#endif
+
+namespace {
+
+constexpr uint64_t STOP_TOKEN = ~0ull;
+
+int pidfd_open(pid_t pid) {
+    return static_cast<int>(syscall(SYS_pidfd_open, pid, 0));
+}
+
+} // namespace
+
+ClientReaper::ClientReaper(SharedMemoryRoot* root) : root(root), epoll_fd(-1), stop_fd(-1) {
+    for (size_t i = 0; i < MAX_CLIENTS; ++i) {
+        pidfds[i] = -1;
+        pids[i] = 0;
+        generations[i] = 0;
+    }
+
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    stop_fd = eventfd(0, EFD_CLOEXEC);
+    if (epoll_fd < 0 || stop_fd < 0)
+        throw std::runtime_error("epoll/eventfd setup failed");
+
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.u64 = STOP_TOKEN;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, stop_fd, &ev);
+}
+
+ClientReaper::~ClientReaper() {
+    if (worker.joinable()) {
+        uint64_t one = 1;
+        if (write(stop_fd, &one, sizeof(one)) == sizeof(one))
+            worker.join();
+        else
+            worker.detach();
+    }
+    for (size_t i = 0; i < MAX_CLIENTS; ++i) {
+        if (pidfds[i] >= 0)
+            close(pidfds[i]);
+    }
+    close(stop_fd);
+    close(epoll_fd);
+}
+
+void ClientReaper::start() {
+    if (!worker.joinable())
+        worker = std::thread(&ClientReaper::loop, this);
+}
+
+bool ClientReaper::watch(size_t slot, pid_t pid) {
+    // Без рабочего потока (например, при воспроизведении трассы) не следим
+    if (!worker.joinable())
+        return true;
+
+    std::lock_guard<std::mutex> guard(lock);
+
+    if (pidfds[slot] >= 0 && pids[slot] == pid)
+        return true;
+    if (pidfds[slot] >= 0)
+        close(pidfds[slot]);
+    pidfds[slot] = -1;
+    generations[slot]++;
+
+    int fd = pidfd_open(pid);
+    if (fd < 0)
+        return errno != ESRCH;
+
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.u64 = (static_cast<uint64_t>(generations[slot]) << 32) | slot;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+        close(fd);
+        return true;
+    }
+    pidfds[slot] = fd;
+    pids[slot] = pid;
+    return true;
+}
+
+void ClientReaper::unwatch(size_t slot) {
+    std::lock_guard<std::mutex> guard(lock);
+    if (pidfds[slot] >= 0)
+        close(pidfds[slot]);
+    pidfds[slot] = -1;
+    pids[slot] = 0;
+    generations[slot]++;
+}
+
+void ClientReaper::loop() {
+    epoll_event events[16];
+    while (true) {
+        int n = epoll_wait(epoll_fd, events, 16, -1);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return;
+        }
+
+        for (int i = 0; i < n; ++i) {
+            if (events[i].data.u64 == STOP_TOKEN)
+                return;
+
+            size_t slot = events[i].data.u64 & 0xffffffffu;
+            uint32_t gen = static_cast<uint32_t>(events[i].data.u64 >> 32);
+            pid_t pid;
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                // Слот мог быть освобождён или переназначен, пока событие ждало
+                if (slot >= MAX_CLIENTS || generations[slot] != gen || pidfds[slot] < 0)
+                    continue;
+                close(pidfds[slot]);
+                pidfds[slot] = -1;
+                pid = pids[slot];
+                generations[slot]++;
+            }
+            post_gone(slot, pid);
+        }
+    }
+}
+
+void ClientReaper::post_gone(size_t slot, pid_t pid) {
+    Message m;
+    std::memset(&m, 0, sizeof(m));
+    m.type = MSG_CLIENT_GONE;
+    // В очереди этого клиента: разбирается после его последних команд
+    m.sender = static_cast<int16_t>(slot);
+    std::snprintf(m.payload, CMD_MAX, "%d", static_cast<int>(pid));
+
+    lock_root(root);
+    std::strncpy(m.from, root->clients[slot].login, LOGIN_MAX - 1);
+    pthread_mutex_unlock(&root->mutex);
+
+    while (!enqueue_root(root, m)) {
+        usleep(1000);
+    }
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <sys/types.h>
+
+#include <mutex>
+#include <thread>
+
+#include "../include/SharedTypes.hpp"
+
+// Следит за процессами клиентов через pidfd в epoll. Когда процесс
+// завершается, в очередь сервера кладётся MSG_CLIENT_GONE, так что слот
+// освобождается в основном цикле сервера, как и любая другая команда.
+class ClientReaper {
+  public:
+    explicit ClientReaper(SharedMemoryRoot* root);
+    ~ClientReaper();
+
+    void start();
+    // false, если процесса уже нет
+    bool watch(size_t slot, pid_t pid);
+    void unwatch(size_t slot);
+
+  private:
+    SharedMemoryRoot* root;
+    int epoll_fd;
+    int stop_fd;
+    std::thread worker;
+
+    std::mutex lock;
+    int pidfds[MAX_CLIENTS];
+    pid_t pids[MAX_CLIENTS];
+    uint32_t generations[MAX_CLIENTS];
+
+    void loop();
+    void post_gone(size_t slot, pid_t pid);
+};
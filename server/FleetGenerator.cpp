@@ -0,0 +1,534 @@
+#include "FleetGenerator.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <type_traits>
+#include <vector>
+
+namespace {
+
+// Поле правил Rules как массив 64-битных слов. Строка занимает WIDTH + 1
+// бит, лишний столбец всегда пуст (как у Bitboard): сдвиг на 1 не переносит
+// корабль в соседнюю строку, сдвиг на STRIDE двигает его на строку.
+template <class Rules>
+struct CellMask {
+    static constexpr int STRIDE = Rules::WIDTH + 1;
+    static constexpr int CELLS = Rules::HEIGHT * STRIDE;
+    static constexpr int WORDS = (CELLS + 63) / 64;
+
+    uint64_t w[WORDS] = {};
+
+    void set(int cell) { w[cell / 64] |= uint64_t(1) << (cell % 64); }
+
+    void remove(const CellMask& o) {
+        for (int i = 0; i < WORDS; i++)
+            w[i] &= ~o.w[i];
+    }
+
+    CellMask& operator&=(const CellMask& o) {
+        for (int i = 0; i < WORDS; i++)
+            w[i] &= o.w[i];
+        return *this;
+    }
+
+    int count() const {
+        int n = 0;
+        for (int i = 0; i < WORDS; i++)
+            n += __builtin_popcountll(w[i]);
+        return n;
+    }
+
+    // На месте клетки c оказывается клетка c + N
+    template <int N>
+    CellMask shifted() const {
+        constexpr int WORD = N / 64;
+        constexpr int BIT = N % 64;
+        CellMask res;
+        for (int i = 0; i + WORD < WORDS; i++) {
+            if constexpr (BIT == 0) {
+                res.w[i] = w[i + WORD];
+            } else {
+                uint64_t hi = i + WORD + 1 < WORDS ? w[i + WORD + 1] : 0;
+                res.w[i] = (w[i + WORD] >> BIT) | (hi << (64 - BIT));
+            }
+        }
+        return res;
+    }
+};
+
+// Клетки, из которых корабль длины SIZE в направлении STEP (1 - вправо,
+// STRIDE - вниз) целиком лежит в free
+template <int SIZE, int STEP, class Mask>
+Mask placement_starts(const Mask& free) {
+    if constexpr (SIZE == 1) {
+        return free;
+    } else {
+        Mask res = placement_starts<SIZE - 1, STEP>(free.template shifted<STEP>());
+        res &= free;
+        return res;
+    }
+}
+
+// Положения корабля длины SIZE на поле free: starts[0] - начала
+// горизонтальных, starts[1] - вертикальных (у однопалубного их нет)
+template <int SIZE, class Mask>
+int find_placements(const Mask& free, Mask* starts) {
+    Mask h = placement_starts<SIZE, 1>(free);
+    int n = h.count();
+    Mask v;
+    if constexpr (SIZE > 1) {
+        v = placement_starts<SIZE, Mask::STRIDE>(free);
+        n += v.count();
+    }
+    if (starts) {
+        starts[0] = h;
+        starts[1] = v;
+    }
+    return n;
+}
+
+static_assert(MAX_SHIP_SIZE == 5, "find_placements() dispatch covers sizes 1..5");
+
+template <class Mask>
+int find_placements(int size, const Mask& free, Mask* starts) {
+    switch (size) {
+    case 1:
+        return find_placements<1>(free, starts);
+    case 2:
+        return find_placements<2>(free, starts);
+    case 3:
+        return find_placements<3>(free, starts);
+    case 4:
+        return find_placements<4>(free, starts);
+    default:
+        return find_placements<5>(free, starts);
+    }
+}
+
+// bit[v][n] - номер n-го установленного бита байта v
+struct ByteSelect {
+    uint8_t bit[256][8];
+
+    constexpr ByteSelect() : bit() {
+        for (int v = 0; v < 256; v++) {
+            int n = 0;
+            for (int b = 0; b < 8; b++) {
+                if ((v >> b) & 1)
+                    bit[v][n++] = static_cast<uint8_t>(b);
+            }
+        }
+    }
+};
+
+constexpr ByteSelect BYTE_SELECT;
+
+// Номер n-го установленного бита слова (n < числа битов): байт находится
+// по префиксным суммам счётчиков байтов, бит в нём - по таблице
+int select_bit(uint64_t w, int n) {
+    constexpr uint64_t ONES = 0x0101010101010101ull;
+    constexpr uint64_t HIGH = 0x8080808080808080ull;
+    uint64_t c = w - ((w >> 1) & 0x5555555555555555ull);
+    c = (c & 0x3333333333333333ull) + ((c >> 2) & 0x3333333333333333ull);
+    c = (c + (c >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+    // Байт k - число битов в байтах 0..k
+    uint64_t prefix = c * ONES;
+    // Старший бит байта k поднят, если в байтах 0..k не больше n битов
+    uint64_t passed = (((static_cast<uint64_t>(n) * ONES) | HIGH) - prefix) & HIGH;
+    int byte = static_cast<int>(((passed >> 7) * ONES) >> 56);
+    int skipped = static_cast<int>(((prefix << 8) >> (8 * byte)) & 0xFF);
+    return 8 * byte + BYTE_SELECT.bit[(w >> (8 * byte)) & 0xFF][n - skipped];
+}
+
+// Корабли флота от длинных к коротким. lost[i][j] - сколько положений
+// корабля j наверняка пропадёт, пока ставятся корабли i..j-1: положения
+// его длины, лежащие целиком внутри поставленных кораблей
+template <class Rules>
+struct ShipOrder {
+    static constexpr int SHIPS = fleet_ship_count<Rules>();
+
+    int size[SHIPS];
+    int lost[SHIPS + 1][SHIPS];
+
+    constexpr ShipOrder() : size(), lost() {
+        int i = 0;
+        for (int s = MAX_SHIP_SIZE; s >= 1; s--) {
+            for (int k = 0; k < Rules::FLEET[s]; k++)
+                size[i++] = s;
+        }
+        for (int from = 0; from <= SHIPS; from++) {
+            for (int j = from; j < SHIPS; j++) {
+                for (int k = from; k < j; k++)
+                    lost[from][j] += size[k] - size[j] + 1;
+            }
+        }
+    }
+};
+
+// Оценки кораблей одной длины перемножаются в 64 битах
+template <class Rules>
+constexpr bool group_bounds_fit() {
+    for (int s = 1; s <= MAX_SHIP_SIZE; s++) {
+        uint64_t placements = static_cast<uint64_t>((Rules::WIDTH - s + 1) * Rules::HEIGHT);
+        if (s > 1)
+            placements += static_cast<uint64_t>(Rules::WIDTH * (Rules::HEIGHT - s + 1));
+        uint64_t product = 1;
+        for (int k = 0; k < Rules::FLEET[s]; k++) {
+            if (product > UINT64_MAX / placements)
+                return false;
+            product *= placements;
+        }
+    }
+    return true;
+}
+
+// Маски всех положений кораблей и таблица первых кораблей флота
+template <class Rules>
+struct FleetTables {
+    using Mask = CellMask<Rules>;
+    using PlacementId = std::conditional_t<(2 * Mask::CELLS <= 256), uint8_t, uint16_t>;
+
+    static constexpr int SHIPS = fleet_ship_count<Rules>();
+    static constexpr ShipOrder<Rules> ORDER{};
+    // Таблица первых кораблей: не глубже и не больше этого
+    static constexpr int MAX_PREFIX = 3;
+    static constexpr size_t PREFIX_LIMIT = size_t(1) << 20;
+
+    static_assert(group_bounds_fit<Rules>(), "fleet group bounds overflow 64 bits");
+
+    // Положение: номер клетки начала, у вертикальных ещё + CELLS
+    struct PrefixEntry {
+        // below64(total) < threshold - берутся свои корабли, иначе other
+        uint64_t threshold;
+        PlacementId self[MAX_PREFIX];
+        PlacementId other[MAX_PREFIX];
+    };
+
+    Mask valid;
+    // Клетки, которые корабль занимает, и его окрестность, если касаться нельзя
+    Mask blocked[MAX_SHIP_SIZE + 1][2 * Mask::CELLS];
+    // Первые depth кораблей берутся из prefix с вероятностью, пропорциональной
+    // оценке числа продолжений (метод псевдонимов: одна выборка на попытку)
+    int depth = 0;
+    uint64_t total = 0;
+    std::vector<PrefixEntry> prefix;
+
+    static const FleetTables& get() {
+        static const FleetTables tables;
+        return tables;
+    }
+
+    FleetTables() {
+        for (int y = 0; y < Rules::HEIGHT; y++) {
+            for (int x = 0; x < Rules::WIDTH; x++)
+                valid.set(y * Mask::STRIDE + x);
+        }
+        int halo = Rules::SHIPS_MAY_TOUCH ? 0 : 1;
+        for (int size = 1; size <= MAX_SHIP_SIZE; size++) {
+            for (int id = 0; id < 2 * Mask::CELLS; id++) {
+                bool vertical = id >= Mask::CELLS;
+                int cell = id % Mask::CELLS;
+                int x0 = cell % Mask::STRIDE;
+                int y0 = cell / Mask::STRIDE;
+                int x1 = vertical ? x0 : x0 + size - 1;
+                int y1 = vertical ? y0 + size - 1 : y0;
+                if (x1 >= Rules::WIDTH || y1 >= Rules::HEIGHT)
+                    continue;
+                int top = std::max(0, y0 - halo);
+                int bottom = std::min(Rules::HEIGHT - 1, y1 + halo);
+                int left = std::max(0, x0 - halo);
+                int right = std::min(Rules::WIDTH - 1, x1 + halo);
+                for (int y = top; y <= bottom; y++) {
+                    for (int x = left; x <= right; x++)
+                        blocked[size][id].set(y * Mask::STRIDE + x);
+                }
+            }
+        }
+        build_prefix();
+    }
+
+    static FleetShip ship(int size, int id) {
+        int cell = id % Mask::CELLS;
+        return FleetShip{static_cast<uint8_t>(size), static_cast<uint8_t>(cell % Mask::STRIDE),
+                         static_cast<uint8_t>(cell / Mask::STRIDE), id < Mask::CELLS};
+    }
+
+    // Сколько положений у каждой длины кораблей from..SHIPS-1; starts -
+    // положения корабля from
+    static void count_rest(const Mask& free, int from, int* count, Mask* starts) {
+        for (int j = from; j < SHIPS; j++) {
+            int size = ORDER.size[j];
+            if (j == from || size != ORDER.size[j - 1])
+                count[size] = find_placements(size, free, j == from ? starts : nullptr);
+        }
+    }
+
+    // Оценка числа способов поставить корабли from..SHIPS-1: произведение
+    // числа их положений сейчас за вычетом тех, что наверняка пропадут.
+    // false, если не помещается в 64 бита
+    static bool bound(const Mask& free, int from, uint64_t& out) {
+        int count[MAX_SHIP_SIZE + 1];
+        count_rest(free, from, count, nullptr);
+        out = 1;
+        for (int j = from; j < SHIPS; j++) {
+            int left = count[ORDER.size[j]] - ORDER.lost[from][j];
+            if (left <= 0) {
+                out = 0;
+                return true;
+            }
+            if (__builtin_mul_overflow(out, static_cast<uint64_t>(left), &out))
+                return false;
+        }
+        return true;
+    }
+
+    // Обходит допустимые положения кораблей k..last-1 (одинаковые - по
+    // возрастанию номера, чтобы каждый набор встретился один раз);
+    // visit(free, ids) возвращает false, чтобы прервать обход
+    template <class Visit>
+    bool walk(int k, int last, const Mask& free, PlacementId* ids, Visit& visit) const {
+        if (k == last)
+            return visit(free, ids);
+        int size = ORDER.size[k];
+        Mask starts[2];
+        find_placements(size, free, starts);
+        int first = k > 0 && ORDER.size[k - 1] == size ? ids[k - 1] + 1 : 0;
+        for (int o = 0; o < 2; o++) {
+            for (int i = 0; i < Mask::WORDS; i++) {
+                for (uint64_t bits = starts[o].w[i]; bits; bits &= bits - 1) {
+                    int id = o * Mask::CELLS + i * 64 + __builtin_ctzll(bits);
+                    if (id < first)
+                        continue;
+                    ids[k] = static_cast<PlacementId>(id);
+                    Mask next = free;
+                    next.remove(blocked[size][id]);
+                    if (!walk(k + 1, last, next, ids, visit))
+                        return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    // Самая глубокая таблица не больше PREFIX_LIMIT записей, чей суммарный
+    // вес помещается в 64 бита; если такой нет, все корабли ставятся по одному
+    void build_prefix() {
+        PlacementId ids[SHIPS];
+        int deepest = 0;
+        for (int d = 1; d <= std::min(SHIPS, MAX_PREFIX); d++) {
+            size_t n = 0;
+            auto counter = [&](const Mask&, const PlacementId*) { return ++n <= PREFIX_LIMIT; };
+            if (!walk(0, d, valid, ids, counter))
+                break;
+            deepest = d;
+        }
+        for (int d = deepest; d > 0; d--) {
+            if (fill_prefix(d)) {
+                depth = d;
+                return;
+            }
+        }
+    }
+
+    bool fill_prefix(int d) {
+        std::vector<uint64_t> weights;
+        std::vector<PlacementId> layouts;
+        uint64_t sum = 0;
+        PlacementId ids[SHIPS];
+        auto add = [&](const Mask& free, const PlacementId* placed) {
+            uint64_t w;
+            if (!bound(free, d, w) || __builtin_add_overflow(sum, w, &sum))
+                return false;
+            if (w) {
+                weights.push_back(w);
+                layouts.insert(layouts.end(), placed, placed + d);
+            }
+            return true;
+        };
+        if (!walk(0, d, valid, ids, add))
+            return false;
+
+        // Метод псевдонимов в целых числах: у каждой записи ёмкость sum,
+        // вес записи i, умноженный на n, раскладывается по ним без остатка
+        size_t n = weights.size();
+        std::vector<unsigned __int128> scaled(n);
+        std::vector<size_t> small, large;
+        prefix.assign(n, PrefixEntry{});
+        for (size_t i = 0; i < n; i++) {
+            scaled[i] = static_cast<unsigned __int128>(weights[i]) * n;
+            prefix[i].threshold = sum;
+            std::copy(&layouts[i * d], &layouts[i * d] + d, prefix[i].self);
+            std::copy(&layouts[i * d], &layouts[i * d] + d, prefix[i].other);
+            (scaled[i] < sum ? small : large).push_back(i);
+        }
+        while (!small.empty() && !large.empty()) {
+            size_t s = small.back();
+            small.pop_back();
+            size_t l = large.back();
+            large.pop_back();
+            prefix[s].threshold = static_cast<uint64_t>(scaled[s]);
+            std::copy(prefix[l].self, prefix[l].self + d, prefix[s].other);
+            scaled[l] -= sum - scaled[s];
+            (scaled[l] < sum ? small : large).push_back(l);
+        }
+        total = sum;
+        return true;
+    }
+};
+
+template <class Mask>
+int nth_placement(const Mask* starts, int r) {
+    for (int o = 0; o < 2; o++) {
+        for (int i = 0; i < Mask::WORDS; i++) {
+            int n = __builtin_popcountll(starts[o].w[i]);
+            if (r < n)
+                return o * Mask::CELLS + i * 64 + select_bit(starts[o].w[i], r);
+            r -= n;
+        }
+    }
+    return -1;
+}
+
+uint64_t splitmix64(uint64_t& s) {
+    uint64_t z = (s += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+} // namespace
+
+FleetGenerator::FleetGenerator(uint64_t seed) : tries(0) {
+    state[0] = splitmix64(seed);
+    state[1] = splitmix64(seed);
+    // Таблицы строятся заранее, а не на первой расстановке
+    FleetTables<ClassicRules>::get();
+    FleetTables<LargeRules>::get();
+}
+
+uint64_t FleetGenerator::next() {
+    // xorshift128+
+    uint64_t a = state[0];
+    uint64_t b = state[1];
+    state[0] = b;
+    a ^= a << 23;
+    state[1] = a ^ b ^ (a >> 17) ^ (b >> 26);
+    return state[1] + b;
+}
+
+// Метод Лемира: старшая половина произведения, значения из неполного
+// последнего круга отбрасываются
+uint32_t FleetGenerator::below(uint32_t n) {
+    uint64_t m = (next() >> 32) * n;
+    if (static_cast<uint32_t>(m) < n) {
+        uint32_t floor = -n % n;
+        while (static_cast<uint32_t>(m) < floor)
+            m = (next() >> 32) * n;
+    }
+    return static_cast<uint32_t>(m >> 32);
+}
+
+uint64_t FleetGenerator::below64(uint64_t n) {
+    unsigned __int128 m = static_cast<unsigned __int128>(next()) * n;
+    if (static_cast<uint64_t>(m) < n) {
+        uint64_t floor = -n % n;
+        while (static_cast<uint64_t>(m) < floor)
+            m = static_cast<unsigned __int128>(next()) * n;
+    }
+    return static_cast<uint64_t>(m >> 64);
+}
+
+// Одна попытка. Пусть B(i) - оценка числа способов поставить корабли i..
+// (см. FleetTables::bound): она не растёт от шага к шагу, а сумма B(i+1)
+// по всем положениям корабля i не больше B(i). Корабль берётся равновероятно
+// среди текущих положений и принимается с вероятностью B(i+1) * n / B(i),
+// где n - число положений; тогда каждый флот целиком выпадает с вероятностью
+// 1 / (сумма весов таблицы первых кораблей), одной и той же для всех
+template <class Rules>
+bool FleetGenerator::attempt(FleetShip* out) {
+    using Tables = FleetTables<Rules>;
+    using Mask = typename Tables::Mask;
+    const Tables& t = Tables::get();
+    const auto& order = Tables::ORDER;
+
+    Mask free = t.valid;
+    if (t.depth > 0) {
+        const auto& e = t.prefix[below(static_cast<uint32_t>(t.prefix.size()))];
+        const auto* ids = below64(t.total) < e.threshold ? e.self : e.other;
+        for (int i = 0; i < t.depth; i++) {
+            free.remove(t.blocked[order.size[i]][ids[i]]);
+            out[i] = Tables::ship(order.size[i], ids[i]);
+        }
+    }
+
+    int count[MAX_SHIP_SIZE + 1];
+    Mask starts[2];
+    Tables::count_rest(free, t.depth, count, starts);
+    for (int i = t.depth; i < Tables::SHIPS; i++) {
+        int size = order.size[i];
+        int id = nth_placement(starts, static_cast<int>(below(static_cast<uint32_t>(count[size]))));
+        free.remove(t.blocked[size][id]);
+        out[i] = Tables::ship(size, id);
+
+        // Отношение B(i+1) * n / B(i) - произведение по оставшимся кораблям;
+        // по монетке на каждую длину, чтобы числа помещались в 64 бита
+        for (int j = i + 1; j < Tables::SHIPS;) {
+            int s = order.size[j];
+            int now = find_placements(s, free, j == i + 1 ? starts : nullptr);
+            uint64_t num = 1;
+            uint64_t den = 1;
+            for (; j < Tables::SHIPS && order.size[j] == s; j++) {
+                int left = now - order.lost[i + 1][j];
+                if (left <= 0)
+                    return false;
+                num *= static_cast<uint64_t>(left);
+                den *= static_cast<uint64_t>(count[s] - order.lost[i][j]);
+            }
+            count[s] = now;
+            if (num < den && below64(den) >= num)
+                return false;
+        }
+    }
+    return true;
+}
+
+template <class Rules>
+void FleetGenerator::generate(RulesFleet<Rules>& out) {
+    do {
+        tries++;
+    } while (!attempt<Rules>(out.ships));
+}
+
+template void FleetGenerator::generate<ClassicRules>(RulesFleet<ClassicRules>& out);
+template void FleetGenerator::generate<LargeRules>(RulesFleet<LargeRules>& out);
+
+void FleetGenerator::generate(RulesId rules, std::vector<FleetShip>& out) {
+    switch (rules) {
+    case RULES_LARGE: {
+        RulesFleet<LargeRules> fleet;
+        generate(fleet);
+        out.assign(std::begin(fleet.ships), std::end(fleet.ships));
+        return;
+    }
+    case RULES_CLASSIC:
+        break;
+    }
+    Fleet fleet;
+    generate(fleet);
+    out.assign(std::begin(fleet.ships), std::end(fleet.ships));
+}
+
+std::string format_fleet(const Fleet& fleet) {
+    return format_fleet(fleet.ships, FLEET_SHIPS);
+}
+
+std::string format_fleet(const FleetShip* ships, size_t count) {
+    std::string res;
+    for (size_t i = 0; i < count; i++) {
+        const FleetShip& s = ships[i];
+        if (i)
+            res += ';';
+        res += std::to_string(s.size) + ',' + std::to_string(s.x) + ',' + std::to_string(s.y) +
+               ',' + (s.horizontal ? 'H' : 'V');
+    }
+    return res;
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../include/Rules.hpp"
+#include "../include/SharedTypes.hpp"
+
+struct FleetShip {
+    uint8_t size;
+    uint8_t x;
+    uint8_t y;
+    bool horizontal;
+};
+
+// Флот правил Rules, корабли от длинных к коротким
+template <class Rules>
+struct RulesFleet {
+    FleetShip ships[fleet_ship_count<Rules>()];
+};
+
+// Классический флот: 4, 3, 3, 2, 2, 2, 1, 1, 1, 1
+using Fleet = RulesFleet<ClassicRules>;
+constexpr int FLEET_SHIPS = fleet_ship_count<ClassicRules>();
+
+// Равномерно случайная допустимая расстановка флота. Корабли ставятся по
+// одному, от длинных к коротким, каждый - равновероятно среди положений,
+// допустимых на текущем поле. Чтобы итог не зависел от того, сколько
+// места осталось, каждый шаг принимается с вероятностью, равной убыли
+// верхней оценки числа продолжений; при отказе попытка начинается заново.
+// Первые длинные корабли берутся сразу из заранее перечисленных
+// расстановок с точными весами, поэтому попыток на флот около двадцати.
+// Каждая допустимая расстановка выпадает с одной и той же вероятностью.
+// Размер поля, флот и можно ли касаться берутся из правил. Таблицы общие
+// и строятся один раз на правила; генератор держит только своё случайное
+// состояние - по одному на поток.
+class FleetGenerator {
+  public:
+    explicit FleetGenerator(uint64_t seed);
+
+    template <class Rules>
+    void generate(RulesFleet<Rules>& out);
+    // Для правил, известных только во время работы
+    void generate(RulesId rules, std::vector<FleetShip>& out);
+    // Сколько попыток ушло на все расстановки с момента создания
+    uint64_t attempts() const { return tries; }
+
+  private:
+    uint64_t state[2];
+    uint64_t tries;
+
+    uint64_t next();
+    // Равномерно из [0, n) без смещения
+    uint32_t below(uint32_t n);
+    uint64_t below64(uint64_t n);
+    template <class Rules>
+    bool attempt(FleetShip* out);
+};
+
+extern template void FleetGenerator::generate<ClassicRules>(RulesFleet<ClassicRules>& out);
+extern template void FleetGenerator::generate<LargeRules>(RulesFleet<LargeRules>& out);
+
+// "4,0,0,H;3,0,5,V;..." — тот же формат корабля, что у MSG_PLACE_SHIP
+std::string format_fleet(const Fleet& fleet);
+std::string format_fleet(const FleetShip* ships, size_t count);
@@ -1,45 +1,81 @@
 #include "Game.hpp"
+#include "../include/Events.hpp"
+#include "../include/GameView.hpp"
+#include "../include/SeqLock.hpp"
+#include <cstddef>
+#include <cstring>
 #include <sstream>
 #include <iomanip>
 #include <algorithm>
 #include <iostream>
 
-Game::Game(const std::string& name, const std::string& creator, SharedMemoryRoot* root, bool is_public)
+bool Game::verbose = true;
+
+Game::Game(int slot, const std::string& name, const std::string& creator, SharedMemoryRoot* root,
+           bool is_public, RulesId rules)
     : root(root) {
-    
-    game_id = -1;
-    for (int i = 0; i < 16; i++) {
-        if (!root->games[i].used) {
-            game_id = i;
-            game_data = &root->games[i];
-            break;
-        }
-    }
-    
-    if (game_id == -1) {
+    if (slot < 0 || slot >= static_cast<int>(MAX_GAMES) || root->games[slot].used) {
         throw std::runtime_error("No free game slots");
     }
-    
-    std::memset(game_data, 0, sizeof(GameData));
+    game_data = &root->games[slot];
+
+    GameWriteGuard guard(game_data);
+    // seq и generation не обнуляем: читатели прежней игры в этом слоте
+    // должны увидеть изменение
+    std::memset(&game_data->used, 0, sizeof(GameData) - offsetof(GameData, used));
+    game_data->generation = next_generation(game_data->generation);
+    game_id = make_game_handle(slot, game_data->generation);
     game_data->used = true;
     std::strncpy(game_data->game_name, name.c_str(), LOGIN_MAX - 1);
     std::strncpy(game_data->player1, creator.c_str(), LOGIN_MAX - 1);
     game_data->state = GAME_WAITING;
     game_data->is_public = is_public;
+    game_data->rules = rules;
     game_data->ship_count1 = 0;
     game_data->ship_count2 = 0;
     game_data->hits1 = game_data->hits2 = 0;
     game_data->misses1 = game_data->misses2 = 0;
     game_data->sunk1 = game_data->sunk2 = 0;
     
-    for (int i = 0; i < BOARD_SIZE; i++) {
-        for (int j = 0; j < BOARD_SIZE; j++) {
+    for (int i = 0; i < MAX_BOARD_SIZE; i++) {
+        for (int j = 0; j < MAX_BOARD_SIZE; j++) {
             game_data->board1[i][j] = CELL_EMPTY;
             game_data->board2[i][j] = CELL_EMPTY;
         }
     }
 }
 
+Game::Game(int slot, SharedMemoryRoot* root) : root(root) {
+    if (slot < 0 || slot >= static_cast<int>(MAX_GAMES) || !root->games[slot].used) {
+        throw std::runtime_error("Game slot is not in use");
+    }
+    game_data = &root->games[slot];
+    game_id = make_game_handle(slot, game_data->generation);
+}
+
+void Game::attach_journal(std::unique_ptr<GameJournal> j) {
+    journal = std::move(j);
+    journal->rules(rules());
+    if (game_data->player1[0])
+        journal->player(1, game_data->player1);
+    if (game_data->player2[0])
+        journal->player(2, game_data->player2);
+}
+
+void Game::resign(const std::string& player) {
+    uint8_t seat = seat_of(player);
+    if (journal && seat)
+        journal->end(3 - seat, JOURNAL_END_SURRENDER);
+}
+
+uint8_t Game::seat_of(const std::string& player) const {
+    if (player.empty())
+        return 0;
+    if (player == game_data->player1)
+        return 1;
+    return player == game_data->player2 ? 2 : 0;
+}
+
 bool Game::has_only_one_player() const {
     return (game_data->player1[0] != '\0' && game_data->player2[0] == '\0') ||
            (game_data->player1[0] == '\0' && game_data->player2[0] != '\0');
@@ -51,43 +87,36 @@ bool Game::is_player_in_game(const std::string& player) const {
 }
 
 void Game::remove_player(const std::string& player) {
+    GameWriteGuard guard(game_data);
+    if (journal && seat_of(player))
+        journal->leave(seat_of(player));
+    // Оставшийся игрок подтверждает расстановку заново, когда придёт соперник
+    game_data->ready1 = game_data->ready2 = false;
     if (player == std::string(game_data->player1)) {
         game_data->player1[0] = '\0';
         game_data->ship_count1 = 0;
         game_data->hits1 = game_data->misses1 = game_data->sunk1 = 0;
 
-        for (int i = 0; i < BOARD_SIZE; i++) {
-            for (int j = 0; j < BOARD_SIZE; j++) {
-                game_data->board1[i][j] = CELL_EMPTY;
-            }
-        }
-
-        for (int i = 0; i < 10; i++) {
-            game_data->ships1[i] = Ship();
-        }
+        std::memset(game_data->board1, CELL_EMPTY, sizeof(game_data->board1));
+        std::memset(game_data->ships1, 0, sizeof(game_data->ships1));
 
         if (game_data->state == GAME_ACTIVE || game_data->state == GAME_SETUP) {
             game_data->state = GAME_WAITING;
         }
+        game_data->shot_count = 0;
     } 
     else if (player == std::string(game_data->player2)) {
         game_data->player2[0] = '\0';
         game_data->ship_count2 = 0;
         game_data->hits2 = game_data->misses2 = game_data->sunk2 = 0;
 
-        for (int i = 0; i < BOARD_SIZE; i++) {
-            for (int j = 0; j < BOARD_SIZE; j++) {
-                game_data->board2[i][j] = CELL_EMPTY;
-            }
-        }
-
-        for (int i = 0; i < 10; i++) {
-            game_data->ships2[i] = Ship();
-        }
+        std::memset(game_data->board2, CELL_EMPTY, sizeof(game_data->board2));
+        std::memset(game_data->ships2, 0, sizeof(game_data->ships2));
 
         if (game_data->state == GAME_ACTIVE || game_data->state == GAME_SETUP) {
             game_data->state = GAME_WAITING;
         }
+        game_data->shot_count = 0;
     }
 
     if (has_only_one_player()) {
@@ -116,6 +145,7 @@ int Game::get_player_count() const {
 
 Game::~Game() {
     if (game_data) {
+        GameWriteGuard guard(game_data);
         game_data->used = false;
     }
 }
@@ -125,6 +155,7 @@ int Game::get_id() const {
 }
 
 bool Game::join(const std::string& player2) {
+    GameWriteGuard guard(game_data);
     if (std::string(game_data->player1) == player2 || 
         std::string(game_data->player2) == player2) {
         return false;
@@ -137,89 +168,44 @@ bool Game::join(const std::string& player2) {
     } else {
         return false; // Оба места заняты
     }
+    if (journal)
+        journal->player(seat_of(player2), player2);
 
     if (game_data->player1[0] != '\0' && game_data->player2[0] != '\0') {
         game_data->state = GAME_SETUP;
+
+        GameEvent joined{};
+        joined.type = EVT_OPPONENT_JOINED;
+        std::string other = (player2 == game_data->player1) ? game_data->player2 : game_data->player1;
+        post_event(other, joined, player2);
     }
     
     return true;
 }
 
-bool Game::can_place_ship(uint8_t size, uint8_t x, uint8_t y, bool horizontal, 
-                         CellState board[BOARD_SIZE][BOARD_SIZE]) const {
-    
-    std::cout << "DEBUG: Checking if can place ship size " << (int)size 
-              << " at " << (int)x << "," << (int)y 
-              << " " << (horizontal ? "H" : "V") << std::endl;
-    
-    // Проверяем границы
-    if (x >= BOARD_SIZE || y >= BOARD_SIZE) {
-        std::cout << "DEBUG: Coordinates out of bounds" << std::endl;
-        return false;
-    }
-
-    if (size == 1) {
-        for (int dy = -1; dy <= 1; dy++) {
-            for (int dx = -1; dx <= 1; dx++) {
-                int nx = x + dx;
-                int ny = y + dy;
-                if (nx >= 0 && nx < BOARD_SIZE && ny >= 0 && ny < BOARD_SIZE) {
-                    if (board[ny][nx] == CELL_SHIP) {
-                        std::cout << "DEBUG: Cell " << nx << "," << ny << " already has ship" << std::endl;
-                        return false;
-                    }
-                }
-            }
-        }
-        return true;
-    }
-
-    if (horizontal) {
-        if (x + size > BOARD_SIZE) {
-            std::cout << "DEBUG: Ship goes beyond right border" << std::endl;
-            return false;
-        }
-        for (int i = 0; i < size; i++) {
-            for (int dy = -1; dy <= 1; dy++) {
-                for (int dx = -1; dx <= 1; dx++) {
-                    int nx = x + i + dx;
-                    int ny = y + dy;
-                    if (nx >= 0 && nx < BOARD_SIZE && ny >= 0 && ny < BOARD_SIZE) {
-                        if (board[ny][nx] == CELL_SHIP) {
-                            std::cout << "DEBUG: Cell " << nx << "," << ny << " already has ship" << std::endl;
-                            return false;
-                        }
-                    }
-                }
-            }
-        }
+bool Game::fleet_of(const std::string& player, Board*& board, Ship*& ships, uint8_t*& count) {
+    if (player == std::string(game_data->player1)) {
+        board = &game_data->board1;
+        ships = game_data->ships1;
+        count = &game_data->ship_count1;
+        if (verbose)
+            std::cout << "DEBUG: Player 1 placing ship" << std::endl;
+    } else if (player == std::string(game_data->player2)) {
+        board = &game_data->board2;
+        ships = game_data->ships2;
+        count = &game_data->ship_count2;
+        if (verbose)
+            std::cout << "DEBUG: Player 2 placing ship" << std::endl;
     } else {
-        if (y + size > BOARD_SIZE) {
-            std::cout << "DEBUG: Ship goes beyond bottom border" << std::endl;
-            return false;
-        }
-        for (int i = 0; i < size; i++) {
-            for (int dy = -1; dy <= 1; dy++) {
-                for (int dx = -1; dx <= 1; dx++) {
-                    int nx = x + dx;
-                    int ny = y + i + dy;
-                    if (nx >= 0 && nx < BOARD_SIZE && ny >= 0 && ny < BOARD_SIZE) {
-                        if (board[ny][nx] == CELL_SHIP) {
-                            std::cout << "DEBUG: Cell " << nx << "," << ny << " already has ship" << std::endl;
-                            return false;
-                        }
-                    }
-                }
-            }
-        }
+        if (verbose)
+            std::cout << "DEBUG: Unknown player: " << player << std::endl;
+        return false;
     }
-    
-    std::cout << "DEBUG: Ship can be placed here" << std::endl;
     return true;
 }
 
-void Game::place_ship_on_board(uint8_t size, uint8_t x, uint8_t y, bool horizontal,
-                              CellState board[BOARD_SIZE][BOARD_SIZE], Ship* ship_array, uint8_t& ship_count) {
+void Game::add_ship(const std::string& player, uint8_t size, uint8_t x, uint8_t y,
+                    bool horizontal, Board& board, Ship* ships, uint8_t& ship_count) {
     Ship ship;
     ship.size = size;
     ship.health = size;
@@ -239,87 +225,46 @@ void Game::place_ship_on_board(uint8_t size, uint8_t x, uint8_t y, bool horizont
             board[y + i][x] = CELL_SHIP;
         }
     }
-    
-    ship_array[ship_count] = ship;
-    ship_count++;
-}
-
-bool Game::place_ship(const std::string& player, uint8_t size, uint8_t x, uint8_t y, bool horizontal) {
-    if (game_data->state != GAME_WAITING && game_data->state != GAME_SETUP) {
-        std::cout << "DEBUG: Wrong game state: " << (int)game_data->state << std::endl;
-        return false;
-    }
 
-    bool valid_size = false;
-    int required_count = 0;
-    
-    switch(size) {
-        case 4: valid_size = true; required_count = 1; break;
-        case 3: valid_size = true; required_count = 2; break;
-        case 2: valid_size = true; required_count = 3; break;
-        case 1: valid_size = true; required_count = 4; break;
-        default: 
-            std::cout << "DEBUG: Invalid ship size: " << (int)size << std::endl;
-            return false;
-    }
-    
-    if (!valid_size) return false;
+    ships[ship_count] = ship;
+    ship_count++;
+    if (journal)
+        journal->place(seat_of(player), size, x, y, horizontal);
 
-    if (size == 1) {
-        horizontal = true; 
-    }
+    if (verbose)
+        std::cout << "DEBUG: Ship placed successfully. Player " << player
+                  << " now has " << (int)ship_count << " ships" << std::endl;
 
-    uint8_t current_count = 0;
-    Ship* ships = nullptr;
-    uint8_t* ship_count = nullptr;
-    CellState (*board)[BOARD_SIZE] = nullptr;
-    
-    if (player == std::string(game_data->player1)) {
-        ships = game_data->ships1;
-        ship_count = &game_data->ship_count1;
-        board = game_data->board1;
-        std::cout << "DEBUG: Player 1 placing ship" << std::endl;
-    } else if (player == std::string(game_data->player2)) {
-        ships = game_data->ships2;
-        ship_count = &game_data->ship_count2;
-        board = game_data->board2;
-        std::cout << "DEBUG: Player 2 placing ship" << std::endl;
-    } else {
-        std::cout << "DEBUG: Unknown player: " << player << std::endl;
-        return false;
+    if (game_data->state == GAME_WAITING) {
+        game_data->state = GAME_SETUP;
+        if (verbose)
+            std::cout << "DEBUG: Game state changed to SETUP" << std::endl;
     }
+}
 
-    for (int i = 0; i < *ship_count; i++) {
-        if (ships[i].size == size) current_count++;
-    }
-    
-    if (current_count >= required_count) {
-        std::cout << "DEBUG: Too many ships of size " << (int)size 
-                  << " (have " << current_count << ", need " << required_count << ")" << std::endl;
+bool Game::clear_ships(const std::string& player) {
+    GameWriteGuard guard(game_data);
+    if (game_data->state != GAME_WAITING && game_data->state != GAME_SETUP)
         return false;
-    }
 
-    if (!can_place_ship(size, x, y, horizontal, board)) {
-        std::cout << "DEBUG: Cannot place ship at " << (int)x << "," << (int)y 
-                  << " size " << (int)size << (horizontal ? "H" : "V") << std::endl;
+    if (player == std::string(game_data->player1) && !game_data->ready1) {
+        std::memset(game_data->board1, 0, sizeof(game_data->board1));
+        std::memset(game_data->ships1, 0, sizeof(game_data->ships1));
+        game_data->ship_count1 = 0;
+    } else if (player == std::string(game_data->player2) && !game_data->ready2) {
+        std::memset(game_data->board2, 0, sizeof(game_data->board2));
+        std::memset(game_data->ships2, 0, sizeof(game_data->ships2));
+        game_data->ship_count2 = 0;
+    } else {
         return false;
     }
-
-    place_ship_on_board(size, x, y, horizontal, board, ships, *ship_count);
-    
-    std::cout << "DEBUG: Ship placed successfully. Player " << player 
-              << " now has " << (int)*ship_count << " ships" << std::endl;
-
-    if (game_data->state == GAME_WAITING) {
-        game_data->state = GAME_SETUP;
-        std::cout << "DEBUG: Game state changed to SETUP" << std::endl;
-    }
-    
+    if (journal)
+        journal->clear(seat_of(player));
     return true;
 }
 
-bool Game::check_hit(uint8_t x, uint8_t y, CellState board[BOARD_SIZE][BOARD_SIZE],
-                    Ship* ships, uint8_t ship_count, bool& sunk, uint8_t& sunk_ship_index) {
+bool Game::check_hit(uint8_t x, uint8_t y, Board& board, Ship* ships, uint8_t ship_count,
+                     bool& sunk, uint8_t& sunk_ship_index) {
     if (board[y][x] == CELL_SHIP) {
         for (int i = 0; i < ship_count; i++) {
             Ship& ship = ships[i];
@@ -328,14 +273,16 @@ bool Game::check_hit(uint8_t x, uint8_t y, CellState board[BOARD_SIZE][BOARD_SIZ
             if (ship.horizontal) {
                 if (y == ship.start_y && x >= ship.start_x && x < ship.start_x + ship.size) {
                     ship.health--;
-                    std::cout << "DEBUG: Hit ship " << i << " at " << (int)x << "," << (int)y 
-                              << ". Health now: " << (int)ship.health << std::endl;
+                    if (verbose)
+                        std::cout << "DEBUG: Hit ship " << i << " at " << (int)x << "," << (int)y
+                                  << ". Health now: " << (int)ship.health << std::endl;
                     
                     if (ship.health == 0) {
                         ship.sunk = true;
                         sunk = true;
                         sunk_ship_index = i;
-                        std::cout << "DEBUG: Ship " << i << " SUNK! Marking cells..." << std::endl;
+                        if (verbose)
+                            std::cout << "DEBUG: Ship " << i << " SUNK! Marking cells..." << std::endl;
                         
                         // Помечаем все клетки корабля как потопленные
                         for (int j = 0; j < ship.size; j++) {
@@ -349,14 +296,16 @@ bool Game::check_hit(uint8_t x, uint8_t y, CellState board[BOARD_SIZE][BOARD_SIZ
             } else {
                 if (x == ship.start_x && y >= ship.start_y && y < ship.start_y + ship.size) {
                     ship.health--;
-                    std::cout << "DEBUG: Hit ship " << i << " at " << (int)x << "," << (int)y 
-                              << ". Health now: " << (int)ship.health << std::endl;
+                    if (verbose)
+                        std::cout << "DEBUG: Hit ship " << i << " at " << (int)x << "," << (int)y
+                                  << ". Health now: " << (int)ship.health << std::endl;
                     
                     if (ship.health == 0) {
                         ship.sunk = true;
                         sunk = true;
                         sunk_ship_index = i;
-                        std::cout << "DEBUG: Ship " << i << " SUNK! Marking cells..." << std::endl;
+                        if (verbose)
+                            std::cout << "DEBUG: Ship " << i << " SUNK! Marking cells..." << std::endl;
                         
                         for (int j = 0; j < ship.size; j++) {
                             board[ship.start_y + j][ship.start_x] = CELL_SUNK;
@@ -376,38 +325,49 @@ bool Game::check_hit(uint8_t x, uint8_t y, CellState board[BOARD_SIZE][BOARD_SIZ
     return false;
 }
 
-bool Game::make_shot(const std::string& shooter, uint8_t x, uint8_t y) {
+bool Game::fire(const std::string& shooter, uint8_t x, uint8_t y) {
+    GameWriteGuard guard(game_data);
     if (game_data->state != GAME_ACTIVE) return false;
     if (!is_player_turn(shooter)) return false;
-    if (x >= BOARD_SIZE || y >= BOARD_SIZE) return false;
     
     bool is_player1 = (shooter == std::string(game_data->player1));
     bool hit = false;
     bool sunk = false;
     uint8_t sunk_ship_index = 0;
     
-    CellState (*target_board)[BOARD_SIZE] = nullptr;
+    Board* target_board = nullptr;
     Ship* target_ships = nullptr;
     uint8_t target_ship_count = 0;
     
     if (is_player1) {
-        target_board = game_data->board2;
+        target_board = &game_data->board2;
         target_ships = game_data->ships2;
         target_ship_count = game_data->ship_count2;
     } else {
-        target_board = game_data->board1;
+        target_board = &game_data->board1;
         target_ships = game_data->ships1;
         target_ship_count = game_data->ship_count1;
     }
     
-    hit = check_hit(x, y, target_board, target_ships, target_ship_count, sunk, sunk_ship_index);
+    hit = check_hit(x, y, *target_board, target_ships, target_ship_count, sunk, sunk_ship_index);
+
+    if (game_data->shot_count < PUBLIC_LOG_SIZE) {
+        PublicShot& logged = game_data->shots[game_data->shot_count++];
+        logged.shooter = is_player1 ? 1 : 2;
+        logged.x = x;
+        logged.y = y;
+        logged.result = sunk ? SHOT_SUNK : (hit ? SHOT_HIT : SHOT_MISS);
+    }
+    if (journal)
+        journal->shot(is_player1 ? 1 : 2, x, y, sunk ? SHOT_SUNK : (hit ? SHOT_HIT : SHOT_MISS));
 
     if (is_player1) {
         if (hit) {
             game_data->hits1++;
             if (sunk) {
                 game_data->sunk1++;
-                std::cout << "DEBUG: Player 1 sunk a ship! Total sunk: " << (int)game_data->sunk1 << std::endl;
+                if (verbose)
+                    std::cout << "DEBUG: Player 1 sunk a ship! Total sunk: " << (int)game_data->sunk1 << std::endl;
             }
         } else {
             game_data->misses1++;
@@ -417,7 +377,8 @@ bool Game::make_shot(const std::string& shooter, uint8_t x, uint8_t y) {
             game_data->hits2++;
             if (sunk) {
                 game_data->sunk2++;
-                std::cout << "DEBUG: Player 2 sunk a ship! Total sunk: " << (int)game_data->sunk2 << std::endl;
+                if (verbose)
+                    std::cout << "DEBUG: Player 2 sunk a ship! Total sunk: " << (int)game_data->sunk2 << std::endl;
             }
         } else {
             game_data->misses2++;
@@ -428,15 +389,51 @@ bool Game::make_shot(const std::string& shooter, uint8_t x, uint8_t y) {
         game_data->state = GAME_FINISHED;
         game_data->end_time = time(nullptr);
         std::strcpy(game_data->current_turn, "");
+        if (journal)
+            journal->end(is_player1 ? 1 : 2, JOURNAL_END_SUNK);
     } else if (!hit) {
         switch_turn();
     } else {
-        std::cout << "DEBUG: Hit but not sunk, shooter gets another turn" << std::endl;
+        if (verbose)
+            std::cout << "DEBUG: Hit but not sunk, shooter gets another turn" << std::endl;
+    }
+
+    std::string target = is_player1 ? game_data->player2 : game_data->player1;
+
+    GameEvent shot{};
+    shot.type = EVT_INCOMING_SHOT;
+    shot.x = x;
+    shot.y = y;
+    shot.result = sunk ? SHOT_SUNK : (hit ? SHOT_HIT : SHOT_MISS);
+    post_event(target, shot, shooter);
+
+    if (game_data->state == GAME_FINISHED) {
+        GameEvent over{};
+        over.type = EVT_GAME_OVER;
+        over.result = 1;
+        post_event(shooter, over, shooter);
+        over.result = 0;
+        post_event(target, over, shooter);
+    } else if (!hit) {
+        GameEvent turn{};
+        turn.type = EVT_YOUR_TURN;
+        post_event(target, turn, shooter);
     }
-    
+
     return hit;
 }
 
+void Game::post_event(const std::string& player, GameEvent e, const std::string& who) {
+    e.game_id = game_id;
+    std::strncpy(e.who, who.c_str(), LOGIN_MAX - 1);
+    for (size_t i = 0; i < MAX_CLIENTS; i++) {
+        if (root->clients[i].used && player == root->clients[i].login) {
+            push_event(&root->clients[i], e);
+            return;
+        }
+    }
+}
+
 void Game::switch_turn() {
     if (std::string(game_data->current_turn) == std::string(game_data->player1)) {
         std::strcpy(game_data->current_turn, game_data->player2);
@@ -465,16 +462,8 @@ bool Game::check_game_over() const {
     return all_sunk1 || all_sunk2;
 }
 
-bool Game::is_setup_complete(const std::string& player) const {
-    if (player == std::string(game_data->player1)) {
-        return game_data->ship_count1 == 10;
-    } else if (player == std::string(game_data->player2)) {
-        return game_data->ship_count2 == 10;
-    }
-    return false;
-}
-
 void Game::set_setup_complete(const std::string& player) {
+    GameWriteGuard guard(game_data);
     for (size_t i = 0; i < MAX_CLIENTS; i++) {
         if (root->clients[i].used && std::strcmp(root->clients[i].login, player.c_str()) == 0) {
             root->clients[i].setup_complete = true;
@@ -482,23 +471,29 @@ void Game::set_setup_complete(const std::string& player) {
         }
     }
     
-    bool player1_ready = false;
-    bool player2_ready = false;
-    
-    for (size_t i = 0; i < MAX_CLIENTS; i++) {
-        if (root->clients[i].used) {
-            if (std::strcmp(root->clients[i].login, game_data->player1) == 0) {
-                player1_ready = root->clients[i].setup_complete;
-            } else if (std::strcmp(root->clients[i].login, game_data->player2) == 0) {
-                player2_ready = root->clients[i].setup_complete;
-            }
-        }
+    if (journal && seat_of(player))
+        journal->ready(seat_of(player));
+
+    // Бот не занимает слот клиента, поэтому готовность хранится в самой игре
+    if (player == std::string(game_data->player1)) {
+        game_data->ready1 = true;
+    } else if (player == std::string(game_data->player2)) {
+        game_data->ready2 = true;
     }
-    
-    if (player1_ready && player2_ready) {
+
+    if (game_data->ready1 && game_data->ready2) {
         game_data->state = GAME_ACTIVE;
         game_data->start_time = time(nullptr);
         std::strcpy(game_data->current_turn, game_data->player1);
+
+        GameEvent started{};
+        started.type = EVT_GAME_STARTED;
+        post_event(game_data->player1, started, game_data->player2);
+        post_event(game_data->player2, started, game_data->player1);
+
+        GameEvent turn{};
+        turn.type = EVT_YOUR_TURN;
+        post_event(game_data->player1, turn, game_data->player2);
     }
 }
 
@@ -511,59 +506,15 @@ bool Game::is_game_finished() const {
 }
 
 std::string Game::get_winner() const {
-    if (!is_game_finished()) return "";
-    
-    bool all_sunk1 = true;
-    for (int i = 0; i < game_data->ship_count1; i++) {
-        if (!game_data->ships1[i].sunk) {
-            all_sunk1 = false;
-            break;
-        }
-    }
-    
-    bool all_sunk2 = true;
-    for (int i = 0; i < game_data->ship_count2; i++) {
-        if (!game_data->ships2[i].sunk) {
-            all_sunk2 = false;
-            break;
-        }
-    }
-    
-    if (all_sunk1) return std::string(game_data->player2);
-    if (all_sunk2) return std::string(game_data->player1);
-    return "";
+    return game_winner(*game_data);
 }
 
 std::string Game::get_current_turn() const {
     return std::string(game_data->current_turn);
 }
 
-std::string Game::board_to_string(CellState board[BOARD_SIZE][BOARD_SIZE], bool show_ships) const {
-    std::stringstream ss;
-    
-    ss << "   ";
-    for (int i = 0; i < BOARD_SIZE; i++) {
-        ss << std::setw(2) << i << " ";
-    }
-    ss << "\n";
-    
-    for (int y = 0; y < BOARD_SIZE; y++) {
-        ss << std::setw(2) << y << " ";
-        for (int x = 0; x < BOARD_SIZE; x++) {
-            char symbol = '.';
-            switch(board[y][x]) {
-                case CELL_EMPTY: symbol = '.'; break;
-                case CELL_SHIP: symbol = show_ships ? 'S' : '.'; break;
-                case CELL_HIT: symbol = 'X'; break;
-                case CELL_MISS: symbol = 'O'; break;
-                case CELL_SUNK: symbol = '#'; break;
-            }
-            ss << " " << symbol << " ";
-        }
-        ss << "\n";
-    }
-    
-    return ss.str();
+std::string Game::board_to_string(const Board& board, bool show_ships) const {
+    return render_board(board, width(), height(), show_ships);
 }
 
 std::string Game::get_player_board(const std::string& player, bool show_ships) const {
@@ -576,82 +527,23 @@ std::string Game::get_player_board(const std::string& player, bool show_ships) c
 }
 
 std::string Game::get_opponent_view(const std::string& player) const {
-    CellState temp_board[BOARD_SIZE][BOARD_SIZE];
-    
-    if (player == std::string(game_data->player1)) {
-        for (int y = 0; y < BOARD_SIZE; y++) {
-            for (int x = 0; x < BOARD_SIZE; x++) {
-                if (game_data->board2[y][x] == CELL_SHIP) {
-                    temp_board[y][x] = CELL_EMPTY;
-                } else {
-                    temp_board[y][x] = game_data->board2[y][x];
-                }
-            }
-        }
-    } else {
-        for (int y = 0; y < BOARD_SIZE; y++) {
-            for (int x = 0; x < BOARD_SIZE; x++) {
-                if (game_data->board1[y][x] == CELL_SHIP) {
-                    temp_board[y][x] = CELL_EMPTY;
-                } else {
-                    temp_board[y][x] = game_data->board1[y][x];
-                }
-            }
-        }
-    }
-    
+    Board temp_board;
+    get_opponent_cells(player, temp_board);
     return board_to_string(temp_board, false);
 }
 
 std::string Game::get_statistics(const std::string& player) const {
-    std::stringstream ss;
-    
-    bool is_player1 = (player == std::string(game_data->player1));
-    
-    ss << "Статистика:\n";
-    ss << "Сбито кораблей: " << (is_player1 ? (int)game_data->sunk1 : (int)game_data->sunk2) << "\n";
-    ss << "Попаданий: " << (is_player1 ? (int)game_data->hits1 : (int)game_data->hits2) << "\n";
-    ss << "Промахов: " << (is_player1 ? (int)game_data->misses1 : (int)game_data->misses2) << "\n";
-    
-    if (is_game_finished()) {
-        ss << "Игра завершена!\n";
-        std::string winner = get_winner();
-        if (winner == player) {
-            ss << "Вы победили!\n";
-        } else {
-            ss << "Победил: " << winner << "\n";
-        }
-    } else if (is_game_active()) {
-        ss << "Текущий ход: " << get_current_turn() << "\n";
-        if (get_current_turn() == player) {
-            ss << "Ваш ход!\n";
-        } else {
-            ss << "Ход противника\n";
-        }
-    }
-    
-    return ss.str();
+    return format_game_statistics(*game_data, player);
+}
+
+void Game::get_shot_tally(const std::string& player, uint32_t& shots, uint32_t& hits) const {
+    uint8_t seat = seat_of(player);
+    hits = seat == 1 ? game_data->hits1 : seat == 2 ? game_data->hits2 : 0;
+    shots = hits + (seat == 1 ? game_data->misses1 : seat == 2 ? game_data->misses2 : 0);
 }
 
 std::string Game::get_status() const {
-    std::stringstream ss;
-    
-    ss << "Игра: " << game_data->game_name << " (ID: " << game_id << ")\n";
-    ss << "Игрок 1: " << game_data->player1 << "\n";
-    ss << "Игрок 2: " << (game_data->player2[0] ? game_data->player2 : "ожидает...") << "\n";
-    ss << "Тип: " << (game_data->is_public ? "публичная" : "приватная") << "\n";
-    ss << "Статус: ";
-    
-    switch(game_data->state) {
-        case GAME_WAITING: ss << "Ожидание второго игрока"; break;
-        case GAME_SETUP: ss << "Расстановка кораблей"; break;
-        case GAME_ACTIVE: ss << "Идет игра (ход: " << game_data->current_turn << ")"; break;
-        case GAME_FINISHED: 
-            ss << "Завершена. Победитель: " << get_winner();
-            break;
-    }
-    
-    return ss.str();
+    return format_game_status(*game_data, game_id);
 }
 
 bool Game::has_player(const std::string& player) const {
@@ -662,4 +554,124 @@ bool Game::has_player(const std::string& player) const {
 bool Game::is_player_turn(const std::string& player) const {
     return (game_data->state == GAME_ACTIVE && 
             std::string(game_data->current_turn) == player);
-}
\ No newline at end of file
+}
+template <class Rules>
+bool RulesGame<Rules>::can_place_ship(uint8_t size, uint8_t x, uint8_t y, bool horizontal,
+                                      const Board& board) {
+    int w = horizontal ? size : 1;
+    int h = horizontal ? 1 : size;
+    if (x + w > Rules::WIDTH || y + h > Rules::HEIGHT)
+        return false;
+
+    // Без касания рядом с кораблём не должно быть других даже по диагонали
+    constexpr int margin = Rules::SHIPS_MAY_TOUCH ? 0 : 1;
+    for (int ny = y - margin; ny < y + h + margin; ny++) {
+        for (int nx = x - margin; nx < x + w + margin; nx++) {
+            if (nx >= 0 && nx < Rules::WIDTH && ny >= 0 && ny < Rules::HEIGHT &&
+                board[ny][nx] == CELL_SHIP)
+                return false;
+        }
+    }
+    return true;
+}
+
+template <class Rules>
+bool RulesGame<Rules>::place_ship(const std::string& player, uint8_t size, uint8_t x, uint8_t y,
+                                  bool horizontal) {
+    GameWriteGuard guard(game_data);
+    if (game_data->state != GAME_WAITING && game_data->state != GAME_SETUP) {
+        if (verbose)
+            std::cout << "DEBUG: Wrong game state: " << (int)game_data->state << std::endl;
+        return false;
+    }
+
+    if (size < 1 || size > MAX_SHIP_SIZE || Rules::FLEET[size] == 0) {
+        if (verbose)
+            std::cout << "DEBUG: Invalid ship size: " << (int)size << std::endl;
+        return false;
+    }
+    int required_count = Rules::FLEET[size];
+
+    if (size == 1) {
+        horizontal = true;
+    }
+
+    Board* board = nullptr;
+    Ship* ships = nullptr;
+    uint8_t* ship_count = nullptr;
+    if (!fleet_of(player, board, ships, ship_count))
+        return false;
+
+    int current_count = 0;
+    for (int i = 0; i < *ship_count; i++) {
+        if (ships[i].size == size) current_count++;
+    }
+
+    if (current_count >= required_count) {
+        if (verbose)
+            std::cout << "DEBUG: Too many ships of size " << (int)size
+                      << " (have " << current_count << ", need " << required_count << ")" << std::endl;
+        return false;
+    }
+
+    if (!can_place_ship(size, x, y, horizontal, *board)) {
+        if (verbose)
+            std::cout << "DEBUG: Cannot place ship at " << (int)x << "," << (int)y
+                      << " size " << (int)size << (horizontal ? "H" : "V") << std::endl;
+        return false;
+    }
+
+    add_ship(player, size, x, y, horizontal, *board, ships, *ship_count);
+    return true;
+}
+
+template <class Rules>
+bool RulesGame<Rules>::make_shot(const std::string& shooter, uint8_t x, uint8_t y) {
+    if (x >= Rules::WIDTH || y >= Rules::HEIGHT)
+        return false;
+    return fire(shooter, x, y);
+}
+
+template <class Rules>
+bool RulesGame<Rules>::is_setup_complete(const std::string& player) const {
+    constexpr int ships = fleet_ship_count<Rules>();
+    if (player == std::string(game_data->player1)) {
+        return game_data->ship_count1 == ships;
+    } else if (player == std::string(game_data->player2)) {
+        return game_data->ship_count2 == ships;
+    }
+    return false;
+}
+
+template <class Rules>
+void RulesGame<Rules>::get_opponent_cells(const std::string& player,
+                                          CellState out[MAX_BOARD_SIZE][MAX_BOARD_SIZE]) const {
+    const Board& board =
+        (player == std::string(game_data->player1)) ? game_data->board2 : game_data->board1;
+
+    for (int y = 0; y < Rules::HEIGHT; y++) {
+        for (int x = 0; x < Rules::WIDTH; x++) {
+            out[y][x] = (board[y][x] == CELL_SHIP) ? CELL_EMPTY : board[y][x];
+        }
+    }
+}
+
+template class RulesGame<ClassicRules>;
+template class RulesGame<LargeRules>;
+
+Game* make_game(RulesId rules, int slot, const std::string& name, const std::string& creator,
+                SharedMemoryRoot* root, bool is_public) {
+    switch (rules) {
+    case RULES_LARGE:
+        return new RulesGame<LargeRules>(slot, name, creator, root, is_public);
+    case RULES_CLASSIC:
+        break;
+    }
+    return new RulesGame<ClassicRules>(slot, name, creator, root, is_public);
+}
+
+Game* attach_game(int slot, SharedMemoryRoot* root) {
+    if (slot >= 0 && slot < static_cast<int>(MAX_GAMES) && root->games[slot].rules == RULES_LARGE)
+        return new RulesGame<LargeRules>(slot, root);
+    return new RulesGame<ClassicRules>(slot, root);
+}
@@ -1,19 +1,40 @@
 #pragma once
+#include <memory>
 #include <string>
 #include <vector>
 
+#include "../include/Rules.hpp"
 #include "../include/SharedTypes.hpp"
+#include "Journal.hpp"
 
+// Общая часть партии: игроки, ходы, события, журнал. Всё, что зависит от
+// правил (поле, флот, касание кораблей), делает RulesGame<Rules> ниже.
 class Game {
   public:
-    Game(const std::string& name, const std::string& creator, SharedMemoryRoot* root,
-         bool is_public = false);
-    ~Game();
+    // Отладочный вывод ходов в std::cout; самоигра его выключает, чтобы
+    // не тратить время на форматирование
+    static bool verbose;
+
+    virtual ~Game();
+
+    // Отвязывает объект от слота: деструктор больше не освобождает его
+    void detach() { game_data = nullptr; }
+    // Дальше каждый ход партии пишется в журнал; текущие игроки записываются сразу
+    void attach_journal(std::unique_ptr<GameJournal> j);
+    // Сдача: в журнал попадает победа соперника
+    void resign(const std::string& player);
+
+    RulesId rules() const { return static_cast<RulesId>(game_data->rules); }
+    virtual int width() const = 0;
+    virtual int height() const = 0;
 
     bool join(const std::string& player2);
-    bool place_ship(const std::string& player, uint8_t size, uint8_t x, uint8_t y, bool horizontal);
-    bool make_shot(const std::string& shooter, uint8_t x, uint8_t y);
-    bool is_setup_complete(const std::string& player) const;
+    virtual bool place_ship(const std::string& player, uint8_t size, uint8_t x, uint8_t y,
+                            bool horizontal) = 0;
+    // Снимает все корабли игрока, пока он не подтвердил расстановку
+    bool clear_ships(const std::string& player);
+    virtual bool make_shot(const std::string& shooter, uint8_t x, uint8_t y) = 0;
+    virtual bool is_setup_complete(const std::string& player) const = 0;
     void set_setup_complete(const std::string& player);
     bool is_game_active() const;
     bool is_game_finished() const;
@@ -23,8 +44,14 @@ class Game {
 
     std::string get_player_board(const std::string& player, bool show_ships = true) const;
     std::string get_opponent_view(const std::string& player) const;
+    // Доска противника глазами игрока: нетронутые корабли видны как CELL_EMPTY
+    virtual void get_opponent_cells(const std::string& player,
+                                    CellState out[MAX_BOARD_SIZE][MAX_BOARD_SIZE]) const = 0;
     std::string get_statistics(const std::string& player) const;
+    // Выстрелы и попадания игрока в этой партии
+    void get_shot_tally(const std::string& player, uint32_t& shots, uint32_t& hits) const;
 
+    // Дескриптор игры: слот и его поколение (см. make_game_handle)
     int get_id() const;
     std::string get_game_name() const {
         return std::string(game_data->game_name);
@@ -52,20 +79,68 @@ class Game {
     bool is_full() const;
     int get_player_count() const;
 
-  private:
+  protected:
+    // Новая игра в свободном слоте root->games[slot]; слот выбирает сервер
+    Game(int slot, const std::string& name, const std::string& creator, SharedMemoryRoot* root,
+         bool is_public, RulesId rules);
+    // Подключается к уже занятому слоту root->games[slot] (тёплый перезапуск)
+    Game(int slot, SharedMemoryRoot* root);
+
+    using Board = CellState[MAX_BOARD_SIZE][MAX_BOARD_SIZE];
+
     int game_id;
     SharedMemoryRoot* root;
     GameData* game_data;
+    std::unique_ptr<GameJournal> journal;
 
-    bool can_place_ship(uint8_t size, uint8_t x, uint8_t y, bool horizontal,
-                        CellState board[BOARD_SIZE][BOARD_SIZE]) const;
-    void place_ship_on_board(uint8_t size, uint8_t x, uint8_t y, bool horizontal,
-                             CellState board[BOARD_SIZE][BOARD_SIZE], Ship* ship_array,
-                             uint8_t& ship_count);
-    bool check_hit(uint8_t x, uint8_t y, CellState board[BOARD_SIZE][BOARD_SIZE], Ship* ships,
-                   uint8_t ship_count, bool& sunk, uint8_t& sunk_ship_index);
+    // 1 или 2 — место игрока за столом, 0 — не в игре
+    uint8_t seat_of(const std::string& player) const;
+    // Доска, корабли и счётчик кораблей игрока; false, если он не за столом
+    bool fleet_of(const std::string& player, Board*& board, Ship*& ships, uint8_t*& count);
+    // Ставит проверенный корабль, пишет журнал и переводит игру в расстановку
+    void add_ship(const std::string& player, uint8_t size, uint8_t x, uint8_t y, bool horizontal,
+                  Board& board, Ship* ships, uint8_t& ship_count);
+    // Выстрел по клетке на поле; возвращает попадание
+    bool fire(const std::string& shooter, uint8_t x, uint8_t y);
+    bool check_hit(uint8_t x, uint8_t y, Board& board, Ship* ships, uint8_t ship_count, bool& sunk,
+                   uint8_t& sunk_ship_index);
     bool check_game_over() const;
     void switch_turn();
+    void post_event(const std::string& player, GameEvent e, const std::string& who);
+
+    std::string board_to_string(const Board& board, bool show_ships) const;
+};
+
+// Движок партии под политику правил (см. Rules.hpp): границы поля, состав
+// флота и проверка касания - constexpr, каждый вариант собирается отдельно.
+// Экземпляры для ClassicRules и LargeRules собираются в Game.cpp
+template <class Rules>
+class RulesGame final : public Game {
+  public:
+    RulesGame(int slot, const std::string& name, const std::string& creator,
+              SharedMemoryRoot* root, bool is_public = false)
+        : Game(slot, name, creator, root, is_public, Rules::ID) {}
+    RulesGame(int slot, SharedMemoryRoot* root) : Game(slot, root) {}
+
+    int width() const override { return Rules::WIDTH; }
+    int height() const override { return Rules::HEIGHT; }
+    bool place_ship(const std::string& player, uint8_t size, uint8_t x, uint8_t y,
+                    bool horizontal) override;
+    bool make_shot(const std::string& shooter, uint8_t x, uint8_t y) override;
+    bool is_setup_complete(const std::string& player) const override;
+    void get_opponent_cells(const std::string& player,
+                            CellState out[MAX_BOARD_SIZE][MAX_BOARD_SIZE]) const override;
+
+  private:
+    static bool can_place_ship(uint8_t size, uint8_t x, uint8_t y, bool horizontal,
+                               const Board& board);
+};
+
+extern template class RulesGame<ClassicRules>;
+extern template class RulesGame<LargeRules>;
 
-    std::string board_to_string(CellState board[BOARD_SIZE][BOARD_SIZE], bool show_ships) const;
-};
\ No newline at end of file
+// Новая игра по правилам rules в свободном слоте
+Game* make_game(RulesId rules, int slot, const std::string& name, const std::string& creator,
+                SharedMemoryRoot* root, bool is_public);
+// Подключается к занятому слоту с правилами, записанными в нём
+Game* attach_game(int slot, SharedMemoryRoot* root);
\ No newline at end of file
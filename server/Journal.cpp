@@ -0,0 +1,407 @@
+#include "Journal.hpp"
+#include "../include/Rules.hpp"
+#include "Trace.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+// Обычная партия занимает около 1.5 КБ: места хватает без роста файла
+constexpr size_t JOURNAL_INITIAL_SIZE = 16 * 1024;
+// Сколько завершённых партий помнит сервер для повтора
+constexpr size_t JOURNAL_RECENT = 1024;
+
+uint64_t realtime_ns() {
+    timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + ts.tv_nsec;
+}
+
+void publish_length(JournalHeader* h, uint64_t length) {
+    __atomic_store_n(&h->length, length, __ATOMIC_RELEASE);
+}
+
+uint64_t published_length(const JournalHeader* h) {
+    return __atomic_load_n(&h->length, __ATOMIC_ACQUIRE);
+}
+
+} // namespace
+
+GameJournal::GameJournal(JournalStore* store, const std::string& path, int game_id,
+                         const std::string& name)
+    : store(store), path(path), fd(-1), base(nullptr), capacity(JOURNAL_INITIAL_SIZE),
+      start_ns(monotonic_ns()), last_us(0), winner(0), ended(false), failed(false), rec_len(0) {
+    fd = ::open(path.c_str(), O_CREAT | O_RDWR | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+        throw std::runtime_error("cannot open journal " + path);
+    // Блоки выделяются сразу: запись в отображение не упадёт с SIGBUS на полном диске
+    if (posix_fallocate(fd, 0, capacity) != 0) {
+        ::close(fd);
+        throw std::runtime_error("cannot allocate journal " + path);
+    }
+    void* addr = mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED) {
+        ::close(fd);
+        throw std::runtime_error("cannot map journal " + path);
+    }
+    base = static_cast<uint8_t*>(addr);
+
+    JournalHeader* h = header();
+    std::memset(h, 0, sizeof(JournalHeader));
+    h->start_unix_ns = realtime_ns();
+    h->game_id = game_id;
+    std::strncpy(h->game_name, name.c_str(), LOGIN_MAX - 1);
+    h->version = JOURNAL_VERSION;
+    h->magic = JOURNAL_MAGIC;
+}
+
+GameJournal::~GameJournal() {
+    if (!ended)
+        end(0, JOURNAL_END_CLOSED);
+    __atomic_store_n(&header()->closed, 1u, __ATOMIC_RELEASE);
+    store->retire(JournalStore::Closed{fd, base, capacity, sizeof(JournalHeader) + header()->length,
+                                       header()->game_id, path,
+                                       seats[1].empty() || seats[2].empty() ? "" : title()});
+}
+
+std::string GameJournal::title() const {
+    std::string res = (seats[1].empty() ? "?" : seats[1]) + " - " +
+                      (seats[2].empty() ? "?" : seats[2]);
+    if (winner == 1 || winner == 2)
+        res += ", победил " + seats[winner];
+    else
+        res += ", не доиграна";
+    return res;
+}
+
+void GameJournal::begin(JournalRecordType type) {
+    rec_len = 0;
+    rec[rec_len++] = type;
+    uint64_t now_us = (monotonic_ns() - start_ns) / 1000;
+    put(now_us - last_us);
+    last_us = now_us;
+}
+
+void GameJournal::put(uint64_t v) {
+    while (v >= 0x80) {
+        rec[rec_len++] = static_cast<uint8_t>(v | 0x80);
+        v >>= 7;
+    }
+    rec[rec_len++] = static_cast<uint8_t>(v);
+}
+
+void GameJournal::commit() {
+    if (failed)
+        return;
+    JournalHeader* h = header();
+    size_t at = sizeof(JournalHeader) + h->length;
+    if (at + rec_len > capacity && !grow(at + rec_len)) {
+        failed = true;
+        std::cerr << "Journal " << path << " stopped: cannot grow file" << std::endl;
+        return;
+    }
+    std::memcpy(base + at, rec, rec_len);
+    publish_length(header(), h->length + rec_len);
+}
+
+bool GameJournal::grow(size_t need) {
+    size_t new_capacity = capacity;
+    while (new_capacity < need)
+        new_capacity *= 2;
+    if (posix_fallocate(fd, 0, new_capacity) != 0)
+        return false;
+    void* addr = mremap(base, capacity, new_capacity, MREMAP_MAYMOVE);
+    if (addr == MAP_FAILED)
+        return false;
+    base = static_cast<uint8_t*>(addr);
+    capacity = new_capacity;
+    return true;
+}
+
+void GameJournal::rules(uint8_t id) {
+    begin(JR_RULES);
+    put(0);
+    put(id);
+    commit();
+}
+
+void GameJournal::player(uint8_t seat, const std::string& login) {
+    if (seat == 1 || seat == 2)
+        seats[seat] = login;
+    begin(JR_PLAYER);
+    put(seat);
+    size_t len = login.size() < LOGIN_MAX ? login.size() : LOGIN_MAX - 1;
+    put(len);
+    std::memcpy(rec + rec_len, login.data(), len);
+    rec_len += len;
+    commit();
+}
+
+void GameJournal::leave(uint8_t seat) {
+    begin(JR_LEAVE);
+    put(seat);
+    commit();
+}
+
+void GameJournal::place(uint8_t seat, uint8_t size, uint8_t x, uint8_t y, bool horizontal) {
+    begin(JR_PLACE);
+    put(seat);
+    put(size);
+    put(x);
+    put(y);
+    put(horizontal ? 1 : 0);
+    commit();
+}
+
+void GameJournal::clear(uint8_t seat) {
+    begin(JR_CLEAR);
+    put(seat);
+    commit();
+}
+
+void GameJournal::ready(uint8_t seat) {
+    begin(JR_READY);
+    put(seat);
+    commit();
+}
+
+void GameJournal::shot(uint8_t seat, uint8_t x, uint8_t y, uint8_t result) {
+    begin(JR_SHOT);
+    put(seat);
+    put(x);
+    put(y);
+    put(result);
+    commit();
+}
+
+void GameJournal::end(uint8_t winner_seat, JournalEndReason reason) {
+    if (ended)
+        return;
+    ended = true;
+    winner = winner_seat;
+    begin(JR_END);
+    put(winner_seat);
+    put(reason);
+    commit();
+}
+
+JournalStore::JournalStore(const std::string& dir, const std::string& prefix)
+    : dir(dir), prefix(prefix), next_number(1), stopping(false) {
+    struct stat st;
+    if (stat(dir.c_str(), &st) != 0 && mkdir(dir.c_str(), 0755) != 0)
+        throw std::runtime_error("cannot create journal directory " + dir);
+    flusher = std::thread([this] { flush_loop(); });
+}
+
+JournalStore::~JournalStore() {
+    {
+        std::lock_guard<std::mutex> g(lock);
+        stopping = true;
+    }
+    cond.notify_one();
+    flusher.join();
+}
+
+std::unique_ptr<GameJournal> JournalStore::open(int game_id, const std::string& name) {
+    std::ostringstream path;
+    path << dir << "/" << prefix << realtime_ns() / 1000000 << "-" << game_id << ".bsj";
+    return std::unique_ptr<GameJournal>(new GameJournal(this, path.str(), game_id, name));
+}
+
+std::vector<FinishedGame> JournalStore::recent(size_t n) {
+    std::lock_guard<std::mutex> g(lock);
+    std::vector<FinishedGame> res;
+    for (auto it = finished.rbegin(); it != finished.rend() && res.size() < n; ++it)
+        res.push_back(*it);
+    return res;
+}
+
+bool JournalStore::find_finished(uint32_t number, FinishedGame& out) {
+    std::lock_guard<std::mutex> g(lock);
+    if (finished.empty() || number < finished.front().number || number > finished.back().number)
+        return false;
+    // Номера идут подряд
+    out = finished[number - finished.front().number];
+    return true;
+}
+
+void JournalStore::retire(const Closed& c) {
+    {
+        std::lock_guard<std::mutex> g(lock);
+        closed.push_back(c);
+    }
+    cond.notify_one();
+}
+
+void JournalStore::flush_loop() {
+    std::unique_lock<std::mutex> g(lock);
+    while (true) {
+        cond.wait(g, [this] { return stopping || !closed.empty(); });
+        if (closed.empty() && stopping)
+            return;
+        Closed c = closed.front();
+        closed.pop_front();
+        g.unlock();
+
+        msync(c.base, c.used, MS_SYNC);
+        munmap(c.base, c.capacity);
+        // Запас под рост больше не нужен
+        if (ftruncate(c.fd, c.used) != 0)
+            std::cerr << "Journal truncate failed: " << std::strerror(errno) << std::endl;
+        ::close(c.fd);
+
+        g.lock();
+        // Повтор видит только сброшенный и обрезанный файл. Игры, где так и
+        // не собрались двое, в список не попадают
+        if (!c.title.empty()) {
+            finished.push_back(FinishedGame{next_number++, c.game_id, c.path, c.title});
+            if (finished.size() > JOURNAL_RECENT)
+                finished.pop_front();
+        }
+    }
+}
+
+JournalReader::JournalReader(const std::string& path)
+    : fd(-1), base(nullptr), mapped(0), pos(sizeof(JournalHeader)), end(0), t_us(0) {
+    fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        throw std::runtime_error("cannot open journal " + path);
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(JournalHeader))) {
+        ::close(fd);
+        throw std::runtime_error("bad journal " + path);
+    }
+    mapped = static_cast<size_t>(st.st_size);
+    void* addr = mmap(nullptr, mapped, PROT_READ, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED) {
+        ::close(fd);
+        throw std::runtime_error("cannot map journal " + path);
+    }
+    base = static_cast<const uint8_t*>(addr);
+
+    const JournalHeader* h = reinterpret_cast<const JournalHeader*>(base);
+    uint64_t length = published_length(h);
+    hdr = *h;
+    if (hdr.magic != JOURNAL_MAGIC || hdr.version != JOURNAL_VERSION ||
+        length > mapped - sizeof(JournalHeader)) {
+        munmap(const_cast<uint8_t*>(base), mapped);
+        ::close(fd);
+        throw std::runtime_error("bad journal " + path);
+    }
+    end = sizeof(JournalHeader) + length;
+}
+
+JournalReader::~JournalReader() {
+    if (base)
+        munmap(const_cast<uint8_t*>(base), mapped);
+    if (fd >= 0)
+        ::close(fd);
+}
+
+bool JournalReader::get(uint64_t& v) {
+    v = 0;
+    for (int shift = 0; shift < 64 && pos < end; shift += 7) {
+        uint8_t b = base[pos++];
+        v |= static_cast<uint64_t>(b & 0x7F) << shift;
+        if (!(b & 0x80))
+            return true;
+    }
+    throw std::runtime_error("corrupted journal record");
+}
+
+bool JournalReader::next(JournalRecord& r) {
+    if (pos >= end)
+        return false;
+
+    r = JournalRecord();
+    r.type = static_cast<JournalRecordType>(base[pos++]);
+    uint64_t dt, seat, a, b, c, d;
+    get(dt);
+    t_us += dt;
+    r.t_us = t_us;
+    get(seat);
+    r.seat = static_cast<uint8_t>(seat);
+
+    switch (r.type) {
+    case JR_PLAYER:
+        get(a);
+        if (a >= LOGIN_MAX || pos + a > end)
+            throw std::runtime_error("corrupted journal record");
+        r.login.assign(reinterpret_cast<const char*>(base + pos), a);
+        pos += a;
+        break;
+    case JR_PLACE:
+        get(a), get(b), get(c), get(d);
+        r.size = static_cast<uint8_t>(a);
+        r.x = static_cast<uint8_t>(b);
+        r.y = static_cast<uint8_t>(c);
+        r.horizontal = d != 0;
+        break;
+    case JR_SHOT:
+        get(a), get(b), get(c);
+        r.x = static_cast<uint8_t>(a);
+        r.y = static_cast<uint8_t>(b);
+        r.result = static_cast<uint8_t>(c);
+        break;
+    case JR_END:
+    case JR_RULES:
+        get(a);
+        r.result = static_cast<uint8_t>(a);
+        break;
+    case JR_LEAVE:
+    case JR_CLEAR:
+    case JR_READY:
+        break;
+    default:
+        throw std::runtime_error("unknown journal record type");
+    }
+    return true;
+}
+
+std::string format_journal_record(const JournalRecord& r) {
+    static const char* const SHOT_NAMES[] = {"miss", "hit", "sunk"};
+    static const char* const END_NAMES[] = {"sunk", "surrender", "closed"};
+
+    std::ostringstream ss;
+    ss << "+" << r.t_us / 1000 << "." << (r.t_us % 1000) / 100 << "ms ";
+    switch (r.type) {
+    case JR_PLAYER:
+        ss << "player " << int(r.seat) << " " << r.login;
+        break;
+    case JR_LEAVE:
+        ss << "leave " << int(r.seat);
+        break;
+    case JR_PLACE:
+        ss << "place " << int(r.seat) << " " << int(r.size) << "," << int(r.x) << "," << int(r.y)
+           << "," << (r.horizontal ? 'H' : 'V');
+        break;
+    case JR_CLEAR:
+        ss << "clear " << int(r.seat);
+        break;
+    case JR_READY:
+        ss << "ready " << int(r.seat);
+        break;
+    case JR_SHOT:
+        ss << "shot " << int(r.seat) << " " << int(r.x) << "," << int(r.y) << " "
+           << (r.result < 3 ? SHOT_NAMES[r.result] : "?");
+        break;
+    case JR_END:
+        ss << "end winner " << int(r.seat) << " " << (r.result < 3 ? END_NAMES[r.result] : "?");
+        break;
+    case JR_RULES:
+        ss << "rules " << rules_info(r.result).name;
+        break;
+    }
+    return ss.str();
+}
@@ -0,0 +1,166 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../include/SharedTypes.hpp"
+
+// Журнал партии: файл на диске, отображённый в память. Заголовок JournalHeader,
+// затем записи: тег, время от предыдущей записи в микросекундах и поля — всё
+// varint. Запись — это копирование в отображение и публикация длины в заголовке,
+// без системных вызовов; файл растёт удвоением, когда место кончается.
+constexpr uint32_t JOURNAL_MAGIC = 0x524A5342; // "BSJR"
+constexpr uint32_t JOURNAL_VERSION = 1;
+
+struct JournalHeader {
+    uint32_t magic;
+    uint32_t version;
+    // CLOCK_REALTIME начала партии
+    uint64_t start_unix_ns;
+    // Байт записей после заголовка; пишется после самой записи, поэтому
+    // читатель живого журнала видит только целые записи
+    uint64_t length;
+    int32_t game_id;
+    uint32_t closed;
+    char game_name[LOGIN_MAX];
+};
+
+struct JournalRecord {
+    JournalRecordType type;
+    // Микросекунды от начала партии
+    uint64_t t_us;
+    uint8_t seat;
+    uint8_t size;
+    uint8_t x;
+    uint8_t y;
+    bool horizontal;
+    uint8_t result;
+    std::string login;
+};
+
+class JournalStore;
+
+class GameJournal {
+  public:
+    GameJournal(JournalStore* store, const std::string& path, int game_id, const std::string& name);
+    // Отдаёт отображение потоку сброса: msync и закрытие идут вне игрового цикла
+    ~GameJournal();
+
+    // Правила партии (RulesId); пишутся первой записью
+    void rules(uint8_t id);
+    void player(uint8_t seat, const std::string& login);
+    void leave(uint8_t seat);
+    void place(uint8_t seat, uint8_t size, uint8_t x, uint8_t y, bool horizontal);
+    void clear(uint8_t seat);
+    void ready(uint8_t seat);
+    void shot(uint8_t seat, uint8_t x, uint8_t y, uint8_t result);
+    void end(uint8_t winner_seat, JournalEndReason reason);
+    bool has_ended() const { return ended; }
+    // "alice - bob, победил bob" для списка партий
+    std::string title() const;
+    const std::string& file_path() const { return path; }
+
+  private:
+    JournalStore* store;
+    std::string path;
+    int fd;
+    uint8_t* base;
+    size_t capacity;
+    uint64_t start_ns;
+    uint64_t last_us;
+    // Логины по местам и победитель - для списка завершённых партий
+    std::string seats[3];
+    uint8_t winner;
+    bool ended;
+    // Файл не удалось вырастить: дальше записи молча пропускаются
+    bool failed;
+
+    // Запись целиком собирается здесь, потом копируется одним memcpy
+    uint8_t rec[2 * LOGIN_MAX];
+    size_t rec_len;
+
+    JournalHeader* header() { return reinterpret_cast<JournalHeader*>(base); }
+    void begin(JournalRecordType type);
+    void put(uint64_t v);
+    void commit();
+    bool grow(size_t need);
+};
+
+// Завершённая партия, журнал которой уже сброшен на диск и закрыт
+struct FinishedGame {
+    // Сквозной номер в пределах работы сервера; номера слотов игр повторяются
+    uint32_t number;
+    int game_id;
+    std::string path;
+    std::string title;
+};
+
+// Каталог журналов и поток, который сбрасывает на диск и закрывает журналы
+// завершённых партий
+class JournalStore {
+  public:
+    // prefix отличает сегменты сервера, пишущие в один каталог
+    JournalStore(const std::string& dir, const std::string& prefix = "");
+    ~JournalStore();
+
+    std::unique_ptr<GameJournal> open(int game_id, const std::string& name);
+    const std::string& directory() const { return dir; }
+
+    // Последние завершённые партии, новые первыми
+    std::vector<FinishedGame> recent(size_t n);
+    bool find_finished(uint32_t number, FinishedGame& out);
+
+  private:
+    friend class GameJournal;
+    struct Closed {
+        int fd;
+        uint8_t* base;
+        size_t capacity;
+        size_t used;
+        int game_id;
+        std::string path;
+        std::string title;
+    };
+
+    std::string dir;
+    std::string prefix;
+    std::mutex lock;
+    std::condition_variable cond;
+    std::deque<Closed> closed;
+    // Не больше JOURNAL_RECENT партий, старые в начале
+    std::deque<FinishedGame> finished;
+    uint32_t next_number;
+    bool stopping;
+    std::thread flusher;
+
+    void retire(const Closed& c);
+    void flush_loop();
+};
+
+class JournalReader {
+  public:
+    explicit JournalReader(const std::string& path);
+    ~JournalReader();
+
+    const JournalHeader& header() const { return hdr; }
+    // Следующая запись; false в конце уже опубликованной части журнала
+    bool next(JournalRecord& r);
+
+  private:
+    int fd;
+    const uint8_t* base;
+    size_t mapped;
+    JournalHeader hdr;
+    size_t pos;
+    size_t end;
+    uint64_t t_us;
+
+    bool get(uint64_t& v);
+};
+
+std::string format_journal_record(const JournalRecord& r);
@@ -0,0 +1,52 @@
+#include "Matchmaker.hpp"
+
+int Matchmaker::bucket_of(int rating) {
+    int b = rating / BUCKET_WIDTH;
+    if (b < 0)
+        return 0;
+    if (b >= BUCKET_COUNT)
+        return BUCKET_COUNT - 1;
+    return b;
+}
+
+bool Matchmaker::enqueue(const std::string& login, int rating, std::string& opponent) {
+    if (where.count(login))
+        return false;
+
+    int b = bucket_of(rating);
+    // Сначала своя корзина, затем соседние
+    const int order[3] = {b, b - 1, b + 1};
+    for (int candidate : order) {
+        if (candidate < 0 || candidate >= BUCKET_COUNT || buckets[candidate].empty())
+            continue;
+        opponent = buckets[candidate].front();
+        buckets[candidate].pop_front();
+        where.erase(opponent);
+        return true;
+    }
+
+    buckets[b].push_back(login);
+    where[login] = Entry{b, std::prev(buckets[b].end())};
+    return false;
+}
+
+void Matchmaker::requeue(const std::string& login, int rating) {
+    if (where.count(login))
+        return;
+    int b = bucket_of(rating);
+    buckets[b].push_front(login);
+    where[login] = Entry{b, buckets[b].begin()};
+}
+
+bool Matchmaker::remove(const std::string& login) {
+    auto it = where.find(login);
+    if (it == where.end())
+        return false;
+    buckets[it->second.bucket].erase(it->second.it);
+    where.erase(it);
+    return true;
+}
+
+bool Matchmaker::is_waiting(const std::string& login) const {
+    return where.count(login) != 0;
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <list>
+#include <string>
+#include <unordered_map>
+
+// Очередь быстрой игры, разбитая на корзины по рейтингу. Игрок сравнивается
+// только со своей и соседними корзинами, поэтому подбор пары - O(1).
+class Matchmaker {
+  public:
+    static constexpr int BUCKET_WIDTH = 100;
+    static constexpr int BUCKET_COUNT = 32;
+
+    // true и opponent, если нашёлся соперник; иначе игрок встаёт в очередь
+    bool enqueue(const std::string& login, int rating, std::string& opponent);
+    // Возвращает игрока в очередь без подбора пары: в начало его корзины,
+    // как ждавшего дольше всех
+    void requeue(const std::string& login, int rating);
+    bool remove(const std::string& login);
+    bool is_waiting(const std::string& login) const;
+    size_t waiting() const { return where.size(); }
+
+  private:
+    struct Entry {
+        int bucket;
+        std::list<std::string>::iterator it;
+    };
+
+    std::list<std::string> buckets[BUCKET_COUNT];
+    std::unordered_map<std::string, Entry> where;
+
+    static int bucket_of(int rating);
+};
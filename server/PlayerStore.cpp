@@ -0,0 +1,222 @@
+#include "PlayerStore.hpp"
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+PlayerStore::PlayerStore(const std::string& path) : path(path), fd(-1), table(nullptr) {
+    void* addr;
+    if (path.empty()) {
+        addr = mmap(nullptr, sizeof(PlayerTable), PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    } else {
+        fd = open(path.c_str(), O_CREAT | O_RDWR | O_CLOEXEC, 0644);
+        if (fd < 0)
+            throw std::runtime_error("cannot open player store " + path);
+        struct stat st;
+        if (fstat(fd, &st) != 0 ||
+            (st.st_size < static_cast<off_t>(sizeof(PlayerTable)) &&
+             ftruncate(fd, sizeof(PlayerTable)) != 0)) {
+            close(fd);
+            throw std::runtime_error("cannot size player store " + path);
+        }
+        addr = mmap(nullptr, sizeof(PlayerTable), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    if (addr == MAP_FAILED) {
+        if (fd >= 0)
+            close(fd);
+        throw std::runtime_error("cannot map player store");
+    }
+    table = static_cast<PlayerTable*>(addr);
+
+    lock();
+    if (table->magic != PLAYERS_MAGIC || table->version != PLAYERS_VERSION ||
+        table->capacity != PLAYER_TABLE_SIZE) {
+        std::memset(table, 0, sizeof(PlayerTable));
+        table->capacity = PLAYER_TABLE_SIZE;
+        table->version = PLAYERS_VERSION;
+        table->magic = PLAYERS_MAGIC;
+    }
+    // Сервер мог упасть между обновлением записи и верхушки: один проход при запуске
+    rebuild_top();
+    unlock();
+}
+
+PlayerStore::~PlayerStore() {
+    if (table)
+        munmap(table, sizeof(PlayerTable));
+    if (fd >= 0)
+        close(fd);
+}
+
+void PlayerStore::lock() {
+    if (fd >= 0)
+        flock(fd, LOCK_EX);
+}
+
+void PlayerStore::unlock() {
+    if (fd >= 0)
+        flock(fd, LOCK_UN);
+}
+
+size_t PlayerStore::slot(const std::string& login) const {
+    uint32_t h = 2166136261u;
+    for (unsigned char c : login) {
+        h ^= c;
+        h *= 16777619u;
+    }
+    return h & (PLAYER_TABLE_SIZE - 1);
+}
+
+size_t PlayerStore::index_of(const std::string& login, bool create) {
+    size_t i = slot(login);
+    // Записи не удаляются, поэтому цепочка обрывается на первой пустой
+    for (size_t n = 0; n < PLAYER_TABLE_SIZE; ++n, i = (i + 1) & (PLAYER_TABLE_SIZE - 1)) {
+        PlayerRecord& r = table->entries[i];
+        if (r.used && std::strncmp(r.login, login.c_str(), LOGIN_MAX) == 0)
+            return i;
+        if (!r.used) {
+            if (!create || table->players >= PLAYER_TABLE_LIMIT)
+                return PLAYER_TABLE_SIZE;
+            std::memset(&r, 0, sizeof(r));
+            std::strncpy(r.login, login.c_str(), LOGIN_MAX - 1);
+            r.rating = INITIAL_RATING;
+            r.used = 1;
+            table->players++;
+            return i;
+        }
+    }
+    return PLAYER_TABLE_SIZE;
+}
+
+int PlayerStore::rating_of(const std::string& login) {
+    lock();
+    size_t i = index_of(login, false);
+    int rating = i < PLAYER_TABLE_SIZE ? table->entries[i].rating : INITIAL_RATING;
+    unlock();
+    return rating;
+}
+
+bool PlayerStore::find(const std::string& login, PlayerRecord& out) {
+    lock();
+    size_t i = index_of(login, false);
+    if (i < PLAYER_TABLE_SIZE)
+        out = table->entries[i];
+    unlock();
+    return i < PLAYER_TABLE_SIZE;
+}
+
+int PlayerStore::record_game(const std::string& winner, const PlayerTally& w,
+                             const std::string& loser, const PlayerTally& l) {
+    lock();
+    size_t wi = index_of(winner, true);
+    size_t li = index_of(loser, true);
+    int rw = wi < PLAYER_TABLE_SIZE ? table->entries[wi].rating : INITIAL_RATING;
+    int rl = li < PLAYER_TABLE_SIZE ? table->entries[li].rating : INITIAL_RATING;
+    double expected = 1.0 / (1.0 + std::pow(10.0, (rl - rw) / 400.0));
+    int delta = static_cast<int>(std::lround(32.0 * (1.0 - expected)));
+
+    if (wi < PLAYER_TABLE_SIZE) {
+        PlayerRecord& r = table->entries[wi];
+        r.rating += delta;
+        r.wins++;
+        r.shots += w.shots;
+        r.hits += w.hits;
+        update_top(static_cast<uint32_t>(wi));
+    }
+    if (li < PLAYER_TABLE_SIZE) {
+        PlayerRecord& r = table->entries[li];
+        r.rating -= delta;
+        r.losses++;
+        r.shots += l.shots;
+        r.hits += l.hits;
+        update_top(static_cast<uint32_t>(li));
+    }
+    unlock();
+    return delta;
+}
+
+void PlayerStore::update_top(uint32_t idx) {
+    uint32_t* top = table->top;
+    uint32_t& count = table->top_count;
+    auto rating = [this](uint32_t i) { return table->entries[i].rating; };
+
+    // Игрок выходит из верхушки и возвращается в неё на новое место
+    uint32_t* end = top + count;
+    uint32_t* it = std::find(top, end, idx);
+    if (it != end) {
+        std::copy(it + 1, end, it);
+        count--;
+    }
+
+    bool insert = true;
+    if (count == LEADERBOARD_KEEP) {
+        uint32_t last = top[count - 1];
+        if (rating(idx) <= rating(last)) {
+            table->top_bound = std::max(table->top_bound, rating(idx));
+            insert = false;
+        } else {
+            // Вытесненный становится самым сильным из тех, кого нет в верхушке
+            table->top_bound = std::max(table->top_bound, rating(last));
+            count--;
+        }
+    }
+    if (insert) {
+        uint32_t* pos = std::upper_bound(top, top + count, idx, [&](uint32_t a, uint32_t b) {
+            return rating(a) > rating(b);
+        });
+        std::copy_backward(pos, top + count, top + count + 1);
+        *pos = idx;
+        count++;
+    }
+
+    size_t need = std::min<size_t>(LEADERBOARD_SHOW, table->players);
+    if (certain_top() < need)
+        rebuild_top();
+}
+
+size_t PlayerStore::certain_top() const {
+    size_t n = 0;
+    while (n < table->top_count && table->entries[table->top[n]].rating >= table->top_bound)
+        n++;
+    return n;
+}
+
+void PlayerStore::rebuild_top() {
+    std::vector<uint32_t> all;
+    for (uint32_t i = 0; i < PLAYER_TABLE_SIZE; i++) {
+        if (table->entries[i].used)
+            all.push_back(i);
+    }
+    auto higher = [this](uint32_t a, uint32_t b) {
+        return table->entries[a].rating > table->entries[b].rating;
+    };
+    size_t keep = std::min(all.size(), LEADERBOARD_KEEP);
+    std::partial_sort(all.begin(), all.begin() + keep, all.end(), higher);
+
+    std::copy(all.begin(), all.begin() + keep, table->top);
+    table->top_count = static_cast<uint32_t>(keep);
+    int32_t bound = INT_MIN;
+    for (size_t i = keep; i < all.size(); i++)
+        bound = std::max(bound, table->entries[all[i]].rating);
+    table->top_bound = bound;
+    table->rebuilds++;
+}
+
+std::vector<PlayerRecord> PlayerStore::leaderboard(size_t n) {
+    lock();
+    size_t shown = std::min(n, certain_top());
+    std::vector<PlayerRecord> res;
+    for (size_t i = 0; i < shown; i++)
+        res.push_back(table->entries[table->top[i]]);
+    unlock();
+    return res;
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../include/SharedTypes.hpp"
+
+// Учётные записи игроков: таблица с открытой адресацией по логину в файле,
+// отображённом в память, и отсортированная верхушка рейтинга рядом с ней.
+constexpr uint32_t PLAYERS_MAGIC = 0x50594C42; // "BLYP"
+constexpr uint32_t PLAYERS_VERSION = 1;
+constexpr size_t PLAYER_TABLE_SIZE = 4096;
+// Новые учётные записи не заводятся, когда таблица заполнена на 3/4
+constexpr size_t PLAYER_TABLE_LIMIT = PLAYER_TABLE_SIZE / 4 * 3;
+constexpr size_t LEADERBOARD_SHOW = 10;
+// Запас сверх показываемых мест: верхушку приходится пересобирать, только
+// когда из неё выпадет больше LEADERBOARD_KEEP - LEADERBOARD_SHOW игроков
+constexpr size_t LEADERBOARD_KEEP = 32;
+constexpr int32_t INITIAL_RATING = 1000;
+
+struct PlayerRecord {
+    char login[LOGIN_MAX];
+    int32_t rating;
+    uint32_t wins;
+    uint32_t losses;
+    uint32_t shots;
+    uint32_t hits;
+    uint32_t used;
+};
+
+// Выстрелы и попадания игрока за одну партию
+struct PlayerTally {
+    uint32_t shots;
+    uint32_t hits;
+};
+
+struct PlayerTable {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t capacity;
+    uint32_t players;
+    // Верхушка: номера записей по убыванию рейтинга. Ни у кого вне её рейтинг
+    // не выше top_bound, поэтому записи не ниже top_bound — точно лучшие
+    uint32_t top_count;
+    int32_t top_bound;
+    uint32_t top[LEADERBOARD_KEEP];
+    uint64_t rebuilds;
+    PlayerRecord entries[PLAYER_TABLE_SIZE];
+};
+
+class PlayerStore {
+  public:
+    // Пустой путь: таблица живёт только в памяти процесса
+    explicit PlayerStore(const std::string& path = "");
+    ~PlayerStore();
+
+    int rating_of(const std::string& login);
+    bool find(const std::string& login, PlayerRecord& out);
+    // Эло с K = 32 и счёт побед и выстрелов; возвращает изменение рейтинга победителя
+    int record_game(const std::string& winner, const PlayerTally& w, const std::string& loser,
+                    const PlayerTally& l);
+    // Лучшие n игроков прямо из верхушки, без обхода таблицы
+    std::vector<PlayerRecord> leaderboard(size_t n = LEADERBOARD_SHOW);
+
+    size_t size() const { return table->players; }
+    uint64_t rebuilds() const { return table->rebuilds; }
+    bool is_persistent() const { return fd >= 0; }
+
+  private:
+    std::string path;
+    int fd;
+    PlayerTable* table;
+
+    // Файл разделяют сегменты сервера: изменения под flock
+    void lock();
+    void unlock();
+    size_t slot(const std::string& login) const;
+    // Номер записи игрока; при create заводит новую. PLAYER_TABLE_SIZE — нет места
+    size_t index_of(const std::string& login, bool create);
+    void update_top(uint32_t idx);
+    size_t certain_top() const;
+    void rebuild_top();
+};
@@ -0,0 +1,178 @@
+#include "ReplayStreamer.hpp"
+#include "../include/Events.hpp"
+#include "Trace.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+// Кольцо клиента полно: через сколько попробовать снова
+constexpr uint64_t REPLAY_RETRY_NS = 2000000;
+// Клиент так долго не забирает кадры - повтор бросается
+constexpr uint64_t REPLAY_STALL_NS = 30000000000ull;
+constexpr uint64_t REPLAY_IDLE_NS = 1000000000ull;
+
+ReplayFrame to_frame(uint16_t stream, const JournalRecord& r) {
+    ReplayFrame f;
+    std::memset(&f, 0, sizeof(f));
+    f.stream = stream;
+    f.type = r.type;
+    f.seat = r.seat;
+    f.x = r.x;
+    f.y = r.y;
+    f.size = r.size;
+    f.result = r.result;
+    f.horizontal = r.horizontal;
+    f.t_ms = static_cast<uint32_t>(r.t_us / 1000);
+    std::strncpy(f.login, r.login.c_str(), LOGIN_MAX - 1);
+    return f;
+}
+
+ReplayFrame done_frame(uint16_t stream, bool ok) {
+    ReplayFrame f;
+    std::memset(&f, 0, sizeof(f));
+    f.stream = stream;
+    f.type = REPLAY_DONE;
+    f.result = ok ? 0 : 1;
+    return f;
+}
+
+} // namespace
+
+ReplayStreamer::ReplayStreamer()
+    // Кольца клиентов переживают тёплый перезапуск: номера начинаются не с нуля,
+    // чтобы не совпасть с кадрами, оставшимися от прежнего сервера
+    : next_id(static_cast<uint16_t>(monotonic_ns())), stopping(false) {
+    worker = std::thread([this] { run(); });
+}
+
+ReplayStreamer::~ReplayStreamer() {
+    {
+        std::lock_guard<std::mutex> g(lock);
+        stopping = true;
+    }
+    cond.notify_one();
+    worker.join();
+}
+
+uint16_t ReplayStreamer::start(ClientSlot* slot, const std::string& login,
+                               const std::string& path, double speed) {
+    std::unique_ptr<Stream> s(new Stream());
+    s->slot = slot;
+    s->login = login;
+    s->path = path;
+    s->speed = speed;
+    s->start_ns = monotonic_ns();
+    s->due_ns = s->start_ns;
+    s->progress_ns = s->start_ns;
+    s->has_next = false;
+    s->finished = false;
+
+    std::lock_guard<std::mutex> g(lock);
+    streams.erase(std::remove_if(streams.begin(), streams.end(),
+                                 [&](const std::unique_ptr<Stream>& x) { return x->login == login; }),
+                  streams.end());
+    s->id = ++next_id;
+    uint16_t id = s->id;
+    streams.push_back(std::move(s));
+    cond.notify_one();
+    return id;
+}
+
+void ReplayStreamer::cancel(const std::string& login) {
+    // Поток повторов трогает слоты только под этим мьютексом
+    std::lock_guard<std::mutex> g(lock);
+    streams.erase(std::remove_if(streams.begin(), streams.end(),
+                                 [&](const std::unique_ptr<Stream>& x) { return x->login == login; }),
+                  streams.end());
+}
+
+size_t ReplayStreamer::active() {
+    std::lock_guard<std::mutex> g(lock);
+    return streams.size();
+}
+
+void ReplayStreamer::run() {
+    std::unique_lock<std::mutex> g(lock);
+    while (!stopping) {
+        uint64_t now = monotonic_ns();
+        uint64_t wake = now + REPLAY_IDLE_NS;
+        for (size_t i = 0; i < streams.size();) {
+            Stream& s = *streams[i];
+            if (s.due_ns <= now && !pump(s, now)) {
+                streams.erase(streams.begin() + i);
+            } else {
+                wake = std::min(wake, s.due_ns);
+                ++i;
+            }
+            // Сервер ждёт этот мьютекс в start и cancel не дольше одной пачки
+            g.unlock();
+            g.lock();
+        }
+        if (stopping)
+            break;
+        now = monotonic_ns();
+        if (wake > now)
+            cond.wait_for(g, std::chrono::nanoseconds(wake - now));
+    }
+}
+
+bool ReplayStreamer::pump(Stream& s, uint64_t now) {
+    if (!s.reader && !s.finished) {
+        try {
+            s.reader.reset(new JournalReader(s.path));
+        } catch (const std::exception& ex) {
+            std::cerr << "Replay: " << ex.what() << std::endl;
+            s.outbox.push_back(done_frame(s.id, false));
+            s.finished = true;
+        }
+    }
+
+    // Кадров на руках не больше, чем вмещает кольцо
+    while (!s.finished && s.outbox.size() < REPLAY_QUEUE_SIZE) {
+        try {
+            if (!s.has_next && !s.reader->next(s.next)) {
+                s.outbox.push_back(done_frame(s.id, true));
+                s.finished = true;
+                break;
+            }
+        } catch (const std::exception& ex) {
+            std::cerr << "Replay: " << s.path << ": " << ex.what() << std::endl;
+            s.outbox.push_back(done_frame(s.id, false));
+            s.finished = true;
+            break;
+        }
+        s.has_next = true;
+        if (s.speed > 0) {
+            uint64_t due = s.start_ns + static_cast<uint64_t>(s.next.t_us * 1000.0 / s.speed);
+            if (due > now) {
+                s.due_ns = due;
+                break;
+            }
+        }
+        s.outbox.push_back(to_frame(s.id, s.next));
+        s.has_next = false;
+    }
+
+    size_t pushed = 0;
+    if (!s.outbox.empty()) {
+        pushed = push_replay_frames(s.slot, s.outbox.data(), s.outbox.size());
+        s.outbox.erase(s.outbox.begin(), s.outbox.begin() + pushed);
+    }
+    // Простоем считается только полное кольцо, а не пауза между ходами
+    if (s.outbox.empty() || pushed > 0)
+        s.progress_ns = now;
+    if (s.finished && s.outbox.empty())
+        return false;
+    if (now - s.progress_ns > REPLAY_STALL_NS) {
+        std::cout << "Replay: " << s.login << " stopped reading, replay dropped\n";
+        return false;
+    }
+    // Кольцо полно - ждём, пока клиент его разберёт
+    if (!s.outbox.empty())
+        s.due_ns = now + REPLAY_RETRY_NS;
+    return true;
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../include/SharedTypes.hpp"
+#include "Journal.hpp"
+
+// Повтор завершённых партий: отдельный поток читает журналы и пачками кладёт
+// кадры в кольцо повтора слота клиента. Игровой цикл сервера только находит
+// журнал и передаёт его сюда, партия заново через Game не проигрывается.
+class ReplayStreamer {
+  public:
+    ReplayStreamer();
+    ~ReplayStreamer();
+
+    // speed: во сколько раз быстрее, чем шла партия; 0 - всё сразу.
+    // Прежний повтор того же клиента прерывается. Возвращает номер потока
+    uint16_t start(ClientSlot* slot, const std::string& login, const std::string& path,
+                   double speed);
+    // После возврата поток повторов слот клиента больше не трогает
+    void cancel(const std::string& login);
+    size_t active();
+
+  private:
+    struct Stream {
+        ClientSlot* slot;
+        std::string login;
+        uint16_t id;
+        std::string path;
+        // Журнал открывается уже в потоке повторов
+        std::unique_ptr<JournalReader> reader;
+        double speed;
+        uint64_t start_ns;
+        // Когда снова заняться потоком
+        uint64_t due_ns;
+        // Последнее продвижение: клиент, который не читает кольцо, отключается
+        uint64_t progress_ns;
+        // Прочитанная, но ещё не отправленная запись
+        JournalRecord next;
+        bool has_next;
+        // Кадры, которые не поместились в кольцо клиента
+        std::vector<ReplayFrame> outbox;
+        bool finished;
+    };
+
+    std::mutex lock;
+    std::condition_variable cond;
+    std::vector<std::unique_ptr<Stream>> streams;
+    uint16_t next_id;
+    bool stopping;
+    std::thread worker;
+
+    void run();
+    // Отправляет всё, что уже пора; false, когда поток закончен
+    bool pump(Stream& s, uint64_t now);
+};
@@ -1,86 +1,267 @@
 #include "Server.hpp"
+#include "../include/Events.hpp"
+#include "../include/SeqLock.hpp"
 
 #include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
 #include <cstring>
 #include <iostream>
 #include <sstream>
+#include <thread>
+
+namespace {
+
+// Сколько времени боты стреляют за один проход между сообщениями
+constexpr uint64_t BOT_PASS_NS = 1000000;
+// Ходов в очереди перебора не больше этого (по бюджету решателя на каждый);
+// сверх него боты BOT_EXACT стреляют по карте плотности
+constexpr size_t BOT_SOLVER_BACKLOG = 8;
+constexpr size_t MAX_TOURNAMENT_ENTRANTS = 2 * MAX_GAMES;
+// Столько ходов подряд за игрока делает сервер, потом засчитывает поражение
+constexpr uint8_t MAX_MISSED_TURNS = 3;
+constexpr uint64_t NS_PER_SEC = 1000000000ull;
+// Столько игровых записей подряд разбирается, пока лобби ждёт; потом одна из лобби
+constexpr uint32_t GAME_STREAK_LIMIT = 8;
+// Сколько последних времён ответа хранится для перцентилей
+constexpr size_t LATENCY_SAMPLES = 1024;
+
+// "[bot]exact#3" -> BOT_EXACT; у BOT_LOGIN и нераспознанных имён - density
+BotStrategy strategy_of(const std::string& login) {
+    BotStrategy s = BOT_DENSITY;
+    size_t prefix = std::strlen(BOT_LOGIN);
+    if (login.size() > prefix)
+        parse_bot_strategy(login.substr(prefix, login.find('#') - prefix), s);
+    return s;
+}
 
-Server::Server() : shm(true), root(shm.root()), setup_done(false) {
-    if (shm.is_owner()) {
+} // namespace
+
+Server::Server(const ShmOptions& opts)
+    : shm(true, shard_options(opts)), root(shm.root()), shard(opts.shard), setup_done(false),
+      reaper(root), fleets(monotonic_ns()), game_streak(0), lobby_forced(0),
+      clocks(monotonic_ns()), clock_firing(false),
+      stand_in(monotonic_ns(), BOT_RANDOM), players(new PlayerStore()), next_tournament_id(1),
+      launching(false) {
+    std::fill(game_slots, game_slots + MAX_GAMES, nullptr);
+    std::fill(last_sender, last_sender + LANE_COUNT, MAX_CLIENTS);
+    free_games.reserve(MAX_GAMES);
+    free_clients.reserve(MAX_CLIENTS);
+    if (opts.shard_count > 1)
+        directory.reset(new ShardDirectory(false, opts));
+    if (shm.is_persistent() && shm.has_valid_state()) {
+        adopt_shared_objects();
+    } else if (shm.is_owner()) {
         init_shared_objects();
     }
+    std::cout << "Server: segment " << shm.mapping_report() << "\n";
 }
 
 Server::~Server() {
-    for (auto& pair : games_map) {
-        delete pair.second;
+    for (Game* game : game_slots) {
+        if (!game)
+            continue;
+        // Постоянный сегмент переживает сервер вместе с играми
+        if (shm.is_persistent())
+            game->detach();
+        delete game;
     }
 }
 
-void Server::init_shared_objects() {
+void Server::init_sync_objects() {
     pthread_mutexattr_t mattr;
     pthread_condattr_t cattr;
     pthread_mutexattr_init(&mattr);
     pthread_mutexattr_setpshared(&mattr, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_setrobust(&mattr, PTHREAD_MUTEX_ROBUST);
     pthread_condattr_init(&cattr);
     pthread_condattr_setpshared(&cattr, PTHREAD_PROCESS_SHARED);
 
     pthread_mutex_init(&root->mutex, &mattr);
     pthread_cond_init(&root->server_cond, &cattr);
+    pthread_cond_init(&root->queue_cond, &cattr);
+    root->queue_waiters = 0;
+    for (size_t i = 0; i < MAX_CLIENTS; ++i)
+        pthread_cond_init(&root->clients[i].cond, &cattr);
+
+    pthread_mutexattr_destroy(&mattr);
+    pthread_condattr_destroy(&cattr);
+}
+
+void Server::init_shared_objects() {
+    root->magic = 0;
+    init_sync_objects();
 
-    root->q_head = root->q_tail = 0;
     root->game_count = 0;
+    root->lock_recoveries = 0;
 
-    for (size_t i = 0; i < QUEUE_SIZE; ++i)
-        root->queue[i].used = false;
+    for (SharedMemoryRoot::RequestQueue& q : root->lanes) {
+        q.head = q.tail = 0;
+        q.ready = 0;
+        for (Message& m : q.entries)
+            m.state = MSG_FREE;
+    }
     for (size_t i = 0; i < MAX_CLIENTS; ++i) {
+        root->clients[i].generation = 0;
         root->clients[i].used = false;
+        root->clients[i].pid = 0;
+        root->clients[i].notify_seq = 0;
+        reset_events(&root->clients[i]);
+        reset_replay(&root->clients[i]);
         root->clients[i].has_response = false;
         root->clients[i].current_game_id = -1;
         root->clients[i].setup_complete = false;
-        pthread_cond_init(&root->clients[i].cond, &cattr);
+        std::fill(root->clients[i].in_flight, root->clients[i].in_flight + LANE_COUNT, 0);
         std::memset(root->clients[i].login, 0, sizeof(root->clients[i].login));
         std::memset(root->clients[i].response, 0, sizeof(root->clients[i].response));
     }
 
-    for (size_t i = 0; i < 16; ++i) {
+    for (size_t i = 0; i < MAX_GAMES; ++i) {
+        root->games[i].generation = 0;
         root->games[i].used = false;
     }
+    rebuild_slot_index();
 
-    pthread_mutexattr_destroy(&mattr);
-    pthread_condattr_destroy(&cattr);
+    root->layout_version = SHM_LAYOUT_VERSION;
+    root->root_size = sizeof(SharedMemoryRoot);
+    root->magic = SHM_MAGIC;
 
     setup_done = true;
     std::cout << "Server: shared memory initialized\n";
 }
 
-ClientSlot* Server::find_or_create_client(const char* login) {
+void Server::adopt_shared_objects() {
+    auto start = std::chrono::steady_clock::now();
+
+    // Если предыдущий сервер умер, держа мьютекс, объекты синхронизации
+    // непригодны: пересоздаём их, данные сегмента при этом не трогаем
+    timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += 1;
+    int rc = pthread_mutex_timedlock(&root->mutex, &deadline);
+    if (rc == EOWNERDEAD) {
+        pthread_mutex_consistent(&root->mutex);
+        repair_root(root);
+        rc = 0;
+    }
+    if (rc == 0) {
+        pthread_mutex_unlock(&root->mutex);
+    } else {
+        std::cout << "Server: shared mutex is stuck, reinitializing sync objects\n";
+        init_sync_objects();
+    }
+
+    lock_root(root);
+    // Сообщение, которое разбиралось на месте в момент гибели прежнего
+    // сервера, остаётся в очереди и будет разобрано ещё раз
+    for (SharedMemoryRoot::RequestQueue& q : root->lanes) {
+        if (q.head >= QUEUE_SIZE || q.tail >= QUEUE_SIZE)
+            q.head = q.tail = 0;
+        q.ready = 0;
+        for (size_t i = q.head; i != q.tail; i = (i + 1) % QUEUE_SIZE)
+            q.ready += q.entries[i].state == MSG_READY;
+    }
+    // Отправители, умершие, пока сервера не было, не опубликуют свои записи
+    reclaim_abandoned_root(root);
+
+    size_t clients = 0;
     for (size_t i = 0; i < MAX_CLIENTS; ++i) {
-        if (root->clients[i].used && std::strncmp(root->clients[i].login, login, LOGIN_MAX) == 0) {
-            return &root->clients[i];
+        if (root->clients[i].used) {
+            clients++;
+            // Каталог создаётся заново при каждом запуске
+            if (directory)
+                directory->assign(root->clients[i].login, shard);
         }
     }
-    for (size_t i = 0; i < MAX_CLIENTS; ++i) {
-        if (!root->clients[i].used) {
-            root->clients[i].used = true;
-            std::strncpy(root->clients[i].login, login, LOGIN_MAX - 1);
-            root->clients[i].has_response = false;
-            root->clients[i].current_game_id = -1;
-            root->clients[i].setup_complete = false;
-            std::memset(root->clients[i].response, 0, RESP_MAX);
-            return &root->clients[i];
+
+    root->game_count = 0;
+    for (size_t i = 0; i < MAX_GAMES; ++i) {
+        if (root->games[i].used) {
+            game_slots[i] = attach_game(static_cast<int>(i), root);
+            root->game_count++;
+            // Бот не хранит состояния, кроме генератора: достаточно создать нового
+            for (const char* login : {root->games[i].player1, root->games[i].player2}) {
+                if (is_bot_login(login)) {
+                    bots[game_slots[i]->get_id()].seats.emplace_back(
+                        login, std::unique_ptr<Bot>(new Bot(monotonic_ns() ^ i, strategy_of(login))));
+                }
+            }
         }
     }
-    return nullptr;
+    rebuild_slot_index();
+    pthread_mutex_unlock(&root->mutex);
+    for (auto& pair : bots)
+        schedule_bot_turns(pair.first);
+
+    setup_done = true;
+    double ms =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Server: adopted existing shared memory (" << root->game_count << " games, "
+              << clients << " clients) in " << ms << " ms\n";
 }
 
-ClientSlot* Server::find_client(const char* login) {
-    for (size_t i = 0; i < MAX_CLIENTS; ++i) {
-        if (root->clients[i].used && std::strncmp(root->clients[i].login, login, LOGIN_MAX) == 0) {
-            return &root->clients[i];
-        }
+void Server::rebuild_slot_index() {
+    free_games.clear();
+    free_clients.clear();
+    clients_by_login.clear();
+    // Стеки отдают младшие слоты первыми
+    for (int i = MAX_GAMES - 1; i >= 0; --i) {
+        if (!root->games[i].used)
+            free_games.push_back(i);
+    }
+    for (size_t i = MAX_CLIENTS; i-- > 0;) {
+        if (root->clients[i].used)
+            clients_by_login[root->clients[i].login] = &root->clients[i];
+        else
+            free_clients.push_back(i);
     }
-    return nullptr;
+}
+
+ClientSlot* Server::find_or_create_client(const char* login) {
+    ClientSlot* c = find_client(login);
+    if (c || free_clients.empty())
+        return c;
+
+    c = &root->clients[free_clients.back()];
+    free_clients.pop_back();
+    c->generation++;
+    c->used = true;
+    std::strncpy(c->login, login, LOGIN_MAX - 1);
+    c->pid = 0;
+    reset_events(c);
+    reset_replay(c);
+    c->has_response = false;
+    c->current_game_id = -1;
+    c->setup_complete = false;
+    std::memset(c->response, 0, RESP_MAX);
+    clients_by_login[c->login] = c;
+    return c;
+}
+
+ClientSlot* Server::find_client(const char* login) {
+    auto it = clients_by_login.find(login);
+    return it != clients_by_login.end() ? it->second : nullptr;
+}
+
+void Server::release_client(ClientSlot* c) {
+    clients_by_login.erase(c->login);
+    c->used = false;
+    c->pid = 0;
+    c->has_response = false;
+    c->current_game_id = -1;
+    c->setup_complete = false;
+    std::memset(c->login, 0, LOGIN_MAX);
+    std::memset(c->response, 0, RESP_MAX);
+    free_clients.push_back(static_cast<size_t>(c - root->clients));
+}
+
+int Server::remote_shard_of(const char* login) {
+    if (!directory)
+        return -1;
+    int where = directory->lookup(login);
+    return where != shard ? where : -1;
 }
 
 std::vector<std::string> Server::list_clients() {
@@ -99,12 +280,15 @@ std::vector<std::string> Server::list_clients() {
 
 std::vector<std::string> Server::list_available_games() {
     std::vector<std::string> res;
-    for (int i = 0; i < 16; i++) {
+    for (size_t i = 0; i < MAX_GAMES; i++) {
         if (root->games[i].used && root->games[i].is_public &&
             root->games[i].state == GAME_WAITING) {
             std::string info = "🎮 " + std::string(root->games[i].game_name) +
-                               " (ID: " + std::to_string(i) +
+                               " (ID: " +
+                               std::to_string(make_game_handle(i, root->games[i].generation)) +
                                ") - создатель: " + std::string(root->games[i].player1);
+            if (root->games[i].rules != RULES_CLASSIC)
+                info += " [" + std::string(rules_info(root->games[i].rules).name) + "]";
             res.emplace_back(info);
         }
     }
@@ -112,36 +296,27 @@ std::vector<std::string> Server::list_available_games() {
 }
 
 void Server::send_response_to(const char* login, const char* text) {
-    pthread_mutex_lock(&root->mutex);
+    lock_root(root);
     ClientSlot* cl = find_client(login);
     if (cl) {
         std::strncpy(cl->response, text, RESP_MAX - 1);
         cl->has_response = true;
         pthread_cond_signal(&cl->cond);
+        notify_client(cl);
     }
     pthread_mutex_unlock(&root->mutex);
 }
 
 int Server::create_private_game(const std::string& creator, const std::string& target) {
-    if (root->game_count >= 16)
+    if (root->game_count >= MAX_GAMES)
         return -1;
 
     std::string game_name = creator + "_vs_" + target;
-    int game_id = -1;
-
-    for (int i = 0; i < 16; i++) {
-        if (!root->games[i].used) {
-            game_id = i;
-            break;
-        }
-    }
-
-    if (game_id == -1)
+    Game* game = new_game(game_name, creator, false);
+    if (!game)
         return -1;
-
-    Game* game = new Game(game_name, creator, root, false);
-    games_map[game_id] = game;
-    root->game_count++;
+    int game_id = game->get_id();
+    matchmaker.remove(creator);
 
     ClientSlot* client = find_client(creator.c_str());
     if (client) {
@@ -153,31 +328,23 @@ int Server::create_private_game(const std::string& creator, const std::string& t
     return game_id;
 }
 
-int Server::create_public_game(const std::string& game_name, const std::string& creator) {
-    if (root->game_count >= 16)
+int Server::create_public_game(const std::string& game_name, const std::string& creator,
+                               RulesId rules) {
+    if (root->game_count >= MAX_GAMES)
         return -1;
 
-    for (int i = 0; i < 16; i++) {
+    for (size_t i = 0; i < MAX_GAMES; i++) {
         if (root->games[i].used && std::strcmp(root->games[i].game_name, game_name.c_str()) == 0) {
             return -2; 
         }
     }
 
-    int game_id = -1;
-    for (int i = 0; i < 16; i++) {
-        if (!root->games[i].used) {
-            game_id = i;
-            break;
-        }
-    }
-
-    if (game_id == -1)
-        return -1;
-
     // Создаем игру
-    Game* game = new Game(game_name, creator, root, true);
-    games_map[game_id] = game;
-    root->game_count++;
+    Game* game = new_game(game_name, creator, true, rules);
+    if (!game)
+        return -1;
+    int game_id = game->get_id();
+    matchmaker.remove(creator);
 
     ClientSlot* client = find_client(creator.c_str());
     if (client) {
@@ -191,26 +358,39 @@ int Server::create_public_game(const std::string& game_name, const std::string&
 }
 
 Game* Server::find_game_by_name(const std::string& game_name) {
-    for (auto& pair : games_map) {
-        if (pair.second->get_game_name() == game_name) {
-            return pair.second;
+    for (Game* game : game_slots) {
+        if (game && game->get_game_name() == game_name) {
+            return game;
         }
     }
     return nullptr;
 }
 
+Game* Server::new_game(const std::string& name, const std::string& creator, bool is_public,
+                       RulesId rules) {
+    if (free_games.empty())
+        return nullptr;
+    int slot = free_games.back();
+    free_games.pop_back();
+
+    Game* game = make_game(rules, slot, name, creator, root, is_public);
+    game_slots[slot] = game;
+    open_journal(game);
+    root->game_count++;
+    return game;
+}
+
 Game* Server::get_game(int game_id) {
-    auto it = games_map.find(game_id);
-    if (it != games_map.end()) {
-        return it->second;
-    }
-    return nullptr;
+    if (game_id < 0)
+        return nullptr;
+    Game* game = game_slots[game_slot(game_id)];
+    // Дескриптор прежней игры слота не подходит: поколение уже другое
+    return game && game->get_id() == game_id ? game : nullptr;
 }
 
-void Server::remove_game(int game_id) {
-    auto it = games_map.find(game_id);
-    if (it != games_map.end()) {
-        Game* game = it->second;
+void Server::remove_game(int game_id, bool notify) {
+    Game* game = get_game(game_id);
+    if (game) {
 
         std::string player1 = game->get_player1();
         std::string player2 = game->get_player2();
@@ -220,7 +400,8 @@ void Server::remove_game(int game_id) {
             if (client1) {
                 client1->current_game_id = -1;
                 client1->setup_complete = false;
-                send_response_to(player1.c_str(), "GAME_REMOVED:Игра удалена");
+                if (notify)
+                    send_response_to(player1.c_str(), "GAME_REMOVED:Игра удалена");
             }
         }
 
@@ -229,17 +410,23 @@ void Server::remove_game(int game_id) {
             if (client2) {
                 client2->current_game_id = -1;
                 client2->setup_complete = false;
-                send_response_to(player2.c_str(), "GAME_REMOVED:Игра удалена");
+                if (notify)
+                    send_response_to(player2.c_str(), "GAME_REMOVED:Игра удалена");
             }
         }
 
+        size_t slot = game_slot(game_id);
         delete game;
-        games_map.erase(it);
+        game_slots[slot] = nullptr;
+        bots.erase(game_id);
         root->game_count--;
+        refresh_clock(game_id);
 
-        if (game_id >= 0 && game_id < 16) {
-            root->games[game_id].used = false;
+        {
+            GameWriteGuard guard(&root->games[slot]);
+            root->games[slot].used = false;
         }
+        free_games.push_back(static_cast<int>(slot));
     }
 }
 
@@ -252,11 +439,12 @@ bool Server::parse_ship_placement(const std::string& payload, uint8_t& size, uin
         return false;
     }
 
-    if (s < 1 || s > 4)
+    // Размеры поля и флот проверяет сама игра по своим правилам
+    if (s < 1 || s > MAX_SHIP_SIZE)
         return false;
-    if (x_pos < 0 || x_pos >= BOARD_SIZE)
+    if (x_pos < 0 || x_pos >= MAX_BOARD_SIZE)
         return false;
-    if (y_pos < 0 || y_pos >= BOARD_SIZE)
+    if (y_pos < 0 || y_pos >= MAX_BOARD_SIZE)
         return false;
     if (orientation != 'H' && orientation != 'V')
         return false;
@@ -276,9 +464,9 @@ bool Server::parse_shot(const std::string& payload, uint8_t& x, uint8_t& y) {
         return false;
     }
 
-    if (x_pos < 0 || x_pos >= BOARD_SIZE)
+    if (x_pos < 0 || x_pos >= MAX_BOARD_SIZE)
         return false;
-    if (y_pos < 0 || y_pos >= BOARD_SIZE)
+    if (y_pos < 0 || y_pos >= MAX_BOARD_SIZE)
         return false;
 
     x = static_cast<uint8_t>(x_pos);
@@ -314,6 +502,7 @@ void Server::handle_setup_complete(const Message& m) {
     game->set_setup_complete(m.from);
 
     send_response_to(m.from, "SETUP_COMPLETE:Waiting for opponent...");
+    schedule_bot_turns(client->current_game_id);
 }
 
 void Server::handle_place_ship(const Message& m) {
@@ -421,10 +610,17 @@ void Server::handle_surrender(const Message& m) {
     std::string opponent =
         (game->get_player1() == m.from) ? game->get_player2() : game->get_player1();
 
+    if (game->is_game_active()) {
+        record_result(game, opponent, m.from);
+    }
+
+    game->resign(m.from);
     send_response_to(m.from, "SURRENDER:You surrendered");
     send_response_to(opponent.c_str(), "OPPONENT_SURRENDERED:You win!");
 
-    remove_game(client->current_game_id);
+    int game_id = client->current_game_id;
+    remove_game(game_id);
+    match_finished(game_id, opponent);
 }
 
 void Server::handle_game_status(const Message& m) {
@@ -446,13 +642,719 @@ void Server::handle_game_status(const Message& m) {
     send_response_to(m.from, ("GAME_STATUS:\n" + status + "\n" + stats).c_str());
 }
 
+void Server::handle_client_gone(const Message& m) {
+    ClientSlot* c = find_client(m.from);
+    // Логин мог уже перерегистрироваться другим процессом
+    if (!c || c->pid != static_cast<pid_t>(std::atoi(m.payload))) {
+        return;
+    }
+    drop_client(c);
+    // Клиента могли убить посреди заполнения зарезервированной записи
+    lock_root(root);
+    reclaim_abandoned_root(root);
+    pthread_mutex_unlock(&root->mutex);
+}
+
+void Server::drop_client(ClientSlot* c) {
+    std::string login = c->login;
+    int forfeit_game = -1;
+    std::string forfeit_winner;
+
+    if (c->current_game_id != -1) {
+        int game_id = c->current_game_id;
+        Game* game = get_game(game_id);
+        if (game && game->is_player_in_game(login)) {
+            std::string other_player =
+                (game->get_player1() == login) ? game->get_player2() : game->get_player1();
+
+            // Отключение посреди партии - поражение, как сдача и выход
+            if (game->is_game_active())
+                record_result(game, other_player, login);
+            game->remove_player(login);
+
+            if (!other_player.empty()) {
+                send_response_to(other_player.c_str(),
+                                 ("OPPONENT_DISCONNECTED:Игрок " + login + " отключился").c_str());
+                ClientSlot* other_client = find_client(other_player.c_str());
+                if (other_client) {
+                    other_client->setup_complete = false;
+                }
+            }
+
+            c->current_game_id = -1;
+            if (tournament_games.count(game_id)) {
+                remove_game(game_id);
+                forfeit_game = game_id;
+                forfeit_winner = other_player;
+            } else if (game->is_empty() || is_bot_login(other_player.c_str())) {
+                remove_game(game_id);
+            }
+            refresh_clock(game_id);
+        }
+    }
+
+    matchmaker.remove(login);
+    if (replays)
+        replays->cancel(login);
+    reaper.unwatch(c - root->clients);
+    if (directory)
+        directory->release(login, shard);
+    release_client(c);
+    std::cout << "Client gone: " << login << '\n';
+
+    // Турнир узнаёт о поражении, когда слот уже свободен: ушедшего не назначат снова
+    if (forfeit_game != -1)
+        match_finished(forfeit_game, forfeit_winner);
+}
+
+int Server::rating_of(const std::string& login) const {
+    return players->rating_of(login);
+}
+
+void Server::record_result(Game* game, const std::string& winner, const std::string& loser) {
+    if (winner.empty() || loser.empty())
+        return;
+    // Партии ботов между собой (турниры) рейтинг не двигают
+    if (is_bot_login(winner.c_str()) && is_bot_login(loser.c_str()))
+        return;
+
+    PlayerTally w{0, 0};
+    PlayerTally l{0, 0};
+    game->get_shot_tally(winner, w.shots, w.hits);
+    game->get_shot_tally(loser, l.shots, l.hits);
+    int rw = rating_of(winner);
+    int rl = rating_of(loser);
+    int delta = players->record_game(winner, w, loser, l);
+    std::cout << "Rating: " << winner << " " << rw << " -> " << rw + delta << ", " << loser << " "
+              << rl << " -> " << rl - delta << std::endl;
+}
+
+void Server::handle_quick_match(const Message& m) {
+    ClientSlot* client = find_client(m.from);
+    if (!client) {
+        send_response_to(m.from, "MATCH_FAIL:Вы не зарегистрированы");
+        return;
+    }
+
+    if (std::strcmp(m.payload, "cancel") == 0) {
+        if (matchmaker.remove(m.from)) {
+            send_response_to(m.from, "MATCH_CANCELLED:Поиск соперника отменён");
+        } else {
+            send_response_to(m.from, "MATCH_FAIL:Вы не в очереди");
+        }
+        return;
+    }
+
+    if (client->current_game_id != -1) {
+        send_response_to(m.from, "MATCH_FAIL:Вы уже в игре");
+        return;
+    }
+    if (matchmaker.is_waiting(m.from)) {
+        send_response_to(m.from, "MATCH_QUEUED:Вы уже в очереди");
+        return;
+    }
+
+    int rating = rating_of(m.from);
+    std::string opponent;
+    if (!matchmaker.enqueue(m.from, rating, opponent)) {
+        char buf[RESP_MAX];
+        std::snprintf(buf, RESP_MAX, "MATCH_QUEUED:Ищем соперника (рейтинг %d)", rating);
+        send_response_to(m.from, buf);
+        return;
+    }
+
+    int game_id = create_private_game(opponent, m.from);
+    Game* game = get_game(game_id);
+    if (!game || !game->join(m.from)) {
+        // Ожидавший игрок об этой игре не узнал: без GAME_REMOVED, и обратно
+        // в очередь без подбора, чтобы не увести из неё ещё одного игрока
+        if (game)
+            remove_game(game_id, false);
+        matchmaker.requeue(opponent, rating_of(opponent));
+        send_response_to(m.from, "MATCH_FAIL:Сервер переполнен");
+        return;
+    }
+    client->current_game_id = game_id;
+    client->setup_complete = false;
+
+    char buf[RESP_MAX];
+    std::snprintf(buf, RESP_MAX, "MATCH_FOUND:%s:%d:%d", opponent.c_str(), rating_of(opponent),
+                  game_id);
+    send_response_to(m.from, buf);
+    std::snprintf(buf, RESP_MAX, "MATCH_FOUND:%s:%d:%d", m.from, rating, game_id);
+    send_response_to(opponent.c_str(), buf);
+
+    std::cout << "Quick match: " << opponent << " vs " << m.from << " (ID: " << game_id << ")\n";
+}
+
+void Server::finish_game(Game* game, int game_id) {
+    std::string winner = game->get_winner();
+    std::string loser =
+        (winner == game->get_player1()) ? game->get_player2() : game->get_player1();
+
+    send_response_to(winner.c_str(), "🎉 VICTORY:You won the game! 🎉");
+    send_response_to(loser.c_str(), "💀 DEFEAT:You lost the game 💀");
+
+    record_result(game, winner, loser);
+
+    std::string winner_stats = game->get_statistics(winner);
+    std::string loser_stats = game->get_statistics(loser);
+
+    send_response_to(winner.c_str(), ("FINAL_STATS:\n" + winner_stats).c_str());
+    send_response_to(loser.c_str(), ("FINAL_STATS:\n" + loser_stats).c_str());
+
+    remove_game(game_id);
+    match_finished(game_id, winner);
+}
+
+void Server::handle_play_bot(const Message& m) {
+    ClientSlot* client = find_client(m.from);
+    if (!client) {
+        send_response_to(m.from, "BOT_FAIL:Вы не зарегистрированы");
+        return;
+    }
+
+    // payload: стратегия бота (random, hunt, density, exact), по умолчанию density
+    BotStrategy strategy = BOT_DENSITY;
+    if (m.payload[0] != '\0' && !parse_bot_strategy(m.payload, strategy)) {
+        send_response_to(m.from, "BOT_FAIL:Неизвестная сложность (random, hunt, density, exact)");
+        return;
+    }
+
+    // Бот садится в уже созданную игру, если игрок ждёт в ней соперника
+    int game_id = client->current_game_id;
+    Game* game = get_game(game_id);
+    if (game && game->is_full()) {
+        send_response_to(m.from, "BOT_FAIL:В игре уже два игрока");
+        return;
+    }
+    if (game && game->rules() != RULES_CLASSIC) {
+        send_response_to(m.from, "BOT_FAIL:Бот играет только на классическом поле");
+        return;
+    }
+    if (!game) {
+        game_id = create_private_game(m.from, BOT_LOGIN);
+        game = get_game(game_id);
+        if (!game) {
+            send_response_to(m.from, "BOT_FAIL:Сервер переполнен");
+            return;
+        }
+        client->setup_complete = false;
+    }
+    matchmaker.remove(m.from);
+
+    if (!game->join(BOT_LOGIN) || !add_bot(game_id, BOT_LOGIN, strategy)) {
+        remove_game(game_id);
+        send_response_to(m.from, "BOT_FAIL:Не удалось создать игру с ботом");
+        return;
+    }
+
+    char buf[RESP_MAX];
+    std::snprintf(buf, RESP_MAX, "BOT_GAME:%d", game_id);
+    send_response_to(m.from, buf);
+    std::cout << "Bot game: " << m.from << " vs " << bot_strategy_name(strategy) << " bot (ID: "
+              << game_id << ")\n";
+    schedule_bot_turns(game_id);
+}
+
+void Server::handle_random_fleet(const Message& m) {
+    ClientSlot* client = find_client(m.from);
+    if (!client) {
+        send_response_to(m.from, "FLEET_FAIL:Вы не зарегистрированы");
+        return;
+    }
+
+    // Равномерно случайный флот по правилам партии; вне игры - классический
+    Game* game = get_game(client->current_game_id);
+    std::vector<FleetShip> ships;
+    fleets.generate(game ? game->rules() : RULES_CLASSIC, ships);
+    std::string layout = format_fleet(ships.data(), ships.size());
+
+    // Вне игры просто отдаём расстановку (нагрузочные тесты, внешние боты)
+    if (!game) {
+        send_response_to(m.from, ("FLEET:" + layout).c_str());
+        return;
+    }
+
+    if (!game->clear_ships(m.from)) {
+        send_response_to(m.from, "FLEET_FAIL:Расстановка уже завершена");
+        return;
+    }
+    for (const FleetShip& s : ships) {
+        if (!game->place_ship(m.from, s.size, s.x, s.y, s.horizontal)) {
+            game->clear_ships(m.from);
+            send_response_to(m.from, "FLEET_FAIL:Не удалось расставить корабли");
+            return;
+        }
+    }
+    send_response_to(m.from, ("FLEET_PLACED:" + layout).c_str());
+}
+
+void Server::handle_spectate(const Message& m) {
+    if (!find_client(m.from)) {
+        send_response_to(m.from, "SPECTATE_FAIL:Вы не зарегистрированы");
+        return;
+    }
+
+    char* end = nullptr;
+    long game_id = std::strtol(m.payload, &end, 10);
+    Game* game = (end != m.payload) ? get_game(static_cast<int>(game_id)) : nullptr;
+    if (!game || !game->is_full()) {
+        send_response_to(m.from, "SPECTATE_FAIL:Нет такой игры");
+        return;
+    }
+    if (game->is_player_in_game(m.from)) {
+        send_response_to(m.from, "SPECTATE_FAIL:Вы играете в этой игре");
+        return;
+    }
+
+    // Дальше сервер в наблюдении не участвует: клиент читает слот игры сам
+    char buf[RESP_MAX];
+    std::snprintf(buf, RESP_MAX, "SPECTATE:%ld", game_id);
+    send_response_to(m.from, buf);
+}
+
+void Server::handle_leaderboard(const Message& m) {
+    // Только верхушка из таблицы: запрос не обходит и не сортирует всех игроков
+    std::string res = "LEADERBOARD:";
+    char line[96];
+    size_t place = 0;
+    for (const PlayerRecord& p : players->leaderboard()) {
+        std::snprintf(line, sizeof(line), "\n%2zu. %-16s %5d  %u-%u  %u%%", ++place, p.login,
+                      p.rating, p.wins, p.losses, p.shots ? p.hits * 100 / p.shots : 0);
+        if (res.size() + std::strlen(line) >= RESP_MAX - 64)
+            break;
+        res += line;
+    }
+    if (place == 0)
+        res += "\nПока никто не доиграл ни одной партии";
+
+    PlayerRecord me;
+    if (players->find(m.from, me)) {
+        std::snprintf(line, sizeof(line), "\nВы: %d  %u-%u  %u%%", me.rating, me.wins, me.losses,
+                      me.shots ? me.hits * 100 / me.shots : 0);
+        res += line;
+    }
+    send_response_to(m.from, res.c_str());
+}
+
+void Server::handle_replay(const Message& m) {
+    if (!replays) {
+        send_response_to(m.from, "REPLAY_FAIL:Сервер не ведёт журналы партий");
+        return;
+    }
+    ClientSlot* client = find_client(m.from);
+    if (!client) {
+        send_response_to(m.from, "REPLAY_FAIL:Вы не зарегистрированы");
+        return;
+    }
+
+    std::istringstream ss(m.payload);
+    uint32_t number;
+    if (!(ss >> number)) {
+        std::string res = "REPLAYS:";
+        for (const FinishedGame& f : journals->recent(10)) {
+            std::string line = "\n#" + std::to_string(f.number) + " " + f.title;
+            if (res.size() + line.size() >= RESP_MAX)
+                break;
+            res += line;
+        }
+        if (res == "REPLAYS:")
+            res += "\nЗавершённых партий пока нет";
+        send_response_to(m.from, res.c_str());
+        return;
+    }
+
+    std::string speed_str = "1";
+    ss >> speed_str;
+    double speed = 0;
+    if (speed_str != "all") {
+        speed = std::atof(speed_str.c_str());
+        if (!(speed > 0)) {
+            send_response_to(m.from, "REPLAY_FAIL:Скорость - число больше 0 или all");
+            return;
+        }
+    }
+
+    FinishedGame f;
+    if (!journals->find_finished(number, f)) {
+        send_response_to(m.from, ("REPLAY_FAIL:Нет партии #" + std::to_string(number)).c_str());
+        return;
+    }
+    // Дальше журнал читает поток повторов, игровой цикл свободен
+    uint16_t stream = replays->start(client, m.from, f.path, speed);
+    send_response_to(m.from, ("REPLAY:" + std::to_string(stream) + ":" + f.title).c_str());
+}
+
+bool Server::add_bot(int game_id, const std::string& login, BotStrategy strategy) {
+    Game* game = get_game(game_id);
+    std::unique_ptr<Bot> bot(
+        new Bot(monotonic_ns() ^ std::hash<std::string>()(login) ^ game_id, strategy));
+    // Бот стреляет только по классическому полю
+    if (!game || game->rules() != RULES_CLASSIC || !bot->place_fleet(*game, login))
+        return false;
+    game->set_setup_complete(login);
+    bots[game_id].seats.emplace_back(login, std::move(bot));
+    return true;
+}
+
+void Server::schedule_bot_turns(int game_id) {
+    auto it = bots.find(game_id);
+    Game* game = get_game(game_id);
+    if (it == bots.end() || !game || it->second.scheduled || !game->is_game_active())
+        return;
+    for (const auto& seat : it->second.seats) {
+        if (game->is_player_turn(seat.first)) {
+            it->second.scheduled = true;
+            bot_moves.push_back(game_id);
+            return;
+        }
+    }
+}
+
+void Server::step_bots() {
+    apply_solved_shots();
+    // По одному выстрелу в каждой игре из очереди, пока не выйдет BOT_PASS_NS:
+    // сообщения игроков не ждут, пока доиграют все боты, а дешёвые ходы
+    // не ограничены числом. Хотя бы один выстрел за проход делается всегда
+    uint64_t deadline = monotonic_ns() + BOT_PASS_NS;
+    size_t games = bot_moves.size();
+    for (size_t done = 0; done < games; done++) {
+        if (done > 0 && monotonic_ns() >= deadline)
+            break;
+        int game_id = bot_moves.front();
+        bot_moves.pop_front();
+
+        auto it = bots.find(game_id);
+        Game* game = get_game(game_id);
+        if (it == bots.end() || !game)
+            continue;
+        it->second.scheduled = false;
+
+        size_t seat = 0;
+        auto& seats = it->second.seats;
+        while (seat < seats.size() && !game->is_player_turn(seats[seat].first))
+            seat++;
+        if (seat < seats.size() && seats[seat].second->wants_solver() &&
+            (!bot_solver || bot_solver->pending() < BOT_SOLVER_BACKLOG)) {
+            if (!bot_solver) {
+                SolverOptions opts;
+                opts.threads = 1;
+                SharedMemoryRoot* r = root;
+                bot_solver.reset(new SolverWorker(opts, [r] {
+                    lock_root(r);
+                    pthread_cond_signal(&r->server_cond);
+                    pthread_mutex_unlock(&r->mutex);
+                }));
+            }
+            CellState view[MAX_BOARD_SIZE][MAX_BOARD_SIZE];
+            game->get_opponent_cells(seats[seat].first, view);
+            bot_solver->submit(SolverWorker::Job{game_id, seat, read_board(view)});
+            it->second.scheduled = true;
+            continue;
+        }
+        bot_shoot(game, game_id, seat, nullptr);
+    }
+}
+
+void Server::apply_solved_shots() {
+    if (!bot_solver || !bot_solver->ready())
+        return;
+    solved_shots.clear();
+    bot_solver->collect(solved_shots);
+    for (const SolverWorker::Done& d : solved_shots) {
+        auto it = bots.find(d.job.game_id);
+        Game* game = get_game(d.job.game_id);
+        if (it == bots.end() || !game)
+            continue;
+        it->second.scheduled = false;
+        // Пока шёл перебор, партия могла закончиться сдачей; доска на ходу
+        // бота не меняется, но если всё же изменилась - стреляем по карте
+        const auto& seats = it->second.seats;
+        if (d.job.seat >= seats.size() || !game->is_game_active() ||
+            !game->is_player_turn(seats[d.job.seat].first)) {
+            schedule_bot_turns(d.job.game_id);
+            continue;
+        }
+        CellState view[MAX_BOARD_SIZE][MAX_BOARD_SIZE];
+        game->get_opponent_cells(seats[d.job.seat].first, view);
+        bool same = read_board(view).unknown.bits == d.job.board.unknown.bits;
+        bot_shoot(game, d.job.game_id, d.job.seat, d.ok && same ? &d.result : nullptr);
+    }
+}
+
+void Server::bot_shoot(Game* game, int game_id, size_t seat, const SolverResult* solved) {
+    auto& seats = bots[game_id].seats;
+    if (seat < seats.size()) {
+        CellState view[MAX_BOARD_SIZE][MAX_BOARD_SIZE];
+        uint8_t x, y;
+        game->get_opponent_cells(seats[seat].first, view);
+        if (seats[seat].second->choose_shot(view, solved, x, y))
+            game->make_shot(seats[seat].first, x, y);
+    }
+
+    if (game->is_game_finished()) {
+        finish_game(game, game_id);
+    } else {
+        schedule_bot_turns(game_id);
+        refresh_clock(game_id);
+    }
+}
+
+void Server::handle_tournament(const Message& m) {
+    if (!find_client(m.from)) {
+        send_response_to(m.from, "TOURNAMENT_FAIL:Вы не зарегистрированы");
+        return;
+    }
+
+    // payload: "<knockout|roundrobin> alice,bob,bot:exact,bot:density*8"
+    std::istringstream in(m.payload);
+    std::string format_name, list;
+    in >> format_name;
+    std::getline(in, list);
+
+    TournamentFormat format;
+    if (!parse_tournament_format(format_name, format)) {
+        send_response_to(m.from, "TOURNAMENT_FAIL:Формат: knockout или roundrobin");
+        return;
+    }
+
+    std::vector<std::string> entrants;
+    std::istringstream items(list);
+    std::string item;
+    while (std::getline(items, item, ',')) {
+        item.erase(0, item.find_first_not_of(' '));
+        item.erase(item.find_last_not_of(' ') + 1);
+        if (item.empty())
+            continue;
+
+        // bot[:стратегия][*количество]; логины вроде "botvinnik" - игроки
+        if (item == "bot" || item.compare(0, 4, "bot:") == 0 || item.compare(0, 4, "bot*") == 0) {
+            size_t count = 1;
+            size_t star = item.find('*');
+            if (star != std::string::npos) {
+                count = std::strtoul(item.c_str() + star + 1, nullptr, 10);
+                item.erase(star);
+            }
+            BotStrategy strategy = BOT_DENSITY;
+            if (item.size() > 4 && !parse_bot_strategy(item.substr(4), strategy)) {
+                send_response_to(m.from, "TOURNAMENT_FAIL:Неизвестная стратегия бота");
+                return;
+            }
+            for (size_t i = 0; i < count && entrants.size() < MAX_TOURNAMENT_ENTRANTS; i++) {
+                entrants.push_back(std::string(BOT_LOGIN) + bot_strategy_name(strategy) + "#" +
+                                   std::to_string(entrants.size()));
+            }
+        } else if (is_bot_login(item.c_str()) || !find_client(item.c_str())) {
+            send_response_to(m.from, ("TOURNAMENT_FAIL:Игрок не зарегистрирован: " + item).c_str());
+            return;
+        } else if (std::find(entrants.begin(), entrants.end(), item) != entrants.end()) {
+            send_response_to(m.from, ("TOURNAMENT_FAIL:Игрок указан дважды: " + item).c_str());
+            return;
+        } else {
+            entrants.push_back(item);
+        }
+    }
+
+    if (entrants.size() < 2 || entrants.size() > MAX_TOURNAMENT_ENTRANTS) {
+        char buf[RESP_MAX];
+        std::snprintf(buf, RESP_MAX, "TOURNAMENT_FAIL:Нужно от 2 до %zu участников",
+                      MAX_TOURNAMENT_ENTRANTS);
+        send_response_to(m.from, buf);
+        return;
+    }
+
+    int id = next_tournament_id++;
+    TournamentRun& run = tournaments[id];
+    run.bracket.reset(new Tournament(format, entrants));
+    run.organizer = m.from;
+
+    char buf[RESP_MAX];
+    std::snprintf(buf, RESP_MAX, "TOURNAMENT:%d:%s:%zu", id, tournament_format_name(format),
+                  entrants.size());
+    send_response_to(m.from, buf);
+    std::cout << "Tournament " << id << " (" << tournament_format_name(format) << ", "
+              << entrants.size() << " entrants) by " << m.from << "\n";
+
+    advance_tournament(id);
+}
+
+bool Server::player_available(const std::string& login) {
+    if (is_bot_login(login.c_str()))
+        return true;
+    ClientSlot* c = find_client(login.c_str());
+    return c && c->current_game_id == -1;
+}
+
+int Server::start_match(const std::string& a, const std::string& b) {
+    Game* game = new_game(a + "_vs_" + b, a, false);
+    if (!game)
+        return -1;
+    int game_id = game->get_id();
+
+    for (const std::string* p : {&a, &b}) {
+        ClientSlot* c = is_bot_login(p->c_str()) ? nullptr : find_client(p->c_str());
+        if (c) {
+            c->current_game_id = game_id;
+            c->setup_complete = false;
+            matchmaker.remove(*p);
+        }
+    }
+
+    game->join(b);
+    for (const std::string* p : {&a, &b}) {
+        if (is_bot_login(p->c_str()) && !add_bot(game_id, *p, strategy_of(*p))) {
+            remove_game(game_id);
+            return -1;
+        }
+    }
+
+    GameEvent assigned{};
+    assigned.type = EVT_MATCH_ASSIGNED;
+    assigned.game_id = game_id;
+    for (const std::string* p : {&a, &b}) {
+        ClientSlot* c = is_bot_login(p->c_str()) ? nullptr : find_client(p->c_str());
+        if (c) {
+            std::strncpy(assigned.who, (p == &a ? b : a).c_str(), LOGIN_MAX - 1);
+            push_event(c, assigned);
+        }
+    }
+
+    schedule_bot_turns(game_id);
+    refresh_clock(game_id);
+    return game_id;
+}
+
+void Server::launch_pending_matches() {
+    // Вложенные вызовы (неявка -> следующий раунд) только дописывают пары в
+    // очередь: их запускает внешний цикл
+    if (launching)
+        return;
+    launching = true;
+
+    bool progress = true;
+    while (progress && !pending_matches.empty()) {
+        progress = false;
+
+        std::deque<std::pair<int, size_t>> waiting;
+        std::vector<std::pair<std::pair<int, size_t>, std::string>> forfeits;
+        size_t started = 0;
+        while (!pending_matches.empty()) {
+            std::pair<int, size_t> pm = pending_matches.front();
+            pending_matches.pop_front();
+
+            auto it = tournaments.find(pm.first);
+            if (it == tournaments.end())
+                continue;
+            TournamentMatch match = it->second.bracket->matches()[pm.second];
+            if (match.done)
+                continue;
+
+            bool a_ok = player_available(match.a);
+            bool b_ok = player_available(match.b);
+            if (!a_ok || !b_ok) {
+                // Неявка: занятый или ушедший игрок проигрывает
+                forfeits.emplace_back(pm, a_ok ? match.a : (b_ok ? match.b : ""));
+                continue;
+            }
+            if (free_games.empty()) {
+                waiting.push_back(pm);
+                continue;
+            }
+
+            int game_id = start_match(match.a, match.b);
+            if (game_id < 0) {
+                forfeits.emplace_back(pm, match.a);
+                continue;
+            }
+            tournament_games[game_id] = pm;
+            started++;
+        }
+        pending_matches = std::move(waiting);
+
+        for (const auto& f : forfeits)
+            record_match(f.first.first, f.first.second, f.second);
+        progress = started > 0 || !forfeits.empty();
+    }
+
+    launching = false;
+}
+
+void Server::advance_tournament(int tournament_id) {
+    auto it = tournaments.find(tournament_id);
+    if (it == tournaments.end())
+        return;
+    Tournament& t = *it->second.bracket;
+
+    // Раунд из одних свободных кругов завершается сразу
+    while (t.round_complete()) {
+        if (!t.next_round()) {
+            std::string standings = t.standings();
+            std::cout << "Tournament " << tournament_id << " finished:\n" << standings;
+
+            char head[64];
+            std::snprintf(head, sizeof(head), "TOURNAMENT_OVER:%d\n", tournament_id);
+            send_response_to(it->second.organizer.c_str(), (head + standings).c_str());
+            tournaments.erase(it);
+            return;
+        }
+
+        std::cout << "Tournament " << tournament_id << " round " << t.round() << ": "
+                  << t.matches().size() << " matches\n";
+        for (size_t i = 0; i < t.matches().size(); i++) {
+            if (!t.matches()[i].done)
+                pending_matches.emplace_back(tournament_id, i);
+        }
+        if (!t.round_complete())
+            break;
+    }
+    launch_pending_matches();
+}
+
+void Server::record_match(int tournament_id, size_t match, const std::string& winner) {
+    auto it = tournaments.find(tournament_id);
+    if (it == tournaments.end())
+        return;
+    it->second.bracket->record(match, winner);
+    advance_tournament(tournament_id);
+}
+
+void Server::match_finished(int game_id, const std::string& winner) {
+    auto it = tournament_games.find(game_id);
+    if (it == tournament_games.end()) {
+        // Освободился слот: ждущие пары могут начать
+        launch_pending_matches();
+        return;
+    }
+    std::pair<int, size_t> pm = it->second;
+    tournament_games.erase(it);
+    record_match(pm.first, pm.second, winner);
+    launch_pending_matches();
+}
+
 void Server::handle_message(const Message& m) {
     std::string from(m.from);
 
     switch (m.type) {
     case MSG_REGISTER: {
+        if (is_bot_login(m.from))
+            break;
+        // Один логин не может быть в сети сразу на двух сегментах
+        if (remote_shard_of(m.from) != -1) {
+            send_response_to(m.from, "REGISTERED:FAIL_ELSEWHERE");
+            break;
+        }
         ClientSlot* c = find_or_create_client(m.from);
+        if (c && directory && !directory->assign(m.from, shard)) {
+            drop_client(c);
+            c = nullptr;
+        }
         if (c) {
+            c->pid = static_cast<pid_t>(std::atoi(m.payload));
+            if (c->pid > 0 && !reaper.watch(c - root->clients, c->pid)) {
+                drop_client(c);
+                break;
+            }
             send_response_to(m.from, "REGISTERED:OK");
             std::cout << "Registered client: " << m.from << '\n';
         } else {
@@ -491,7 +1393,10 @@ void Server::handle_message(const Message& m) {
         ClientSlot* sender = find_client(m.from);
 
         if (!tgt) {
-            send_response_to(m.from, "INVITE_FAIL:Игрок не найден");
+            // Клиент сам переходит в сегмент соперника по каталогу до приглашения
+            send_response_to(m.from, remote_shard_of(target) != -1
+                                         ? "INVITE_FAIL:Игрок на другом сегменте сервера"
+                                         : "INVITE_FAIL:Игрок не найден");
         } else if (tgt->current_game_id != -1) {
             send_response_to(m.from, "INVITE_FAIL:Игрок уже в игре");
         } else if (sender->current_game_id != -1) {
@@ -539,7 +1444,10 @@ void Server::handle_message(const Message& m) {
 
         if (!tgt) {
             std::cout << "❌ Target '" << target << "' not found!" << std::endl;
-            send_response_to(m.from, "INVITE_FAIL:Игрок не найден");
+            // Игра уже живёт в этом сегменте, а игрок в другом: перенести её нельзя
+            send_response_to(m.from, remote_shard_of(target) != -1
+                                         ? "INVITE_FAIL:Игрок на другом сегменте сервера"
+                                         : "INVITE_FAIL:Игрок не найден");
             break;
         }
 
@@ -570,7 +1478,12 @@ void Server::handle_message(const Message& m) {
     }
 
     case MSG_CREATE: {
+        // payload: "имя" или "имя правила"
         std::string game_name = m.payload;
+        RulesId rules = RULES_CLASSIC;
+        size_t space = game_name.rfind(' ');
+        if (space != std::string::npos && parse_rules(game_name.substr(space + 1), rules))
+            game_name.erase(space);
 
         if (game_name.empty()) {
             send_response_to(m.from, "CREATE_FAIL:Имя игры не может быть пустым");
@@ -599,7 +1512,7 @@ void Server::handle_message(const Message& m) {
             }
         }
 
-        for (int i = 0; i < 16; i++) {
+        for (size_t i = 0; i < MAX_GAMES; i++) {
             if (root->games[i].used &&
                 std::strcmp(root->games[i].game_name, game_name.c_str()) == 0) {
                 send_response_to(m.from, "CREATE_FAIL:Игра с таким именем уже существует");
@@ -607,7 +1520,7 @@ void Server::handle_message(const Message& m) {
             }
         }
 
-        int game_id = create_public_game(game_name, m.from);
+        int game_id = create_public_game(game_name, m.from, rules);
         if (game_id == -1) {
             send_response_to(m.from, "CREATE_FAIL:Сервер переполнен");
         } else if (game_id == -2) {
@@ -643,13 +1556,9 @@ void Server::handle_message(const Message& m) {
         }
 
         if (!game) {
-            for (auto& pair : games_map) {
-                if (pair.second->get_game_name() == target) {
-                    game = pair.second;
-                    game_id = pair.first;
-                    break;
-                }
-            }
+            game = find_game_by_name(target);
+            if (game)
+                game_id = game->get_id();
         }
 
         if (!game) {
@@ -669,6 +1578,7 @@ void Server::handle_message(const Message& m) {
 
         if (game->join(m.from)) {
             client->current_game_id = game_id;
+            matchmaker.remove(m.from);
 
             std::string creator = game->get_player1();
             if (creator.empty())
@@ -682,7 +1592,9 @@ void Server::handle_message(const Message& m) {
 
             std::string instructions = "SHIP_PLACEMENT:\n"
                                        "Разместите корабли: place размер,x,y,ориентация(H/V)\n"
-                                       "Корабли: 1x4, 2x3, 3x2, 4x1\n"
+                                       "Корабли: " +
+                                       fleet_summary(rules_info(game->rules())) +
+                                       "\n"
                                        "Пример: place 4,0,0,H\n"
                                        "Когда готовы: ready";
 
@@ -704,6 +1616,7 @@ void Server::handle_message(const Message& m) {
                 if (client) {
                     client->current_game_id = game_id;
                 }
+                matchmaker.remove(m.from);
 
                 send_response_to(m.from, "ACCEPT_OK:Вы присоединились");
                 send_response_to(game->get_player1().c_str(),
@@ -755,12 +1668,12 @@ void Server::handle_message(const Message& m) {
             break;
         }
 
-        if (s < 1 || s > 4) {
-            send_response_to(m.from, "SHIP_ERROR:Size must be 1-4");
+        if (s < 1 || s > MAX_SHIP_SIZE) {
+            send_response_to(m.from, "SHIP_ERROR:Size must be 1-5");
             break;
         }
 
-        if (x_pos < 0 || x_pos >= BOARD_SIZE || y_pos < 0 || y_pos >= BOARD_SIZE) {
+        if (x_pos < 0 || x_pos >= MAX_BOARD_SIZE || y_pos < 0 || y_pos >= MAX_BOARD_SIZE) {
             send_response_to(m.from, "SHIP_ERROR:Coordinates out of bounds");
             break;
         }
@@ -820,8 +1733,6 @@ void Server::handle_message(const Message& m) {
 
         bool hit = game->make_shot(m.from, x, y);
         std::string shooter = m.from;
-        std::string opponent =
-            (game->get_player1() == shooter) ? game->get_player2() : game->get_player1();
 
         char buf[RESP_MAX];
         if (hit) {
@@ -831,35 +1742,18 @@ void Server::handle_message(const Message& m) {
         }
         send_response_to(m.from, buf);
 
-        std::snprintf(buf, RESP_MAX, "OPPONENT_SHOT:%s at %d,%d:%s", shooter.c_str(), x, y,
-                      hit ? "HIT" : "MISS");
-        send_response_to(opponent.c_str(), buf);
-
         std::string opponent_view = game->get_opponent_view(shooter);
         send_response_to(m.from, ("OPPONENT_VIEW_UPDATE:\n" + opponent_view).c_str());
 
         if (game->is_game_finished()) {
-            std::string winner = game->get_winner();
-            std::string loser =
-                (winner == game->get_player1()) ? game->get_player2() : game->get_player1();
-
-            send_response_to(winner.c_str(), "🎉 VICTORY:You won the game! 🎉");
-            send_response_to(loser.c_str(), "💀 DEFEAT:You lost the game 💀");
-
-            std::string winner_stats = game->get_statistics(winner);
-            std::string loser_stats = game->get_statistics(loser);
-
-            send_response_to(winner.c_str(), ("FINAL_STATS:\n" + winner_stats).c_str());
-            send_response_to(loser.c_str(), ("FINAL_STATS:\n" + loser_stats).c_str());
-
-            remove_game(client->current_game_id);
+            finish_game(game, client->current_game_id);
         } else {
+            // Противник узнаёт о выстреле и смене хода из событий (EVT_INCOMING_SHOT, EVT_YOUR_TURN)
             std::string current_turn = game->get_current_turn();
             if (current_turn == shooter && hit) {
                 send_response_to(shooter.c_str(), "YOUR_TURN_AGAIN:You hit! Shoot again");
-            } else if (current_turn == opponent) {
-                send_response_to(opponent.c_str(), "YOUR_TURN:Make your move");
             }
+            schedule_bot_turns(client->current_game_id);
         }
         break;
     }
@@ -915,12 +1809,16 @@ void Server::handle_message(const Message& m) {
                     }
                 }
 
+                int game_id = client->current_game_id;
                 client->current_game_id = -1;
                 client->setup_complete = false;
                 send_response_to(m.from, "LEFT_GAME:Вы вышли из игры");
 
-                if (!game->get_player1()[0] && !game->get_player2()[0]) {
-                    remove_game(client->current_game_id);
+                if (tournament_games.count(game_id)) {
+                    remove_game(game_id);
+                    match_finished(game_id, other_player);
+                } else if (game->is_empty() || is_bot_login(other_player.c_str())) {
+                    remove_game(game_id);
                 } else {
                     if (!other_player.empty()) {
                         ClientSlot* other_client = find_client(other_player.c_str());
@@ -937,25 +1835,71 @@ void Server::handle_message(const Message& m) {
     }
     case MSG_QUIT: {
         ClientSlot* c = find_client(m.from);
+        int forfeit_game = -1;
+        std::string forfeit_winner;
         if (c) {
             if (c->current_game_id != -1) {
                 Game* game = get_game(c->current_game_id);
                 if (game && !game->is_game_finished()) {
                     std::string opponent =
                         (game->get_player1() == m.from) ? game->get_player2() : game->get_player1();
+                    if (game->is_game_active()) {
+                        record_result(game, opponent, m.from);
+                    }
                     send_response_to(opponent.c_str(), "OPPONENT_DISCONNECTED:You win by forfeit");
-                    remove_game(c->current_game_id);
+                    forfeit_game = c->current_game_id;
+                    forfeit_winner = opponent;
+                    remove_game(forfeit_game);
                 }
             }
 
-            c->used = false;
-            c->has_response = false;
-            c->current_game_id = -1;
-            c->setup_complete = false;
-            std::memset(c->login, 0, LOGIN_MAX);
-            std::memset(c->response, 0, RESP_MAX);
+            matchmaker.remove(m.from);
+            if (replays)
+                replays->cancel(m.from);
+            reaper.unwatch(c - root->clients);
+            if (directory)
+                directory->release(m.from, shard);
+            release_client(c);
             std::cout << "Client quit: " << m.from << '\n';
         }
+        if (forfeit_game != -1)
+            match_finished(forfeit_game, forfeit_winner);
+        break;
+    }
+    case MSG_CLIENT_GONE: {
+        handle_client_gone(m);
+        break;
+    }
+    case MSG_QUICK_MATCH: {
+        handle_quick_match(m);
+        break;
+    }
+    case MSG_PLAY_BOT: {
+        handle_play_bot(m);
+        break;
+    }
+    case MSG_RANDOM_FLEET: {
+        handle_random_fleet(m);
+        break;
+    }
+    case MSG_SPECTATE: {
+        handle_spectate(m);
+        break;
+    }
+    case MSG_TOURNAMENT: {
+        handle_tournament(m);
+        break;
+    }
+    case MSG_LEADERBOARD: {
+        handle_leaderboard(m);
+        break;
+    }
+    case MSG_REPLAY: {
+        handle_replay(m);
+        break;
+    }
+    case MSG_METRICS: {
+        handle_metrics(m);
         break;
     }
     default:
@@ -963,21 +1907,397 @@ void Server::handle_message(const Message& m) {
     }
 }
 
+void Server::enable_trace(const std::string& path) {
+    trace.reset(new TraceWriter(path));
+    std::cout << "Server: tracing messages to " << path << "\n";
+}
+
+void Server::enable_journal(const std::string& dir) {
+    // Сегменты пишут в один каталог, а номера игр у них совпадают
+    journals.reset(new JournalStore(dir, directory ? "s" + std::to_string(shard) + "-" : ""));
+    replays.reset(new ReplayStreamer());
+    std::cout << "Server: journaling games to " << dir << "\n";
+}
+
+void Server::enable_players(const std::string& path) {
+    players.reset(new PlayerStore(path));
+    std::cout << "Server: player accounts in " << path << " (" << players->size()
+              << " players)\n";
+}
+
+void Server::open_journal(Game* game) {
+    if (!journals)
+        return;
+    try {
+        game->attach_journal(journals->open(game->get_id(), game->get_game_name()));
+    } catch (const std::exception& ex) {
+        // Без журнала партия всё равно идёт
+        std::cerr << "Server: " << ex.what() << std::endl;
+    }
+}
+
+void Server::set_clocks(const ClockOptions& opts) {
+    clock_opts = opts;
+    std::cout << "Server: clocks turn " << opts.turn_timeout << " s, setup " << opts.setup_timeout
+              << " s, idle " << opts.idle_timeout << " s (0 - off), on timeout "
+              << (opts.forfeit ? "forfeit" : "play for the player") << "\n";
+    // Уже идущие партии переходят на новые сроки
+    for (Game* game : game_slots) {
+        if (!game)
+            continue;
+        game_clocks[game_slot(game->get_id())].state = 0xFF;
+        refresh_clock(game->get_id());
+    }
+}
+
+void Server::refresh_clock(int game_id) {
+    if (game_id < 0)
+        return;
+    GameClock& c = game_clocks[game_slot(game_id)];
+    if (!get_game(game_id)) {
+        // Слот уже мог достаться новой игре: её срок не трогаем
+        if (c.node.owner == game_id) {
+            clocks.cancel(&c.node);
+            c.state = 0xFF;
+        }
+        return;
+    }
+    if (c.node.owner != game_id) {
+        // Новая игра в слоте начинает с чистого счёта
+        clocks.cancel(&c.node);
+        c = GameClock();
+        c.node.owner = game_id;
+    }
+
+    const GameData& g = root->games[game_slot(game_id)];
+    uint8_t seated = (g.player1[0] ? 1 : 0) | (g.player2[0] ? 2 : 0);
+    if (g.state == c.state && g.shot_count == c.shots && seated == c.seated)
+        return;
+    // Игрок выстрелил сам: счёт пропущенных ходов начинается заново
+    if (!clock_firing && g.shot_count > c.shots && g.shot_count > 0) {
+        uint8_t shooter = g.shots[g.shot_count - 1].shooter;
+        if (shooter == 1 || shooter == 2)
+            c.missed[shooter - 1] = 0;
+    }
+    if (g.state != c.state && g.state != GAME_ACTIVE)
+        c.missed[0] = c.missed[1] = 0;
+    c.state = g.state;
+    c.shots = g.shot_count;
+    c.seated = seated;
+
+    int timeout = 0;
+    if (g.state == GAME_WAITING)
+        timeout = clock_opts.idle_timeout;
+    else if (g.state == GAME_SETUP)
+        timeout = clock_opts.setup_timeout;
+    else if (g.state == GAME_ACTIVE)
+        timeout = clock_opts.turn_timeout;
+
+    if (timeout > 0)
+        clocks.schedule(&c.node, monotonic_ns() + static_cast<uint64_t>(timeout) * NS_PER_SEC);
+    else
+        clocks.cancel(&c.node);
+}
+
+void Server::expire_clocks() {
+    std::vector<TimerNode*> fired;
+    clocks.advance(monotonic_ns(), fired);
+    for (TimerNode* n : fired) {
+        // Обработка прежнего срока могла уже завести этот заново
+        if (!n->armed())
+            clock_expired(n->owner);
+    }
+}
+
+RequestLane Server::next_lane() {
+    const SharedMemoryRoot::RequestQueue& game = root->lanes[LANE_GAME];
+    const SharedMemoryRoot::RequestQueue& lobby = root->lanes[LANE_LOBBY];
+    bool lobby_waiting = lobby.ready > 0;
+    if (game.ready > 0) {
+        if (!lobby_waiting || game_streak < GAME_STREAK_LIMIT) {
+            game_streak = lobby_waiting ? game_streak + 1 : 0;
+            return LANE_GAME;
+        }
+        // Поток выстрелов не должен держать лобби вечно
+        lobby_forced++;
+    }
+    game_streak = 0;
+    return LANE_LOBBY;
+}
+
+size_t Server::next_queue_entry(RequestLane lane) {
+    // Каждый отправитель - своя очередь внутри общей; из очередей по кругу
+    // берётся самая старая запись, поэтому поток команд одного клиента не
+    // задерживает остальных, а порядок команд самого клиента сохраняется
+    const SharedMemoryRoot::RequestQueue& q = root->lanes[lane];
+    const size_t senders = MAX_CLIENTS + 1;
+    size_t& last = last_sender[lane];
+    size_t best = q.head;
+    size_t best_sender = last;
+    size_t best_dist = senders;
+    for (size_t i = q.head; i != q.tail; i = (i + 1) % QUEUE_SIZE) {
+        const Message& m = q.entries[i];
+        // Резервированная, но ещё не заполненная запись пропускается
+        if (m.state != MSG_READY)
+            continue;
+        size_t sender = m.sender >= 0 ? static_cast<size_t>(m.sender) : MAX_CLIENTS;
+        size_t dist = (sender + senders - last - 1) % senders;
+        if (dist < best_dist) {
+            best = i;
+            best_sender = sender;
+            best_dist = dist;
+            if (dist == 0)
+                break;
+        }
+    }
+    last = best_sender;
+    return best;
+}
+
+void Server::record_latency(RequestLane lane, uint64_t wait_ns, uint64_t total_ns) {
+    LaneMetrics& lm = lane_metrics[lane];
+    lm.count++;
+    lm.wait_ns += wait_ns;
+    lm.max_ns = std::max(lm.max_ns, total_ns);
+    if (lm.recent.size() < LATENCY_SAMPLES) {
+        lm.recent.push_back(total_ns);
+    } else {
+        lm.recent[lm.next] = total_ns;
+        lm.next = (lm.next + 1) % LATENCY_SAMPLES;
+    }
+}
+
+void Server::handle_metrics(const Message& m) {
+    static const char* const names[LANE_COUNT] = {"игровая", "лобби"};
+    std::string res = "METRICS:";
+    char line[160];
+    for (size_t lane = 0; lane < LANE_COUNT; lane++) {
+        const LaneMetrics& lm = lane_metrics[lane];
+        std::vector<uint64_t> sorted(lm.recent);
+        std::sort(sorted.begin(), sorted.end());
+        auto pct_us = [&](double p) -> uint64_t {
+            if (sorted.empty())
+                return 0;
+            return sorted[std::min(sorted.size() - 1, size_t(p * sorted.size()))] / 1000;
+        };
+        std::snprintf(line, sizeof(line),
+                      "\n%s: %llu запр., ожидание ср. %llu мкс, ответ p50 %llu p99 %llu max "
+                      "%llu мкс",
+                      names[lane], static_cast<unsigned long long>(lm.count),
+                      static_cast<unsigned long long>(lm.count ? lm.wait_ns / lm.count / 1000 : 0),
+                      static_cast<unsigned long long>(pct_us(0.50)),
+                      static_cast<unsigned long long>(pct_us(0.99)),
+                      static_cast<unsigned long long>(lm.max_ns / 1000));
+        res += line;
+    }
+    std::snprintf(line, sizeof(line), "\nлобби без очереди: %llu раз",
+                  static_cast<unsigned long long>(lobby_forced));
+    res += line;
+    send_response_to(m.from, res.c_str());
+}
+
+void Server::dispatch_for(const std::string& login, MsgType type, const std::string& payload) {
+    Message m;
+    std::memset(&m, 0, sizeof(m));
+    m.state = MSG_READY;
+    std::strncpy(m.from, login.c_str(), LOGIN_MAX - 1);
+    m.type = type;
+    std::strncpy(m.payload, payload.c_str(), CMD_MAX - 1);
+    // В трассе команда выглядит как пришедшая от игрока: повтор трассы совпадёт
+    if (trace)
+        trace->record(m);
+    handle_message(m);
+}
+
+void Server::clock_expired(int game_id) {
+    Game* game = get_game(game_id);
+    if (!game)
+        return;
+    GameClock& c = game_clocks[game_slot(game_id)];
+    const GameData& g = root->games[game_slot(game_id)];
+    // Срок заводится заново, даже если состояние не сменилось
+    c.state = 0xFF;
+    clock_firing = true;
+
+    if (g.state == GAME_WAITING) {
+        std::cout << "Clock: game " << game_id << " had no opponent for "
+                  << clock_opts.idle_timeout << " s, removed\n";
+        remove_game(game_id);
+    } else if (g.state == GAME_SETUP) {
+        std::cout << "Clock: game " << game_id << " setup time is over\n";
+        std::string unready[2];
+        if (!g.ready1 && !is_bot_login(g.player1))
+            unready[0] = g.player1;
+        if (!g.ready2 && !is_bot_login(g.player2))
+            unready[1] = g.player2;
+        for (const std::string& p : unready) {
+            if (p.empty() || !get_game(game_id))
+                continue;
+            if (clock_opts.forfeit) {
+                // Ответ идёт последним: в слоте ответа он не затрётся ответом на выход
+                dispatch_for(p, MSG_LEAVE_GAME, "");
+                send_response_to(p.c_str(), "TIMEOUT:Время на расстановку вышло");
+            } else {
+                send_response_to(p.c_str(),
+                                 "TIMEOUT:Время на расстановку вышло, флот расставлен случайно");
+                dispatch_for(p, MSG_RANDOM_FLEET, "");
+                dispatch_for(p, MSG_SETUP_COMPLETE, "");
+            }
+        }
+    } else if (g.state == GAME_ACTIVE) {
+        std::string player = g.current_turn;
+        uint8_t seat = player == g.player1 ? 0 : 1;
+        if (!is_bot_login(player.c_str())) {
+            std::cout << "Clock: game " << game_id << ", " << player << " missed a turn\n";
+            CellState view[MAX_BOARD_SIZE][MAX_BOARD_SIZE];
+            uint8_t x, y;
+            game->get_opponent_cells(player, view);
+            // На неклассическом поле бот стреляет просто в случайную клетку
+            bool shot = game->rules() == RULES_CLASSIC
+                            ? stand_in.choose_shot(view, x, y)
+                            : stand_in.choose_open_cell(view, game->width(), game->height(), x, y);
+            if (clock_opts.forfeit || ++c.missed[seat] >= MAX_MISSED_TURNS || !shot) {
+                dispatch_for(player, MSG_SURRENDER, "");
+                send_response_to(player.c_str(), "TIMEOUT:Время хода вышло, засчитано поражение");
+            } else {
+                send_response_to(player.c_str(),
+                                 "TIMEOUT:Время хода вышло, сервер выстрелил за вас");
+                dispatch_for(player, MSG_SHOT, std::to_string(x) + "," + std::to_string(y));
+            }
+        }
+    }
+
+    refresh_clock(game_id);
+    clock_firing = false;
+}
+
+void Server::replay(const std::string& path, bool paced) {
+    std::vector<TraceEntry> entries;
+    {
+        TraceReader reader(path);
+        TraceEntry e;
+        while (reader.next(e)) {
+            entries.push_back(e);
+        }
+    }
+
+    std::vector<uint64_t> latencies;
+    latencies.reserve(entries.size());
+
+    auto start = std::chrono::steady_clock::now();
+    for (const auto& e : entries) {
+        if (paced) {
+            std::this_thread::sleep_until(start + std::chrono::nanoseconds(e.t_ns));
+        }
+        uint64_t t0 = monotonic_ns();
+        handle_message(e.msg);
+        latencies.push_back(monotonic_ns() - t0);
+        while (!bot_moves.empty() || (bot_solver && bot_solver->pending())) {
+            if (bot_moves.empty())
+                bot_solver->wait();
+            step_bots();
+        }
+    }
+    double elapsed =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::sort(latencies.begin(), latencies.end());
+    auto pct = [&](double p) -> uint64_t {
+        if (latencies.empty())
+            return 0;
+        return latencies[std::min(latencies.size() - 1, size_t(p * latencies.size()))];
+    };
+    uint64_t total = 0;
+    for (uint64_t l : latencies)
+        total += l;
+
+    std::cerr << "=== REPLAY " << path << (paced ? " (paced)" : " (max speed)") << " ===\n"
+              << "messages:   " << entries.size() << "\n"
+              << "elapsed:    " << elapsed << " s\n"
+              << "throughput: " << (elapsed > 0 ? entries.size() / elapsed : 0) << " msg/s\n"
+              << "latency ns: avg "
+              << (latencies.empty() ? 0 : total / latencies.size()) << ", p50 " << pct(0.50)
+              << ", p99 " << pct(0.99) << ", max " << pct(1.0) << "\n";
+}
+
 void Server::run() {
+    reaper.start();
+    for (size_t i = 0; i < MAX_CLIENTS; ++i) {
+        ClientSlot* c = &root->clients[i];
+        if (c->used && c->pid > 0 && !reaper.watch(i, c->pid)) {
+            drop_client(c);
+        }
+    }
+
+    // Партиям, подхваченным при тёплом перезапуске, сроки идут заново
+    for (Game* game : game_slots) {
+        if (game)
+            refresh_clock(game->get_id());
+    }
+
     std::cout << "=== SERVER RUNNING ===\n";
+    // Запись очереди ещё разбирается: место освобождается при следующем
+    // захвате мьютекса, отдельной блокировки на это не тратится
+    RequestLane held_lane = LANE_GAME;
+    size_t held = QUEUE_SIZE;
     while (true) {
-        pthread_mutex_lock(&root->mutex);
-        while (root->q_head == root->q_tail) {
-            pthread_cond_wait(&root->server_cond, &root->mutex);
+        lock_root(root);
+        if (held != QUEUE_SIZE) {
+            release_entry_root(root, held_lane, held);
+            held = QUEUE_SIZE;
+        }
+        while (!requests_pending_root(root) && bot_moves.empty() &&
+               !(bot_solver && bot_solver->ready())) {
+            if (trace && trace->pending()) {
+                // Сбрасываем трассу, пока очередь пуста, чтобы не тормозить обработку
+                pthread_mutex_unlock(&root->mutex);
+                trace->flush();
+                lock_root(root);
+                if (requests_pending_root(root))
+                    break;
+            }
+            uint64_t wakeup = clocks.next_wakeup_ns();
+            if (wakeup == TimerWheel::NEVER) {
+                wait_root(root, &root->server_cond);
+                continue;
+            }
+            uint64_t now = monotonic_ns();
+            if (wakeup <= now || !wait_root_for(root, &root->server_cond, wakeup - now))
+                break;
+        }
+        if (!requests_pending_root(root)) {
+            // Сообщений нет: истёкшие сроки и ходы ботов
+            pthread_mutex_unlock(&root->mutex);
+            expire_clocks();
+            step_bots();
+            continue;
         }
 
-        Message m = root->queue[root->q_head];
-        root->queue[root->q_head].used = false;
-        root->q_head = (root->q_head + 1) % QUEUE_SIZE;
+        // Сообщение разбирается прямо в сегменте: пока запись не освобождена,
+        // клиенты её не займут
+        held_lane = next_lane();
+        held = next_queue_entry(held_lane);
+        const Message& m = root->lanes[held_lane].entries[held];
         pthread_mutex_unlock(&root->mutex);
 
-        if (m.used) {
+        if (m.state == MSG_READY) {
+            uint64_t start = monotonic_ns();
+            if (trace)
+                trace->record(m);
+            // Сроки пересматриваются для партии игрока до и после команды
+            ClientSlot* sender = find_client(m.from);
+            int before = sender ? sender->current_game_id : -1;
             handle_message(m);
+            sender = find_client(m.from);
+            refresh_clock(before);
+            if (sender && sender->current_game_id != before)
+                refresh_clock(sender->current_game_id);
+            uint64_t posted = std::min(m.t_ns, start);
+            record_latency(held_lane, start - posted, monotonic_ns() - posted);
         }
+        expire_clocks();
+        // Под потоком сообщений боты тоже не должны стоять
+        if (!bot_moves.empty() || (bot_solver && bot_solver->ready()))
+            step_bots();
     }
 }
\ No newline at end of file
@@ -1,38 +1,186 @@
 #pragma once
 #include "../include/SharedTypes.hpp"
 #include "../include/SharedMemory.hpp"
+#include "../include/ShardDirectory.hpp"
+#include "Bot.hpp"
+#include "ClientReaper.hpp"
+#include "FleetGenerator.hpp"
 #include "Game.hpp"
+#include "Journal.hpp"
+#include "Matchmaker.hpp"
+#include "PlayerStore.hpp"
+#include "ReplayStreamer.hpp"
+#include "SolverWorker.hpp"
+#include "TimerWheel.hpp"
+#include "Tournament.hpp"
+#include "Trace.hpp"
+#include <deque>
+#include <memory>
 #include <string>
 #include <vector>
 #include <unordered_map>
 
+// Часы партий, в секундах; 0 - без ограничения
+struct ClockOptions {
+    // На ход; по истечении сервер стреляет за игрока наугад
+    int turn_timeout = 120;
+    // На расстановку после прихода соперника; флот расставляется случайно
+    int setup_timeout = 300;
+    // Открытая игра без соперника удаляется
+    int idle_timeout = 900;
+    // Вместо выстрела и расстановки за игрока - поражение
+    bool forfeit = false;
+};
+
 class Server {
 public:
-    Server();
+    explicit Server(const ShmOptions& opts = ShmOptions());
     ~Server();
     void run();
 
+    void enable_trace(const std::string& path);
+    // Журнал каждой новой партии в каталоге dir
+    void enable_journal(const std::string& dir);
+    // Учётные записи игроков в файле path (общем для всех сегментов)
+    void enable_players(const std::string& path);
+    void set_clocks(const ClockOptions& opts);
+    void replay(const std::string& path, bool paced);
+
 private:
     SharedMemory shm;
     SharedMemoryRoot* root;
+    // Номер своего сегмента; каталог есть, только если сегментов несколько
+    int shard;
+    std::unique_ptr<ShardDirectory> directory;
     bool setup_done;
+    ClientReaper reaper;
     
-    std::unordered_map<int, Game*> games_map;
+    // Игры по слотам root->games. Снаружи игра известна по дескриптору,
+    // get_game сверяет его поколение с игрой в слоте
+    Game* game_slots[MAX_GAMES];
+    // Свободные слоты игр и клиентов: стеки, выделение и возврат - O(1)
+    std::vector<int> free_games;
+    std::vector<size_t> free_clients;
+    std::unordered_map<std::string, ClientSlot*> clients_by_login;
+    // Боты одной игры: логин за столом -> бот; в партии бот против бота их два
+    struct BotTable {
+        std::vector<std::pair<std::string, std::unique_ptr<Bot>>> seats;
+        // Игра уже стоит в bot_moves
+        bool scheduled = false;
+    };
+    // Игры со встроенными ботами: id игры -> боты
+    std::unordered_map<int, BotTable> bots;
+    // Игры, где ход за ботом. Сервер делает по одному выстрелу в каждой по
+    // кругу между сообщениями, поэтому сотни партий ботов идут одновременно
+    std::deque<int> bot_moves;
+    // Перебор для ботов BOT_EXACT; поток заводится с первым таким ходом.
+    // Игра, чей ход считается, остаётся scheduled, но не стоит в bot_moves
+    std::unique_ptr<SolverWorker> bot_solver;
+    std::vector<SolverWorker::Done> solved_shots;
+    FleetGenerator fleets;
+    // По очередям запросов: отправитель, чья запись разобрана последней
+    // (MAX_CLIENTS - без слота)
+    size_t last_sender[LANE_COUNT];
+    // Игровых записей подряд, пока в лобби кто-то ждёт
+    uint32_t game_streak;
+    // От публикации записи до конца её разбора, по очередям
+    struct LaneMetrics {
+        uint64_t count = 0;
+        uint64_t wait_ns = 0;
+        uint64_t max_ns = 0;
+        // Последние полные времена для перцентилей (кольцо)
+        std::vector<uint64_t> recent;
+        size_t next = 0;
+    };
+    LaneMetrics lane_metrics[LANE_COUNT];
+    // Сколько раз лобби прошло вперёд непустой игровой очереди
+    uint64_t lobby_forced;
+    std::unique_ptr<TraceWriter> trace;
+    // Партии, подхваченные при тёплом перезапуске, идут без журнала
+    std::unique_ptr<JournalStore> journals;
+    // Повторы читают журналы в своём потоке; есть, только если журналы ведутся
+    std::unique_ptr<ReplayStreamer> replays;
+
+    ClockOptions clock_opts;
+    TimerWheel clocks;
+    // Один срок на слот игры; какой именно, решает состояние партии.
+    // node.owner - дескриптор игры, для которой срок заведён
+    struct GameClock {
+        TimerNode node;
+        // Состояние, при котором заведён срок: state, выстрелы, кто за столом
+        uint8_t state = 0xFF;
+        uint16_t shots = 0;
+        uint8_t seated = 0;
+        // Пропущенные подряд ходы по местам; после MAX_MISSED_TURNS - поражение
+        uint8_t missed[2] = {0, 0};
+    };
+    GameClock game_clocks[MAX_GAMES];
+    // Идёт обработка истёкшего срока: ходы за игрока не сбрасывают missed
+    bool clock_firing;
+    // Стреляет за игрока, у которого вышло время хода
+    Bot stand_in;
+
+    Matchmaker matchmaker;
+    // Учётные записи и рейтинг; без --players только в памяти
+    std::unique_ptr<PlayerStore> players;
+
+    // Турниры живут только в памяти сервера: после тёплого перезапуска
+    // начатые партии доигрываются, но следующий раунд уже не назначается
+    struct TournamentRun {
+        std::unique_ptr<Tournament> bracket;
+        std::string organizer;
+    };
+    std::unordered_map<int, TournamentRun> tournaments;
+    int next_tournament_id;
+    // Партия турнира: id игры -> (турнир, номер пары в раунде)
+    std::unordered_map<int, std::pair<int, size_t>> tournament_games;
+    // Пары, которым ещё не досталось слота игры
+    std::deque<std::pair<int, size_t>> pending_matches;
+    bool launching;
     
     void init_shared_objects();
+    void init_sync_objects();
+    void adopt_shared_objects();
+    // Собирает свободные слоты и индекс логинов по содержимому сегмента
+    void rebuild_slot_index();
     void handle_message(const Message &m);
+    // Какую очередь разбирать: игровую, пока лобби не прождало
+    // GAME_STREAK_LIMIT записей подряд; под root->mutex, записи есть
+    RequestLane next_lane();
+    // Следующая запись очереди по кругу отправителей; под root->mutex, очередь не пуста
+    size_t next_queue_entry(RequestLane lane);
+    void record_latency(RequestLane lane, uint64_t wait_ns, uint64_t total_ns);
     void send_response_to(const char* login, const char* text);
     
     ClientSlot* find_or_create_client(const char* login);
     ClientSlot* find_client(const char* login);
+    // Возвращает слот клиента в свободные
+    void release_client(ClientSlot* c);
+    // Сегмент игрока, которого нет в этом сегменте; -1, если он не в сети
+    int remote_shard_of(const char* login);
     std::vector<std::string> list_clients();
     std::vector<std::string> list_available_games();
     
     int create_private_game(const std::string& creator, const std::string& target);
-    int create_public_game(const std::string& game_name, const std::string& creator);
+    int create_public_game(const std::string& game_name, const std::string& creator,
+                           RulesId rules = RULES_CLASSIC);
     Game* find_game_by_name(const std::string& game_name);
+    // Новая игра в свободном слоте; nullptr, если слотов нет
+    Game* new_game(const std::string& name, const std::string& creator, bool is_public,
+                   RulesId rules = RULES_CLASSIC);
     Game* get_game(int game_id);
-    void remove_game(int game_id);
+    // notify = false: игроки не получают GAME_REMOVED (игра им ещё не объявлена)
+    void remove_game(int game_id, bool notify = true);
+    void open_journal(Game* game);
+    // Заводит срок слота заново, если партия сменила состояние
+    void refresh_clock(int game_id);
+    void expire_clocks();
+    void clock_expired(int game_id);
+    // Команда от имени игрока по истечении срока; пишется и в трассу
+    void dispatch_for(const std::string& login, MsgType type, const std::string& payload);
+
+    int rating_of(const std::string& login) const;
+    void record_result(Game* game, const std::string& winner, const std::string& loser);
     
     void handle_setup_complete(const Message &m);
     void handle_place_ship(const Message &m);
@@ -40,6 +188,29 @@ private:
     void handle_get_opponent_board(const Message &m);
     void handle_surrender(const Message &m);
     void handle_game_status(const Message &m);
+    void handle_client_gone(const Message &m);
+    void handle_quick_match(const Message &m);
+    void handle_play_bot(const Message &m);
+    void handle_random_fleet(const Message &m);
+    void handle_spectate(const Message &m);
+    void handle_tournament(const Message &m);
+    void handle_leaderboard(const Message &m);
+    void handle_replay(const Message &m);
+    void handle_metrics(const Message &m);
+    bool add_bot(int game_id, const std::string& login, BotStrategy strategy);
+    void schedule_bot_turns(int game_id);
+    void step_bots();
+    // Выстрел бота с места seat; solved - вероятности из SolverWorker
+    void bot_shoot(Game* game, int game_id, size_t seat, const SolverResult* solved);
+    void apply_solved_shots();
+    bool player_available(const std::string& login);
+    int start_match(const std::string& a, const std::string& b);
+    void launch_pending_matches();
+    void advance_tournament(int tournament_id);
+    void record_match(int tournament_id, size_t match, const std::string& winner);
+    void match_finished(int game_id, const std::string& winner);
+    void finish_game(Game* game, int game_id);
+    void drop_client(ClientSlot* c);
     
     bool parse_ship_placement(const std::string& payload, uint8_t& size, 
                              uint8_t& x, uint8_t& y, bool& horizontal);
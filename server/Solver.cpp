@@ -0,0 +1,295 @@
+#include "Solver.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Состав флота: длина корабля -> количество
+constexpr int FLEET[5] = {0, 4, 3, 2, 1};
+constexpr int CELLS = Bitboard::STRIDE * BOARD_SIZE;
+// Предел памяти одного потока под запомненные подзадачи (~14 МБ)
+constexpr size_t MEMO_LIMIT = 1 << 14;
+constexpr uint32_t CLOCK_CHECK_MASK = 1023;
+
+struct Tally {
+    double total = 0;
+    double cells[CELLS] = {};
+
+    void add(const Tally& o) {
+        total += o.total;
+        for (int i = 0; i < CELLS; i++)
+            cells[i] += o.cells[i];
+    }
+
+    // Все расстановки из o дополнительно занимают клетки cover
+    void add(const Tally& o, Bitboard cover) {
+        add(o);
+        for (; !cover.empty(); cover.bits &= cover.bits - 1)
+            cells[cover.lowest()] += o.total;
+    }
+};
+
+struct Placement {
+    Bitboard cover;
+    // Сам корабль с соседними клетками: туда больше ничего не встанет
+    Bitboard blocked;
+};
+
+// Положения корабля длины size в free. Корабль не может касаться открытого
+// попадания, не накрывая его: накрывший это попадание корабль коснулся бы его.
+// Не может он и лежать целиком на попаданиях: такой корабль уже потоплен.
+void placements(Bitboard free, Bitboard open_hits, int size, std::vector<Placement>& out) {
+    for (int step : {1, Bitboard::STRIDE}) {
+        if (size == 1 && step != 1)
+            break;
+        for (Bitboard starts = ship_starts(free, size, step); !starts.empty();
+             starts.bits &= starts.bits - 1) {
+            Bitboard one(Bitboard::word(1) << starts.lowest());
+            Bitboard cover = ship_cover(one, size, step);
+            Bitboard blocked = neighbourhood(cover);
+            if (!(blocked & ~cover & open_hits).empty() || (cover & ~open_hits).empty())
+                continue;
+            out.push_back(Placement{cover, blocked});
+        }
+    }
+}
+
+struct MemoKey {
+    size_t ship;
+    Bitboard::word free;
+
+    bool operator==(const MemoKey& o) const { return ship == o.ship && free == o.free; }
+};
+
+struct MemoHash {
+    size_t operator()(const MemoKey& k) const {
+        uint64_t lo = static_cast<uint64_t>(k.free);
+        uint64_t hi = static_cast<uint64_t>(k.free >> 64);
+        uint64_t h = (lo ^ (hi * 0x9E3779B97F4A7C15ull) ^ k.ship) * 0xBF58476D1CE4E5B9ull;
+        return static_cast<size_t>(h ^ (h >> 31));
+    }
+};
+
+// Перебор одного потока со своей таблицей подзадач
+class Enumerator {
+  public:
+    Enumerator(const std::vector<int>& ships, Bitboard hits, Clock::time_point deadline,
+               std::atomic<bool>& aborted)
+        : ships(ships), hits(hits), deadline(deadline), aborted(aborted), nodes(0),
+          cells_left(ships.size() + 1, 0) {
+        for (size_t i = ships.size(); i-- > 0;)
+            cells_left[i] = cells_left[i + 1] + ships[i];
+        one.total = 1;
+    }
+
+    // Расстановки кораблей с i-го по последний на клетках free
+    const Tally* solve(size_t i, Bitboard free) {
+        Bitboard open_hits = hits & free;
+        if (i == ships.size())
+            return open_hits.empty() ? &one : &zero;
+        if (open_hits.count() > cells_left[i] || free.count() < cells_left[i])
+            return &zero;
+
+        if ((++nodes & CLOCK_CHECK_MASK) == 0 && Clock::now() > deadline)
+            aborted.store(true, std::memory_order_relaxed);
+        if (aborted.load(std::memory_order_relaxed))
+            return &zero;
+
+        MemoKey key{i, free.bits};
+        auto it = memo.find(key);
+        if (it != memo.end())
+            return it->second.get();
+        if (memo.size() >= MEMO_LIMIT) {
+            aborted.store(true, std::memory_order_relaxed);
+            return &zero;
+        }
+
+        std::unique_ptr<Tally> t(new Tally());
+        std::vector<Placement> ps;
+        placements(free, open_hits, ships[i], ps);
+        for (const Placement& p : ps)
+            t->add(*solve(i + 1, free & ~p.blocked), p.cover);
+
+        Tally* res = t.get();
+        memo.emplace(key, std::move(t));
+        return res;
+    }
+
+  private:
+    const std::vector<int>& ships;
+    Bitboard hits;
+    Clock::time_point deadline;
+    std::atomic<bool>& aborted;
+    uint32_t nodes;
+    std::vector<int> cells_left;
+    Tally zero, one;
+    std::unordered_map<MemoKey, std::unique_ptr<Tally>, MemoHash> memo;
+};
+
+uint64_t splitmix64(uint64_t& state) {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+// Одна случайная расстановка: корабли по очереди на случайное допустимое место.
+// Расстановка выпадает с вероятностью 1 / (произведение числа мест на каждом
+// шаге), поэтому учитывается с этим произведением как весом - иначе
+// расстановки с меньшим выбором по пути перевешивали бы.
+// false, если зашли в тупик или остались ненакрытые попадания.
+bool sample(const std::vector<int>& ships, Bitboard free, Bitboard hits, uint64_t& rng,
+            std::vector<Placement>& ps, Tally& acc) {
+    Bitboard occupied;
+    double weight = 1;
+    for (int size : ships) {
+        ps.clear();
+        placements(free, hits & free, size, ps);
+        if (ps.empty())
+            return false;
+        weight *= static_cast<double>(ps.size());
+        const Placement& p = ps[splitmix64(rng) % ps.size()];
+        occupied |= p.cover;
+        free &= ~p.blocked;
+    }
+    if (!(hits & free).empty())
+        return false;
+
+    acc.total += weight;
+    for (; !occupied.empty(); occupied.bits &= occupied.bits - 1)
+        acc.cells[occupied.lowest()] += weight;
+    return true;
+}
+
+template <typename Fn>
+void run_threads(unsigned threads, Fn fn) {
+    if (threads <= 1) {
+        fn(0u);
+        return;
+    }
+    std::vector<std::thread> pool;
+    for (unsigned t = 0; t < threads; t++)
+        pool.emplace_back(fn, t);
+    for (auto& th : pool)
+        th.join();
+}
+
+} // namespace
+
+BoardKnowledge read_board(const CellState view[MAX_BOARD_SIZE][MAX_BOARD_SIZE]) {
+    BoardKnowledge k;
+    for (int y = 0; y < BOARD_SIZE; y++) {
+        for (int x = 0; x < BOARD_SIZE; x++) {
+            switch (view[y][x]) {
+            case CELL_MISS: k.misses.set(x, y); break;
+            case CELL_HIT: k.hits.set(x, y); break;
+            case CELL_SUNK: k.sunk.set(x, y); break;
+            default: k.unknown.set(x, y); break;
+            }
+        }
+    }
+
+    // Потопленные корабли не касаются друг друга, поэтому каждый отрезок
+    // из CELL_SUNK — ровно один корабль
+    for (int i = 0; i < 5; i++)
+        k.remaining[i] = FLEET[i];
+    for (int y = 0; y < BOARD_SIZE; y++) {
+        for (int x = 0; x < BOARD_SIZE; x++) {
+            if (!k.sunk.test(x, y) || (x > 0 && k.sunk.test(x - 1, y)) ||
+                (y > 0 && k.sunk.test(x, y - 1)))
+                continue;
+            int len = 1;
+            while (x + len < BOARD_SIZE && k.sunk.test(x + len, y))
+                len++;
+            if (len == 1) {
+                while (y + len < BOARD_SIZE && k.sunk.test(x, y + len))
+                    len++;
+            }
+            if (len <= 4 && k.remaining[len] > 0)
+                k.remaining[len]--;
+        }
+    }
+
+    // Вокруг потопленных кораблей и по диагонали от попаданий кораблей нет
+    k.free = Bitboard::valid() & ~(k.misses | neighbourhood(k.sunk) | diagonals(k.hits));
+    return k;
+}
+
+Solver::Solver(const SolverOptions& opts) : opts(opts) {
+    if (this->opts.threads == 0)
+        this->opts.threads = std::max(1u, std::thread::hardware_concurrency());
+}
+
+bool Solver::solve(const BoardKnowledge& board, uint64_t seed, SolverResult& out) const {
+    auto start = Clock::now();
+    auto budget = std::chrono::microseconds(opts.budget_us);
+
+    std::vector<int> ships;
+    for (int size = 4; size >= 1; size--) {
+        for (int i = 0; i < board.remaining[size]; i++)
+            ships.push_back(size);
+    }
+    if (ships.empty())
+        return false;
+
+    std::vector<Placement> first;
+    placements(board.free, board.hits, ships[0], first);
+
+    std::vector<Tally> tallies(opts.threads);
+    std::atomic<bool> aborted(false);
+    std::atomic<size_t> next(0);
+
+    run_threads(opts.threads, [&](unsigned t) {
+        Enumerator e(ships, board.hits, start + budget / 2, aborted);
+        for (size_t i; (i = next.fetch_add(1)) < first.size() && !aborted.load();) {
+            const Placement& p = first[i];
+            tallies[t].add(*e.solve(1, board.free & ~p.blocked), p.cover);
+        }
+    });
+
+    out.exact = !aborted.load();
+    // Выборки взвешены, поэтому их число считается отдельно от суммы весов
+    std::vector<double> accepted(opts.threads, 0);
+    if (!out.exact) {
+        run_threads(opts.threads, [&](unsigned t) {
+            Tally& acc = tallies[t];
+            acc = Tally();
+            uint64_t rng = seed ^ (0xD1B54A32D192ED03ull * (t + 1));
+            std::vector<Placement> ps;
+            for (uint32_t n = 0;; n++) {
+                if ((n & 15) == 0 && Clock::now() > start + budget)
+                    break;
+                accepted[t] += sample(ships, board.free, board.hits, rng, ps, acc);
+            }
+        });
+    }
+
+    Tally total;
+    for (const Tally& t : tallies)
+        total.add(t);
+
+    out.configurations = total.total;
+    if (!out.exact) {
+        out.configurations = 0;
+        for (double n : accepted)
+            out.configurations += n;
+    }
+    if (total.total == 0)
+        return false;
+
+    for (int y = 0; y < BOARD_SIZE; y++) {
+        for (int x = 0; x < BOARD_SIZE; x++) {
+            out.probability[y][x] =
+                board.unknown.test(x, y) ? total.cells[Bitboard::index(x, y)] / total.total : 0;
+        }
+    }
+    return true;
+}
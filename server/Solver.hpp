@@ -0,0 +1,52 @@
+#pragma once
+#include <cstdint>
+
+#include "../include/SharedTypes.hpp"
+#include "Bitboard.hpp"
+
+// Что известно о доске противника по её открытой части
+struct BoardKnowledge {
+    Bitboard unknown;
+    Bitboard misses;
+    // Попадания в ещё не потопленные корабли
+    Bitboard hits;
+    Bitboard sunk;
+    // Клетки, где ещё может стоять корабль (включая попадания)
+    Bitboard free;
+    // Длина корабля -> сколько таких ещё не потоплено
+    int remaining[5];
+};
+
+BoardKnowledge read_board(const CellState view[MAX_BOARD_SIZE][MAX_BOARD_SIZE]);
+
+struct SolverOptions {
+    // 0 = по числу ядер
+    unsigned threads = 0;
+    uint32_t budget_us = 20000;
+};
+
+struct SolverResult {
+    // true: полный перебор, false: оценка по случайной выборке расстановок
+    bool exact;
+    // Число расстановок (перебор) или принятых выборок
+    double configurations;
+    double probability[BOARD_SIZE][BOARD_SIZE];
+};
+
+// Перебирает все расстановки оставшихся кораблей, согласованные с открытой
+// частью доски, и считает для каждой клетки точную вероятность попадания.
+// Перебор идёт по кораблям от длинного к короткому; подзадача «корабли с i-го
+// на свободных клетках free» запоминается, поэтому одинаковые хвосты флота
+// считаются один раз. Положения первого корабля делятся между потоками.
+// Если за половину бюджета перебор не закончился, вероятности оцениваются
+// по случайным расстановкам до конца бюджета.
+class Solver {
+  public:
+    explicit Solver(const SolverOptions& opts = SolverOptions());
+
+    // false, если не нашлось ни одной согласованной расстановки
+    bool solve(const BoardKnowledge& board, uint64_t seed, SolverResult& out) const;
+
+  private:
+    SolverOptions opts;
+};
@@ -0,0 +1,67 @@
+#include "SolverWorker.hpp"
+#include "Trace.hpp"
+
+SolverWorker::SolverWorker(const SolverOptions& opts, std::function<void()> notify)
+    : solver(opts), notify(std::move(notify)), rng(monotonic_ns() | 1), queued(0),
+      has_done(false), stopping(false) {
+    worker = std::thread([this] { run(); });
+}
+
+SolverWorker::~SolverWorker() {
+    {
+        std::lock_guard<std::mutex> g(lock);
+        stopping = true;
+    }
+    cond.notify_one();
+    worker.join();
+}
+
+void SolverWorker::submit(const Job& job) {
+    {
+        std::lock_guard<std::mutex> g(lock);
+        jobs.push_back(job);
+        queued.fetch_add(1, std::memory_order_relaxed);
+    }
+    cond.notify_one();
+}
+
+void SolverWorker::collect(std::vector<Done>& out) {
+    std::lock_guard<std::mutex> g(lock);
+    out.insert(out.end(), done.begin(), done.end());
+    queued.fetch_sub(done.size(), std::memory_order_relaxed);
+    done.clear();
+    has_done.store(false, std::memory_order_release);
+}
+
+void SolverWorker::wait() {
+    std::unique_lock<std::mutex> g(lock);
+    done_cond.wait(g, [this] { return !done.empty() || queued.load() == 0; });
+}
+
+void SolverWorker::run() {
+    std::unique_lock<std::mutex> g(lock);
+    while (true) {
+        cond.wait(g, [this] { return stopping || !jobs.empty(); });
+        if (stopping)
+            break;
+        Done d;
+        d.job = jobs.front();
+        jobs.pop_front();
+        // xorshift64*: зерно выборки, если перебор не уложится в бюджет
+        rng ^= rng >> 12;
+        rng ^= rng << 25;
+        rng ^= rng >> 27;
+        uint64_t seed = rng * 0x2545F4914F6CDD1Dull;
+
+        g.unlock();
+        d.ok = solver.solve(d.job.board, seed, d.result);
+        g.lock();
+        done.push_back(d);
+        has_done.store(true, std::memory_order_release);
+        done_cond.notify_all();
+
+        g.unlock();
+        notify();
+        g.lock();
+    }
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Solver.hpp"
+
+// Перебор для ботов BOT_EXACT в отдельном потоке: бюджет решателя - десятки
+// миллисекунд, и в игровом цикле он задерживал бы сообщения всех игроков.
+// Цикл отдаёт сюда доску и забирает готовые вероятности, когда поток
+// сообщит о них через notify. Решатель один и живёт всё время работы.
+class SolverWorker {
+  public:
+    struct Job {
+        int game_id;
+        // Место бота в BotTable::seats
+        size_t seat;
+        BoardKnowledge board;
+    };
+
+    struct Done {
+        Job job;
+        // false - согласованных расстановок нет
+        bool ok;
+        SolverResult result;
+    };
+
+    // notify вызывается из потока решателя после каждого готового хода
+    SolverWorker(const SolverOptions& opts, std::function<void()> notify);
+    ~SolverWorker();
+
+    void submit(const Job& job);
+    // Забирает все готовые ходы
+    void collect(std::vector<Done>& out);
+    // Поставлено и ещё не забрано
+    size_t pending() const { return queued.load(std::memory_order_relaxed); }
+    bool ready() const { return has_done.load(std::memory_order_acquire); }
+    // Ждёт хотя бы одного готового хода, если что-то ещё считается
+    void wait();
+
+  private:
+    Solver solver;
+    std::function<void()> notify;
+    uint64_t rng;
+
+    std::mutex lock;
+    std::condition_variable cond;
+    std::condition_variable done_cond;
+    std::deque<Job> jobs;
+    std::vector<Done> done;
+    std::atomic<size_t> queued;
+    std::atomic<bool> has_done;
+    bool stopping;
+    std::thread worker;
+
+    void run();
+};
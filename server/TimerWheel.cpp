@@ -0,0 +1,146 @@
+#include "TimerWheel.hpp"
+
+namespace {
+
+constexpr uint64_t SLOT_MASK = TimerWheel::SLOTS - 1;
+
+// Сколько тиков охватывают уровни ниже level и сам level
+uint64_t level_span(int level) {
+    return uint64_t(1) << (TimerWheel::SLOT_BITS * (level + 1));
+}
+
+} // namespace
+
+TimerWheel::TimerWheel(uint64_t now_ns) : origin_ns(now_ns), now_tick(0), count(0) {
+    for (auto& level : slots) {
+        for (Slot& s : level)
+            s.head.prev = s.head.next = &s.head;
+    }
+}
+
+TimerWheel::~TimerWheel() {
+    // Узлы принадлежат владельцам: только отвязываем их
+    for (auto& level : slots) {
+        for (Slot& s : level) {
+            while (s.head.next != &s.head)
+                unlink(s.head.next);
+        }
+    }
+}
+
+uint64_t TimerWheel::tick_of(uint64_t ns) const {
+    return ns <= origin_ns ? 0 : (ns - origin_ns) / TICK_NS;
+}
+
+void TimerWheel::schedule(TimerNode* n, uint64_t deadline_ns) {
+    cancel(n);
+    // Округление вверх: таймер не срабатывает раньше срока
+    uint64_t tick = tick_of(deadline_ns + TICK_NS - 1);
+    n->deadline = tick > now_tick ? tick : now_tick + 1;
+    insert(n);
+    count++;
+}
+
+void TimerWheel::cancel(TimerNode* n) {
+    if (!n->armed())
+        return;
+    unlink(n);
+    count--;
+}
+
+void TimerWheel::insert(TimerNode* n) {
+    uint64_t delta = n->deadline > now_tick ? n->deadline - now_tick : 0;
+    int level = 0;
+    while (level < LEVELS - 1 && delta >= level_span(level))
+        level++;
+    // Срок дальше верхнего уровня: ждёт в самой дальней его ячейке
+    uint64_t at = delta < level_span(LEVELS - 1) ? n->deadline
+                                                 : now_tick + level_span(LEVELS - 1) - 1;
+
+    TimerNode* head = &slots[level][(at >> (SLOT_BITS * level)) & SLOT_MASK].head;
+    n->prev = head->prev;
+    n->next = head;
+    head->prev->next = n;
+    head->prev = n;
+}
+
+void TimerWheel::unlink(TimerNode* n) {
+    n->prev->next = n->next;
+    n->next->prev = n->prev;
+    n->prev = n->next = nullptr;
+}
+
+void TimerWheel::cascade(int level) {
+    TimerNode* head = &slots[level][(now_tick >> (SLOT_BITS * level)) & SLOT_MASK].head;
+    TimerNode* n = head->next;
+    head->prev = head->next = head;
+    while (n != head) {
+        TimerNode* next = n->next;
+        n->prev = n->next = nullptr;
+        insert(n);
+        n = next;
+    }
+}
+
+void TimerWheel::advance(uint64_t now_ns, std::vector<TimerNode*>& fired) {
+    uint64_t target = tick_of(now_ns);
+    while (now_tick < target) {
+        // Пустые тики пропускаются целиком: колесо не крутится вхолостую
+        uint64_t next = count ? tick_of(next_wakeup_ns()) : NEVER;
+        if (next > target) {
+            now_tick = target;
+            break;
+        }
+        now_tick = next;
+
+        // Сначала спуск с верхних уровней, потом срабатывание нижней ячейки
+        for (int level = LEVELS - 1; level > 0; level--) {
+            if ((now_tick & ((uint64_t(1) << (SLOT_BITS * level)) - 1)) == 0)
+                cascade(level);
+        }
+
+        TimerNode* head = &slots[0][now_tick & SLOT_MASK].head;
+        TimerNode* n = head->next;
+        head->prev = head->next = head;
+        while (n != head) {
+            TimerNode* next_node = n->next;
+            n->prev = n->next = nullptr;
+            if (n->deadline > now_tick) {
+                insert(n);
+            } else {
+                count--;
+                fired.push_back(n);
+            }
+            n = next_node;
+        }
+    }
+}
+
+uint64_t TimerWheel::next_wakeup_ns() const {
+    if (count == 0)
+        return NEVER;
+
+    uint64_t best = NEVER;
+    for (uint64_t k = 1; k < SLOTS; k++) {
+        const TimerNode* head = &slots[0][(now_tick + k) & SLOT_MASK].head;
+        if (head->next != head) {
+            best = now_tick + k;
+            break;
+        }
+    }
+    // Ячейка верхнего уровня требует внимания, когда колесо доходит до её начала
+    for (int level = 1; level < LEVELS; level++) {
+        int shift = SLOT_BITS * level;
+        for (uint64_t k = 1; k <= SLOTS; k++) {
+            uint64_t at = ((now_tick >> shift) + k) << shift;
+            if (at >= best)
+                break;
+            const TimerNode* head = &slots[level][(at >> shift) & SLOT_MASK].head;
+            if (head->next != head) {
+                best = at;
+                break;
+            }
+        }
+    }
+    return best == NEVER ? NEVER : origin_ns + best * TICK_NS;
+}
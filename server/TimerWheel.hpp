@@ -0,0 +1,64 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Узел таймера хранится у владельца и вшивается в список ячейки колеса,
+// поэтому постановка и снятие - O(1) без выделения памяти.
+struct TimerNode {
+    TimerNode* prev = nullptr;
+    TimerNode* next = nullptr;
+    // Срок в тиках колеса
+    uint64_t deadline = 0;
+    // Кто завёл таймер (номер игры)
+    int owner = -1;
+
+    bool armed() const { return prev != nullptr; }
+};
+
+// Иерархическое колесо таймеров: LEVELS уровней по SLOTS ячеек. Таймер
+// ложится на уровень по тому, насколько он далеко, и спускается ниже, когда
+// колесо доходит до его ячейки. Тик - TICK_NS, дальность - SLOTS^LEVELS тиков
+// (около 46 часов); более дальние сроки ждут на верхнем уровне.
+class TimerWheel {
+  public:
+    static constexpr uint64_t TICK_NS = 10000000;
+    static constexpr int SLOT_BITS = 6;
+    static constexpr size_t SLOTS = size_t(1) << SLOT_BITS;
+    static constexpr int LEVELS = 4;
+    static constexpr uint64_t NEVER = UINT64_MAX;
+
+    explicit TimerWheel(uint64_t now_ns);
+    ~TimerWheel();
+
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    // Заведённый таймер переставляется на новый срок
+    void schedule(TimerNode* n, uint64_t deadline_ns);
+    void cancel(TimerNode* n);
+    // Доводит колесо до now_ns; сработавшие таймеры снимаются и попадают в fired
+    void advance(uint64_t now_ns, std::vector<TimerNode*>& fired);
+    // Когда колесу в следующий раз нужно внимание (срабатывание или спуск
+    // уровня); NEVER, если таймеров нет
+    uint64_t next_wakeup_ns() const;
+    size_t size() const { return count; }
+
+  private:
+    // Голова кольцевого списка ячейки
+    struct Slot {
+        TimerNode head;
+    };
+
+    uint64_t origin_ns;
+    // Последний обработанный тик
+    uint64_t now_tick;
+    size_t count;
+    Slot slots[LEVELS][SLOTS];
+
+    uint64_t tick_of(uint64_t ns) const;
+    void insert(TimerNode* n);
+    static void unlink(TimerNode* n);
+    // Переносит таймеры ячейки уровня level на нижние уровни
+    void cascade(int level);
+};
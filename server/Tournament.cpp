@@ -0,0 +1,135 @@
+#include "Tournament.hpp"
+
+#include <algorithm>
+#include <sstream>
+
+namespace {
+
+constexpr size_t NO_PLAYER = static_cast<size_t>(-1);
+
+} // namespace
+
+const char* tournament_format_name(TournamentFormat f) {
+    switch (f) {
+    case TOURNAMENT_KNOCKOUT: return "knockout";
+    case TOURNAMENT_ROUND_ROBIN: return "roundrobin";
+    }
+    return "?";
+}
+
+bool parse_tournament_format(const std::string& name, TournamentFormat& out) {
+    for (TournamentFormat f : {TOURNAMENT_KNOCKOUT, TOURNAMENT_ROUND_ROBIN}) {
+        if (name == tournament_format_name(f)) {
+            out = f;
+            return true;
+        }
+    }
+    return false;
+}
+
+Tournament::Tournament(TournamentFormat format, const std::vector<std::string>& entrants)
+    : fmt(format), entrants(entrants), wins(entrants.size(), 0), eliminated(entrants.size(), 0),
+      round_no(0) {
+    for (size_t i = 0; i < entrants.size(); i++)
+        order.push_back(i);
+    if (fmt == TOURNAMENT_ROUND_ROBIN && order.size() % 2 == 1)
+        order.push_back(NO_PLAYER);
+}
+
+size_t Tournament::index_of(const std::string& name) const {
+    for (size_t i = 0; i < entrants.size(); i++) {
+        if (entrants[i] == name)
+            return i;
+    }
+    return NO_PLAYER;
+}
+
+bool Tournament::next_round() {
+    if (fmt == TOURNAMENT_KNOCKOUT) {
+        if (round_no > 0) {
+            order.clear();
+            for (const TournamentMatch& m : current)
+                order.push_back(index_of(m.winner));
+        }
+        if (order.size() <= 1)
+            return false;
+    } else {
+        if (round_no >= static_cast<int>(order.size()) - 1)
+            return false;
+        // Круговой метод: первый на месте, остальные сдвигаются на одну позицию
+        if (round_no > 0)
+            std::rotate(order.begin() + 1, order.end() - 1, order.end());
+    }
+
+    round_no++;
+    current.clear();
+    size_t n = order.size();
+    for (size_t i = 0; i < n / 2; i++) {
+        size_t a = order[fmt == TOURNAMENT_KNOCKOUT ? 2 * i : i];
+        size_t b = order[fmt == TOURNAMENT_KNOCKOUT ? 2 * i + 1 : n - 1 - i];
+        if (a == NO_PLAYER)
+            std::swap(a, b);
+
+        TournamentMatch m;
+        m.a = entrants[a];
+        if (b != NO_PLAYER) {
+            m.b = entrants[b];
+        } else {
+            m.winner = m.a;
+            m.done = true;
+        }
+        current.push_back(m);
+    }
+    // Нечётное число в олимпийской системе: последний проходит без игры
+    if (fmt == TOURNAMENT_KNOCKOUT && n % 2 == 1) {
+        TournamentMatch m;
+        m.a = m.winner = entrants[order[n - 1]];
+        m.done = true;
+        current.push_back(m);
+    }
+    return true;
+}
+
+void Tournament::record(size_t match, const std::string& winner) {
+    if (match >= current.size() || current[match].done)
+        return;
+
+    TournamentMatch& m = current[match];
+    // Результат без победителя (оба не явились): проходит первый в паре
+    m.winner = (winner == m.b) ? m.b : m.a;
+    m.done = true;
+
+    wins[index_of(m.winner)]++;
+    std::string loser = (m.winner == m.a) ? m.b : m.a;
+    if (fmt == TOURNAMENT_KNOCKOUT)
+        eliminated[index_of(loser)] = round_no;
+}
+
+bool Tournament::round_complete() const {
+    for (const TournamentMatch& m : current) {
+        if (!m.done)
+            return false;
+    }
+    return true;
+}
+
+std::string Tournament::standings() const {
+    // Олимпийская система: кто дольше продержался; круговая: по победам
+    auto key = [this](size_t i) {
+        int stage = (fmt == TOURNAMENT_KNOCKOUT) ? (eliminated[i] ? eliminated[i] : round_no + 1) : 0;
+        return std::make_pair(stage, wins[i]);
+    };
+    std::vector<size_t> idx(entrants.size());
+    for (size_t i = 0; i < idx.size(); i++)
+        idx[i] = i;
+    std::stable_sort(idx.begin(), idx.end(), [&](size_t x, size_t y) { return key(x) > key(y); });
+
+    std::stringstream ss;
+    int place = 0;
+    for (size_t k = 0; k < idx.size(); k++) {
+        if (k == 0 || key(idx[k]) != key(idx[k - 1]))
+            place = static_cast<int>(k) + 1;
+        ss << place << ". " << entrants[idx[k]] << " - побед: " << wins[idx[k]] << "\n";
+    }
+    return ss.str();
+}
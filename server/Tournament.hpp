@@ -0,0 +1,57 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum TournamentFormat : uint8_t {
+    // Олимпийская система: проигравший выбывает
+    TOURNAMENT_KNOCKOUT = 0,
+    // Круговая: каждый играет с каждым, раунд за раундом
+    TOURNAMENT_ROUND_ROBIN = 1
+};
+
+const char* tournament_format_name(TournamentFormat f);
+// false, если имя не распознано
+bool parse_tournament_format(const std::string& name, TournamentFormat& out);
+
+struct TournamentMatch {
+    std::string a;
+    // Пусто: у a свободный круг
+    std::string b;
+    std::string winner;
+    bool done = false;
+};
+
+// Сетка турнира без привязки к серверу: раунд за раундом выдаёт пары и
+// принимает результаты. Все партии раунда независимы и идут одновременно.
+class Tournament {
+  public:
+    Tournament(TournamentFormat format, const std::vector<std::string>& entrants);
+
+    // Составляет пары следующего раунда; false, если турнир окончен.
+    // Партии со свободным кругом сразу засчитываются.
+    bool next_round();
+    void record(size_t match, const std::string& winner);
+    bool round_complete() const;
+
+    const std::vector<TournamentMatch>& matches() const { return current; }
+    TournamentFormat format() const { return fmt; }
+    int round() const { return round_no; }
+    size_t size() const { return entrants.size(); }
+    // Итоговая таблица: место, игрок, победы
+    std::string standings() const;
+
+  private:
+    TournamentFormat fmt;
+    std::vector<std::string> entrants;
+    std::vector<int> wins;
+    // Раунд, в котором игрок выбыл (олимпийская система); 0 = ещё играет
+    std::vector<int> eliminated;
+    // Олимпийская система: оставшиеся в порядке сетки.
+    // Круговая: участники по кругу (с пустым местом при нечётном числе)
+    std::vector<size_t> order;
+    std::vector<TournamentMatch> current;
+    int round_no;
+
+    size_t index_of(const std::string& name) const;
+};
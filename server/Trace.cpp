@@ -0,0 +1,109 @@
+#include "Trace.hpp"
+
+#include <cstring>
+#include <ctime>
+#include <stdexcept>
+
+namespace {
+
+struct __attribute__((packed)) RecordHeader {
+    uint64_t t_ns;
+    uint8_t type;
+    uint8_t from_len;
+    uint8_t to_len;
+    uint16_t payload_len;
+};
+
+size_t field_len(const char* s, size_t max) {
+    return strnlen(s, max - 1);
+}
+
+} // namespace
+
+uint64_t monotonic_ns() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + ts.tv_nsec;
+}
+
+TraceWriter::TraceWriter(const std::string& path)
+    : file(nullptr), start_ns(monotonic_ns()), records(0), dirty(false) {
+    file = std::fopen(path.c_str(), "wb");
+    if (!file)
+        throw std::runtime_error("cannot open trace file " + path);
+
+    std::setvbuf(file, nullptr, _IOFBF, 1 << 16);
+
+    TraceHeader hdr{TRACE_MAGIC, TRACE_VERSION};
+    std::fwrite(&hdr, sizeof(hdr), 1, file);
+}
+
+TraceWriter::~TraceWriter() {
+    if (file) {
+        std::fflush(file);
+        std::fclose(file);
+    }
+}
+
+void TraceWriter::record(const Message& m) {
+    RecordHeader rh;
+    rh.t_ns = monotonic_ns() - start_ns;
+    rh.type = m.type;
+    rh.from_len = static_cast<uint8_t>(field_len(m.from, LOGIN_MAX));
+    rh.to_len = static_cast<uint8_t>(field_len(m.to, LOGIN_MAX));
+    rh.payload_len = static_cast<uint16_t>(field_len(m.payload, CMD_MAX));
+
+    std::fwrite(&rh, sizeof(rh), 1, file);
+    std::fwrite(m.from, 1, rh.from_len, file);
+    std::fwrite(m.to, 1, rh.to_len, file);
+    std::fwrite(m.payload, 1, rh.payload_len, file);
+
+    records++;
+    dirty = true;
+}
+
+void TraceWriter::flush() {
+    if (dirty) {
+        std::fflush(file);
+        dirty = false;
+    }
+}
+
+TraceReader::TraceReader(const std::string& path) : file(nullptr) {
+    file = std::fopen(path.c_str(), "rb");
+    if (!file)
+        throw std::runtime_error("cannot open trace file " + path);
+
+    TraceHeader hdr;
+    if (std::fread(&hdr, sizeof(hdr), 1, file) != 1 || hdr.magic != TRACE_MAGIC ||
+        hdr.version != TRACE_VERSION) {
+        std::fclose(file);
+        throw std::runtime_error("bad trace file " + path);
+    }
+}
+
+TraceReader::~TraceReader() {
+    if (file)
+        std::fclose(file);
+}
+
+bool TraceReader::next(TraceEntry& entry) {
+    RecordHeader rh;
+    if (std::fread(&rh, sizeof(rh), 1, file) != 1)
+        return false;
+
+    if (rh.from_len >= LOGIN_MAX || rh.to_len >= LOGIN_MAX || rh.payload_len >= CMD_MAX)
+        throw std::runtime_error("corrupted trace record");
+
+    std::memset(&entry.msg, 0, sizeof(entry.msg));
+    entry.t_ns = rh.t_ns;
+    entry.msg.state = MSG_READY;
+    entry.msg.type = rh.type;
+
+    if (std::fread(entry.msg.from, 1, rh.from_len, file) != rh.from_len ||
+        std::fread(entry.msg.to, 1, rh.to_len, file) != rh.to_len ||
+        std::fread(entry.msg.payload, 1, rh.payload_len, file) != rh.payload_len) {
+        throw std::runtime_error("truncated trace record");
+    }
+    return true;
+}
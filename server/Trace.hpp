@@ -0,0 +1,51 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+#include "../include/SharedTypes.hpp"
+
+// Трасса сообщений: заголовок TraceHeader, затем записи переменной длины
+// (время от начала записи, тип, длины строк и сами строки без хвостовых нулей).
+constexpr uint32_t TRACE_MAGIC = 0x52545342; // "BSTR"
+constexpr uint32_t TRACE_VERSION = 1;
+
+struct TraceHeader {
+    uint32_t magic;
+    uint32_t version;
+};
+
+struct TraceEntry {
+    uint64_t t_ns;
+    Message msg;
+};
+
+class TraceWriter {
+  public:
+    explicit TraceWriter(const std::string& path);
+    ~TraceWriter();
+
+    void record(const Message& m);
+    void flush();
+    bool pending() const { return dirty; }
+    uint64_t count() const { return records; }
+
+  private:
+    FILE* file;
+    uint64_t start_ns;
+    uint64_t records;
+    bool dirty;
+};
+
+class TraceReader {
+  public:
+    explicit TraceReader(const std::string& path);
+    ~TraceReader();
+
+    bool next(TraceEntry& entry);
+
+  private:
+    FILE* file;
+};
+
+uint64_t monotonic_ns();
@@ -0,0 +1,134 @@
+#include "FleetGenerator.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+
+// Скорость генератора флотов: сколько расстановок в секунду выдаёт один
+// генератор и сколько попыток уходит на каждую. Заодно каждая выданная
+// расстановка проверяется независимо от генератора: корабли внутри поля,
+// не пересекаются и, если правила запрещают, не касаются.
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double seconds_since(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+template <class Rules>
+bool fleet_is_valid(const RulesFleet<Rules>& fleet) {
+    int owner[Rules::HEIGHT][Rules::WIDTH];
+    for (auto& row : owner) {
+        for (int& c : row)
+            c = -1;
+    }
+    int per_size[MAX_SHIP_SIZE + 1] = {};
+    for (int i = 0; i < fleet_ship_count<Rules>(); i++) {
+        const FleetShip& s = fleet.ships[i];
+        if (s.size < 1 || s.size > MAX_SHIP_SIZE)
+            return false;
+        per_size[s.size]++;
+        for (int k = 0; k < s.size; k++) {
+            int x = s.x + (s.horizontal ? k : 0);
+            int y = s.y + (s.horizontal ? 0 : k);
+            if (x >= Rules::WIDTH || y >= Rules::HEIGHT || owner[y][x] >= 0)
+                return false;
+            owner[y][x] = i;
+        }
+    }
+    for (int size = 1; size <= MAX_SHIP_SIZE; size++) {
+        if (per_size[size] != Rules::FLEET[size])
+            return false;
+    }
+    if (Rules::SHIPS_MAY_TOUCH)
+        return true;
+    // Соседние по стороне или углу клетки разных кораблей
+    for (int y = 0; y < Rules::HEIGHT; y++) {
+        for (int x = 0; x < Rules::WIDTH; x++) {
+            if (owner[y][x] < 0)
+                continue;
+            for (int dy = 0; dy <= 1; dy++) {
+                for (int dx = -1; dx <= 1; dx++) {
+                    int nx = x + dx;
+                    int ny = y + dy;
+                    if ((dy == 0 && dx <= 0) || nx < 0 || nx >= Rules::WIDTH ||
+                        ny >= Rules::HEIGHT)
+                        continue;
+                    if (owner[ny][nx] >= 0 && owner[ny][nx] != owner[y][x])
+                        return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+template <class Rules>
+int run(long fleets, uint64_t seed) {
+    // Первый генератор строит общие таблицы
+    Clock::time_point start = Clock::now();
+    FleetGenerator gen(seed);
+    double setup = seconds_since(start);
+
+    long invalid = 0;
+    double busy = 0;
+    // Проверка идёт вне замера, пачками, чтобы не мерить и её
+    constexpr long BATCH = 4096;
+    static RulesFleet<Rules> batch[BATCH];
+    for (long done = 0; done < fleets;) {
+        long n = std::min(BATCH, fleets - done);
+        start = Clock::now();
+        for (long i = 0; i < n; i++)
+            gen.generate(batch[i]);
+        busy += seconds_since(start);
+        for (long i = 0; i < n; i++)
+            invalid += !fleet_is_valid(batch[i]);
+        done += n;
+    }
+
+    std::cout << "=== FLEET BENCH: " << fleets << " " << rules_info(Rules::ID).name
+              << " fleets ===\n"
+              << std::fixed << std::setprecision(1) << "tables:     " << setup * 1000 << " ms\n"
+              << std::setprecision(0) << "throughput: " << fleets / busy << " fleets/s\n"
+              << std::setprecision(2) << "attempts:   "
+              << static_cast<double>(gen.attempts()) / fleets << " per fleet\n"
+              << "invalid:    " << invalid << "\n"
+              << "sample:     " << format_fleet(batch[0].ships, fleet_ship_count<Rules>())
+              << std::endl;
+    return invalid ? 1 : 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    long fleets = 1000000;
+    uint64_t seed = 1;
+    RulesId rules = RULES_CLASSIC;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--fleets") == 0 && i + 1 < argc) {
+            fleets = std::atol(argv[++i]);
+        } else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--rules") == 0 && i + 1 < argc &&
+                   parse_rules(argv[i + 1], rules)) {
+            i++;
+        } else {
+            fleets = 0;
+            break;
+        }
+    }
+    if (fleets <= 0) {
+        std::cerr << "Usage: " << argv[0] << " [--fleets N] [--seed S] [--rules classic|large]"
+                  << std::endl;
+        return 1;
+    }
+
+    if (rules == RULES_LARGE)
+        return run<LargeRules>(fleets, seed);
+    return run<ClassicRules>(fleets, seed);
+}
@@ -0,0 +1,81 @@
+#include "Journal.hpp"
+
+#include <cstring>
+#include <ctime>
+#include <iostream>
+
+// Просмотр журналов партий: записи по порядку или только итог (--summary)
+
+namespace {
+
+void dump(const std::string& path, bool summary) {
+    JournalReader reader(path);
+    const JournalHeader& h = reader.header();
+
+    time_t start = static_cast<time_t>(h.start_unix_ns / 1000000000ull);
+    char when[32];
+    std::strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", std::localtime(&start));
+
+    std::string players[3];
+    int shots[3] = {0, 0, 0};
+    int hits[3] = {0, 0, 0};
+    JournalRecord last;
+    bool ended = false;
+    JournalRecord r;
+
+    if (!summary)
+        std::cout << "=== " << path << ": game " << h.game_id << " '" << h.game_name << "', "
+                  << when << (h.closed ? "" : " (live)") << " ===\n";
+    while (reader.next(r)) {
+        if (!summary)
+            std::cout << "  " << format_journal_record(r) << "\n";
+        if (r.seat > 2)
+            continue;
+        if (r.type == JR_PLAYER)
+            players[r.seat] = r.login;
+        if (r.type == JR_SHOT) {
+            shots[r.seat]++;
+            hits[r.seat] += r.result != SHOT_MISS;
+        }
+        if (r.type == JR_END) {
+            ended = true;
+            last = r;
+        }
+    }
+
+    std::cout << (summary ? path + ": " : "  ") << players[1] << " vs " << players[2] << ", shots "
+              << shots[1] << "/" << shots[2] << ", hits " << hits[1] << "/" << hits[2];
+    if (ended) {
+        // "+12.3ms end winner 1 sunk" -> "end winner 1 sunk"
+        std::string text = format_journal_record(last);
+        std::cout << ", " << text.substr(text.find(' ') + 1)
+                  << (last.seat ? " (" + players[last.seat] + ")" : "");
+    }
+    std::cout << "\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    bool summary = false;
+    int files = 0;
+    int rc = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--summary") == 0) {
+            summary = true;
+            continue;
+        }
+        files++;
+        try {
+            dump(argv[i], summary);
+        } catch (const std::exception& ex) {
+            std::cerr << argv[i] << ": " << ex.what() << std::endl;
+            rc = 1;
+        }
+    }
+    if (files == 0) {
+        std::cerr << "Usage: " << argv[0] << " [--summary] <journal.bsj>..." << std::endl;
+        return 1;
+    }
+    return rc;
+}
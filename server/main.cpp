@@ -1,13 +1,176 @@
 #include "Server.hpp"
+#include <sys/prctl.h>
+#include <sys/wait.h>
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <vector>
 
-int main() {
+namespace {
+
+volatile sig_atomic_t stop_requested = 0;
+
+void request_stop(int) { stop_requested = 1; }
+
+// Всё, что настраивается у сервера помимо сегмента
+struct ServerSetup {
+    std::string trace_path;
+    std::string journal_dir;
+    std::string players_path;
+    ClockOptions clocks;
+};
+
+bool parse_seconds(const char* s, int& out) {
+    char* end;
+    long v = std::strtol(s, &end, 10);
+    if (*end != '\0' || v < 0 || v > 7 * 24 * 3600)
+        return false;
+    out = static_cast<int>(v);
+    return true;
+}
+
+int run_server(const ShmOptions& opts, const ServerSetup& setup) {
     try {
-        Server s;
+        Server s(opts);
+        s.set_clocks(setup.clocks);
+        if (!setup.players_path.empty())
+            s.enable_players(setup.players_path);
+        if (!setup.trace_path.empty())
+            s.enable_trace(setup.trace_path);
+        if (!setup.journal_dir.empty())
+            s.enable_journal(setup.journal_dir);
         s.run();
     } catch (const std::exception &ex) {
         std::cerr << "Server error: " << ex.what() << std::endl;
         return 1;
     }
     return 0;
-}
\ No newline at end of file
+}
+
+// Каждый сегмент обслуживает свой процесс со своей очередью и мьютексом,
+// родитель держит каталог логинов и ждёт рабочих
+int run_shards(const ShmOptions& opts, const ServerSetup& setup, int shards) {
+    std::unique_ptr<ShardDirectory> directory;
+    try {
+        directory.reset(new ShardDirectory(true, opts, shards));
+    } catch (const std::exception &ex) {
+        std::cerr << "Server error: " << ex.what() << std::endl;
+        return 1;
+    }
+
+    // По SIGINT/SIGTERM родитель останавливает рабочих и удаляет каталог
+    struct sigaction sa;
+    std::memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = request_stop;
+    sigaction(SIGINT, &sa, nullptr);
+    sigaction(SIGTERM, &sa, nullptr);
+
+    pid_t parent = getpid();
+    std::vector<pid_t> workers;
+    for (int k = 0; k < shards; ++k) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            std::cerr << "Server error: fork failed" << std::endl;
+            stop_requested = 1;
+            break;
+        }
+        if (pid == 0) {
+            signal(SIGINT, SIG_DFL);
+            signal(SIGTERM, SIG_DFL);
+            // Рабочий не переживает родителя, даже убитого SIGKILL
+            prctl(PR_SET_PDEATHSIG, SIGTERM);
+            if (getppid() != parent)
+                _exit(1);
+            ShmOptions shard_opts = opts;
+            shard_opts.shard = k;
+            shard_opts.shard_count = shards;
+            std::cout << "Shard " << k << "/" << shards << ": "
+                      << shard_options(shard_opts).name << std::endl;
+            ServerSetup shard_setup = setup;
+            if (!setup.trace_path.empty())
+                shard_setup.trace_path += "." + std::to_string(k);
+            _exit(run_server(shard_opts, shard_setup));
+        }
+        workers.push_back(pid);
+    }
+
+    int failed = 0;
+    bool stopping = false;
+    while (true) {
+        if (stop_requested && !stopping) {
+            stopping = true;
+            for (pid_t pid : workers)
+                kill(pid, SIGTERM);
+        }
+        int status;
+        pid_t pid = wait(&status);
+        if (pid < 0) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        if (!stopping && (!WIFEXITED(status) || WEXITSTATUS(status) != 0))
+            failed++;
+    }
+    return failed ? 1 : 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    ServerSetup setup;
+    ShmOptions opts;
+    int shards = 1;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            setup.trace_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--journal") == 0 && i + 1 < argc) {
+            setup.journal_dir = argv[++i];
+        } else if (std::strcmp(argv[i], "--players") == 0 && i + 1 < argc) {
+            setup.players_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--turn-timeout") == 0 && i + 1 < argc &&
+                   parse_seconds(argv[i + 1], setup.clocks.turn_timeout)) {
+            ++i;
+        } else if (std::strcmp(argv[i], "--setup-timeout") == 0 && i + 1 < argc &&
+                   parse_seconds(argv[i + 1], setup.clocks.setup_timeout)) {
+            ++i;
+        } else if (std::strcmp(argv[i], "--idle-timeout") == 0 && i + 1 < argc &&
+                   parse_seconds(argv[i + 1], setup.clocks.idle_timeout)) {
+            ++i;
+        } else if (std::strcmp(argv[i], "--forfeit-on-timeout") == 0) {
+            setup.clocks.forfeit = true;
+        } else if (std::strcmp(argv[i], "--file") == 0 && i + 1 < argc) {
+            opts.file = argv[++i];
+        } else if (std::strcmp(argv[i], "--persist") == 0) {
+            opts.persist = true;
+        } else if (std::strcmp(argv[i], "--huge-pages") == 0) {
+            opts.huge_pages = true;
+        } else if (std::strcmp(argv[i], "--populate") == 0) {
+            opts.populate = true;
+        } else if (std::strcmp(argv[i], "--mlock") == 0) {
+            opts.lock_memory = true;
+        } else if (std::strcmp(argv[i], "--shards") == 0 && i + 1 < argc) {
+            shards = std::atoi(argv[++i]);
+        } else {
+            shards = 0;
+            break;
+        }
+    }
+    if (shards < 1 || shards > MAX_SHARDS) {
+        std::cerr << "Usage: " << argv[0]
+                  << " [--trace <file>] [--journal <dir>] [--players <file>]"
+                     " [--file <segment file>] [--persist]"
+                     " [--shards 1.."
+                  << MAX_SHARDS << "] [--huge-pages] [--populate] [--mlock]"
+                     " [--turn-timeout <s>] [--setup-timeout <s>] [--idle-timeout <s>]"
+                     " [--forfeit-on-timeout]"
+                  << std::endl;
+        return 1;
+    }
+
+    if (shards > 1)
+        return run_shards(opts, setup, shards);
+    return run_server(opts, setup);
+}
@@ -0,0 +1,56 @@
+#include "Server.hpp"
+#include <cstring>
+#include <iostream>
+#include <streambuf>
+#include <unistd.h>
+
+namespace {
+
+class NullBuffer : public std::streambuf {
+  protected:
+    int overflow(int c) override { return c; }
+};
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::string trace_path;
+    bool paced = false;
+    bool quiet = false;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--paced") == 0) {
+            paced = true;
+        } else if (std::strcmp(argv[i], "--quiet") == 0) {
+            quiet = true;
+        } else if (trace_path.empty() && argv[i][0] != '-') {
+            trace_path = argv[i];
+        } else {
+            trace_path.clear();
+            break;
+        }
+    }
+    if (trace_path.empty()) {
+        std::cerr << "Usage: " << argv[0] << " <trace> [--paced] [--quiet]" << std::endl;
+        return 1;
+    }
+
+    NullBuffer null_buf;
+    std::streambuf* saved = std::cout.rdbuf();
+    if (quiet)
+        std::cout.rdbuf(&null_buf);
+
+    int rc = 0;
+    try {
+        // Отдельный сегмент, чтобы не мешать работающему серверу
+        ShmOptions opts;
+        opts.name = "/battleship_replay_" + std::to_string(getpid());
+        Server s(opts);
+        s.replay(trace_path, paced);
+    } catch (const std::exception &ex) {
+        std::cerr << "Replay error: " << ex.what() << std::endl;
+        rc = 1;
+    }
+
+    std::cout.rdbuf(saved);
+    return rc;
+}
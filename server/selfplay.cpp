@@ -0,0 +1,233 @@
+#include "Bot.hpp"
+#include "Game.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Самоигра ботов без разделяемой памяти: каждая партия идёт через обычный
+// Game в собственном (обычном) SharedMemoryRoot потока.
+
+namespace {
+
+constexpr uint32_t CHUNK_GAMES = 256;
+constexpr int MAX_SHOTS = 2 * BOARD_SIZE * BOARD_SIZE;
+
+uint64_t splitmix64(uint64_t& state) {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+struct Chunk {
+    uint64_t first;
+    uint32_t count;
+};
+
+// Дек порции партий одного потока: владелец берёт с конца, остальные крадут с начала
+class WorkQueue {
+  public:
+    void push(Chunk c) {
+        std::lock_guard<std::mutex> g(lock);
+        chunks.push_back(c);
+    }
+
+    bool pop(Chunk& c) {
+        std::lock_guard<std::mutex> g(lock);
+        if (chunks.empty())
+            return false;
+        c = chunks.back();
+        chunks.pop_back();
+        return true;
+    }
+
+    bool steal(Chunk& c) {
+        std::lock_guard<std::mutex> g(lock);
+        if (chunks.empty())
+            return false;
+        c = chunks.front();
+        chunks.pop_front();
+        return true;
+    }
+
+  private:
+    std::mutex lock;
+    std::deque<Chunk> chunks;
+};
+
+struct Stats {
+    uint64_t games = 0;
+    uint64_t draws = 0;
+    uint64_t stolen = 0;
+    uint64_t wins[2] = {0, 0};
+    uint64_t winning_shots[2] = {0, 0};
+    uint64_t total_shots = 0;
+
+    void merge(const Stats& o) {
+        games += o.games;
+        draws += o.draws;
+        stolen += o.stolen;
+        total_shots += o.total_shots;
+        for (int i = 0; i < 2; i++) {
+            wins[i] += o.wins[i];
+            winning_shots[i] += o.winning_shots[i];
+        }
+    }
+};
+
+const char* const PLAYERS[2] = {"A", "B"};
+
+// Одна партия; первым ходит A в чётных партиях и B в нечётных
+void play_game(SharedMemoryRoot* root, uint64_t index, uint64_t& rng,
+               const BotStrategy strategies[2], const SolverOptions& solver_opts, Stats& stats) {
+    int first = static_cast<int>(index & 1);
+    // У потока свой сегмент и одна партия за раз: слот всегда нулевой
+    RulesGame<ClassicRules> game(0, "selfplay", PLAYERS[first], root);
+    game.join(PLAYERS[1 - first]);
+
+    Bot bots[2] = {Bot(splitmix64(rng), strategies[0], solver_opts),
+                   Bot(splitmix64(rng), strategies[1], solver_opts)};
+    for (int i = 0; i < 2; i++) {
+        bots[i].place_fleet(game, PLAYERS[i]);
+        game.set_setup_complete(PLAYERS[i]);
+    }
+
+    CellState view[MAX_BOARD_SIZE][MAX_BOARD_SIZE];
+    int shots[2] = {0, 0};
+    uint8_t x, y;
+    while (game.is_game_active() && shots[0] + shots[1] < MAX_SHOTS) {
+        int p = (game.get_current_turn() == PLAYERS[0]) ? 0 : 1;
+        game.get_opponent_cells(PLAYERS[p], view);
+        if (!bots[p].choose_shot(view, x, y))
+            break;
+        game.make_shot(PLAYERS[p], x, y);
+        shots[p]++;
+    }
+
+    stats.games++;
+    stats.total_shots += shots[0] + shots[1];
+    if (!game.is_game_finished()) {
+        stats.draws++;
+        return;
+    }
+    int w = (game.get_winner() == PLAYERS[0]) ? 0 : 1;
+    stats.wins[w]++;
+    stats.winning_shots[w] += shots[w];
+}
+
+void worker(size_t id, std::vector<std::unique_ptr<WorkQueue>>& queues, uint64_t seed,
+            const BotStrategy strategies[2], const SolverOptions& solver_opts, Stats& out) {
+    std::unique_ptr<SharedMemoryRoot> root(new SharedMemoryRoot());
+    uint64_t rng = seed ^ (0xD1B54A32D192ED03ull * (id + 1));
+    Stats stats;
+
+    Chunk c;
+    while (true) {
+        bool got = queues[id]->pop(c);
+        for (size_t k = 1; !got && k < queues.size(); k++) {
+            got = queues[(id + k) % queues.size()]->steal(c);
+            if (got)
+                stats.stolen++;
+        }
+        if (!got)
+            break;
+
+        for (uint32_t i = 0; i < c.count; i++)
+            play_game(root.get(), c.first + i, rng, strategies, solver_opts, stats);
+    }
+    out = stats;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    uint64_t games = 100000;
+    size_t threads = std::thread::hardware_concurrency();
+    uint64_t seed = static_cast<uint64_t>(
+        std::chrono::steady_clock::now().time_since_epoch().count());
+    BotStrategy strategies[2] = {BOT_DENSITY, BOT_HUNT_TARGET};
+    // Партии и так идут во всех потоках, поэтому точный решатель однопоточный
+    SolverOptions solver_opts;
+    solver_opts.threads = 1;
+
+    bool ok = true;
+    for (int i = 1; i < argc && ok; ++i) {
+        if (std::strcmp(argv[i], "--games") == 0 && i + 1 < argc) {
+            games = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = std::strtoul(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--budget") == 0 && i + 1 < argc) {
+            solver_opts.budget_us = std::strtoul(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--a") == 0 && i + 1 < argc) {
+            ok = parse_bot_strategy(argv[++i], strategies[0]);
+        } else if (std::strcmp(argv[i], "--b") == 0 && i + 1 < argc) {
+            ok = parse_bot_strategy(argv[++i], strategies[1]);
+        } else {
+            ok = false;
+        }
+    }
+    if (!ok || games == 0) {
+        std::cerr << "Usage: " << argv[0]
+                  << " [--games N] [--threads N] [--seed N] [--budget US] [--a STRATEGY]"
+                     " [--b STRATEGY]\n"
+                  << "  strategies: random, hunt, density, exact" << std::endl;
+        return 1;
+    }
+    if (threads == 0)
+        threads = 1;
+
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+    for (size_t t = 0; t < threads; t++)
+        queues.emplace_back(new WorkQueue());
+    size_t n = 0;
+    for (uint64_t first = 0; first < games; first += CHUNK_GAMES, n++) {
+        uint32_t count = static_cast<uint32_t>(std::min<uint64_t>(CHUNK_GAMES, games - first));
+        queues[n % threads]->push(Chunk{first, count});
+    }
+
+    // Отладочный вывод Game здесь не нужен, и потоки не ждут std::cout
+    Game::verbose = false;
+
+    std::vector<Stats> per_thread(threads);
+    std::vector<std::thread> pool;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t t = 0; t < threads; t++) {
+        pool.emplace_back(worker, t, std::ref(queues), seed, strategies, std::cref(solver_opts),
+                          std::ref(per_thread[t]));
+    }
+    for (auto& th : pool)
+        th.join();
+    double elapsed =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    Stats total;
+    for (const auto& s : per_thread)
+        total.merge(s);
+
+    std::cout << "=== SELFPLAY " << bot_strategy_name(strategies[0]) << " (A) vs "
+              << bot_strategy_name(strategies[1]) << " (B) ===\n"
+              << "games:      " << total.games << " on " << threads << " threads ("
+              << total.stolen << " chunks stolen), seed " << seed << "\n"
+              << "elapsed:    " << elapsed << " s\n"
+              << "throughput: " << (elapsed > 0 ? total.games / elapsed : 0) << " games/s, "
+              << (elapsed > 0 ? total.total_shots / elapsed : 0) << " shots/s\n";
+    for (int i = 0; i < 2; i++) {
+        std::cout << PLAYERS[i] << " " << bot_strategy_name(strategies[i]) << ": wins "
+                  << total.wins[i] << " (" << 100.0 * total.wins[i] / total.games
+                  << "%), avg shots to win "
+                  << (total.wins[i] ? double(total.winning_shots[i]) / total.wins[i] : 0) << "\n";
+    }
+    if (total.draws)
+        std::cout << "unfinished: " << total.draws << "\n";
+    return 0;
+}
@@ -0,0 +1,246 @@
+#include "../include/SharedMemory.hpp"
+#include "../include/GameView.hpp"
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+// Сравнение вариантов отображения сегмента: стоимость создания, задержка
+// первого запроса свежего клиента (его таблица страниц ещё пуста) и
+// промахи TLB при случайном обходе слотов игр и клиентов.
+
+namespace {
+
+constexpr const char* BENCH_NAME = "/battleship_shm_bench";
+constexpr size_t WALK_STEPS = 1 << 20;
+
+using Clock = std::chrono::steady_clock;
+
+double us_since(Clock::time_point start) {
+    return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+}
+
+// Счётчик промахов dTLB на чтение; -1, если PMU недоступен (виртуалка, paranoid)
+int open_dtlb_counter() {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                  (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+}
+
+struct Variant {
+    const char* label;
+    bool huge_pages;
+    bool populate;
+    bool lock_memory;
+};
+
+struct Result {
+    double setup_us = 0;
+    double first_us = 0;
+    double steady_us = 0;
+    double walk_ns = 0;
+    long long dtlb_misses = -1;
+    std::string report;
+};
+
+// Запрос клиента: сообщение в очередь, снимок своей игры, чтение своего слота
+double client_request(SharedMemoryRoot* root, int game, int client) {
+    auto start = Clock::now();
+    // Как клиент: запись заполняется прямо в очереди
+    uint64_t ticket;
+    Message* m = claim_root(root, LANE_GAME, NO_SENDER, false, 0, ticket);
+    if (m) {
+        std::memset(m->from, 0, LOGIN_MAX);
+        std::memset(m->to, 0, LOGIN_MAX);
+        std::memset(m->payload, 0, CMD_MAX);
+        std::strncpy(m->from, "bench", LOGIN_MAX - 1);
+        m->type = MSG_GAME_STATUS;
+        commit_root(root, LANE_GAME, m, ticket);
+    }
+    GameData g;
+    read_game_snapshot(root->games[game], g);
+    volatile bool has = root->clients[client].has_response;
+    (void)has;
+    double us = us_since(start);
+
+    // Очередь не разбирается сервером: освобождаем место сами
+    if (m) {
+        lock_root(root);
+        release_entry_root(root, LANE_GAME, static_cast<size_t>(m - root->lanes[LANE_GAME].entries));
+        pthread_mutex_unlock(&root->mutex);
+    }
+    return us;
+}
+
+double median(std::vector<double> v) {
+    std::sort(v.begin(), v.end());
+    return v.empty() ? 0 : v[v.size() / 2];
+}
+
+Result run_variant(const Variant& v, const ShmOptions& base, int rounds, uint64_t seed) {
+    ShmOptions opts = base;
+    opts.name = BENCH_NAME;
+    opts.huge_pages = v.huge_pages;
+    opts.populate = v.populate;
+    opts.lock_memory = v.lock_memory;
+    if (opts.file.empty())
+        shm_unlink(BENCH_NAME);
+    else
+        unlink(opts.file.c_str());
+
+    Result r;
+    auto start = Clock::now();
+    SharedMemory owner(true, opts);
+    r.setup_us = us_since(start);
+
+    SharedMemoryRoot* root = owner.root();
+    pthread_mutexattr_t mattr;
+    pthread_mutexattr_init(&mattr);
+    pthread_mutexattr_setpshared(&mattr, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_setrobust(&mattr, PTHREAD_MUTEX_ROBUST);
+    pthread_mutex_init(&root->mutex, &mattr);
+    pthread_mutexattr_destroy(&mattr);
+    pthread_condattr_t cattr;
+    pthread_condattr_init(&cattr);
+    pthread_condattr_setpshared(&cattr, PTHREAD_PROCESS_SHARED);
+    pthread_cond_init(&root->server_cond, &cattr);
+    pthread_cond_init(&root->queue_cond, &cattr);
+    pthread_condattr_destroy(&cattr);
+    for (SharedMemoryRoot::RequestQueue& q : root->lanes) {
+        q.head = q.tail = 0;
+        q.ready = 0;
+    }
+
+    // Каждый раунд — новый клиент со своим отображением и пустой таблицей страниц
+    std::vector<double> first, steady;
+    uint64_t rng = seed;
+    for (int i = 0; i < rounds; i++) {
+        rng = rng * 6364136223846793005ull + 1442695040888963407ull;
+        int game = static_cast<int>((rng >> 33) % MAX_GAMES);
+        int client = static_cast<int>((rng >> 17) % MAX_CLIENTS);
+
+        SharedMemory view(false, opts);
+        first.push_back(client_request(view.root(), game, client));
+        steady.push_back(client_request(view.root(), game, client));
+    }
+    r.first_us = median(first);
+    r.steady_us = median(steady);
+
+    // Случайный обход: слова seq игр и флаги слотов клиентов по всему сегменту
+    SharedMemory view(false, opts);
+    SharedMemoryRoot* vr = view.root();
+    std::vector<const volatile uint32_t*> targets;
+    for (size_t i = 0; i < MAX_GAMES; i++)
+        targets.push_back(&vr->games[i].seq);
+    for (size_t i = 0; i < MAX_CLIENTS; i++)
+        targets.push_back(reinterpret_cast<const volatile uint32_t*>(&vr->clients[i].notify_seq));
+    std::vector<uint32_t> order(WALK_STEPS);
+    for (size_t i = 0; i < WALK_STEPS; i++) {
+        rng = rng * 6364136223846793005ull + 1442695040888963407ull;
+        order[i] = static_cast<uint32_t>((rng >> 33) % targets.size());
+    }
+    for (auto* t : targets)
+        (void)*t;
+
+    int counter = open_dtlb_counter();
+    if (counter >= 0) {
+        ioctl(counter, PERF_EVENT_IOC_RESET, 0);
+        ioctl(counter, PERF_EVENT_IOC_ENABLE, 0);
+    }
+    uint32_t sink = 0;
+    start = Clock::now();
+    for (uint32_t idx : order)
+        sink += *targets[idx];
+    r.walk_ns = us_since(start) * 1000.0 / WALK_STEPS;
+    if (counter >= 0) {
+        ioctl(counter, PERF_EVENT_IOC_DISABLE, 0);
+        long long count = 0;
+        if (read(counter, &count, sizeof(count)) == sizeof(count))
+            r.dtlb_misses = count;
+        close(counter);
+    }
+    volatile uint32_t keep = sink;
+    (void)keep;
+
+    r.report = view.mapping_report();
+    return r;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int rounds = 200;
+    uint64_t seed = 1;
+    ShmOptions base;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--rounds") == 0 && i + 1 < argc) {
+            rounds = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--file") == 0 && i + 1 < argc) {
+            // Например, файл на hugetlbfs: /dev/hugepages/battleship_bench
+            base.file = argv[++i];
+        } else {
+            rounds = 0;
+            break;
+        }
+    }
+    if (rounds <= 0) {
+        std::cerr << "Usage: " << argv[0] << " [--rounds N] [--file <segment file>]" << std::endl;
+        return 1;
+    }
+
+    const Variant variants[] = {
+        {"base", false, false, false},
+        {"populate", false, true, false},
+        {"populate+mlock", false, true, true},
+        {"huge", true, false, false},
+        {"huge+populate+mlock", true, true, true},
+    };
+
+    std::cout << "=== SHM BENCH: " << sizeof(SharedMemoryRoot) << " byte root, " << rounds
+              << " fresh clients per variant, " << WALK_STEPS << " step walk ===\n"
+              << std::left << std::setw(22) << "variant" << std::right << std::setw(12)
+              << "setup us" << std::setw(12) << "first us" << std::setw(12) << "steady us"
+              << std::setw(12) << "walk ns" << std::setw(14) << "dTLB miss" << "\n";
+    std::vector<std::string> reports;
+    for (const Variant& v : variants) {
+        Result r;
+        try {
+            r = run_variant(v, base, rounds, seed);
+        } catch (const std::exception& ex) {
+            std::cout << std::left << std::setw(22) << v.label << "error: " << ex.what() << "\n";
+            continue;
+        }
+        std::cout << std::left << std::setw(22) << v.label << std::right << std::fixed
+                  << std::setprecision(1) << std::setw(12) << r.setup_us << std::setw(12)
+                  << r.first_us << std::setw(12) << r.steady_us << std::setprecision(2)
+                  << std::setw(12) << r.walk_ns << std::setw(14);
+        if (r.dtlb_misses >= 0)
+            std::cout << r.dtlb_misses;
+        else
+            std::cout << "n/a";
+        std::cout << "\n";
+        reports.push_back(std::string(v.label) + ": " + r.report);
+    }
+    std::cout << "\n";
+    for (const std::string& line : reports)
+        std::cout << line << "\n";
+    if (!base.file.empty())
+        unlink(base.file.c_str());
+    return 0;
+}
@@ -0,0 +1,399 @@
+#include "../include/SharedMemory.hpp"
+#include "../include/Events.hpp"
+#include "ClientReaper.hpp"
+
+#include <sys/wait.h>
+#include <signal.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <vector>
+
+// Нагрузка на общую очередь с убийством клиентов: процессы-клиенты шлют
+// запросы и ждут ответы, а драйвер раз в несколько миллисекунд убивает
+// случайного SIGKILL-ом — посреди резервирования под мьютексом, посреди
+// заполнения записи или в ожидании ответа — и запускает замену. Отдельный
+// процесс разбирает очередь так же, как сервер, и освобождает слоты по
+// MSG_CLIENT_GONE от ClientReaper. Драйвер проверяет, что мьютекс
+// восстанавливается, индексы и in_flight очередей сходятся с записями,
+// пропускная способность не падает до нуля, а слоты убитых освобождаются.
+
+namespace {
+
+constexpr const char* STRESS_NAME = "/battleship_shm_stress";
+constexpr int CHECK_INTERVAL_MS = 250;
+
+struct Stats {
+    std::atomic<uint64_t> processed;
+    std::atomic<uint64_t> registered;
+    std::atomic<uint64_t> reaped;
+    std::atomic<bool> stop;
+};
+
+using Clock = std::chrono::steady_clock;
+
+uint64_t next_rand(uint64_t& s) {
+    s = s * 6364136223846793005ull + 1442695040888963407ull;
+    return s >> 33;
+}
+
+void init_root(SharedMemoryRoot* root) {
+    pthread_mutexattr_t mattr;
+    pthread_mutexattr_init(&mattr);
+    pthread_mutexattr_setpshared(&mattr, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_setrobust(&mattr, PTHREAD_MUTEX_ROBUST);
+    pthread_mutex_init(&root->mutex, &mattr);
+    pthread_mutexattr_destroy(&mattr);
+    pthread_condattr_t cattr;
+    pthread_condattr_init(&cattr);
+    pthread_condattr_setpshared(&cattr, PTHREAD_PROCESS_SHARED);
+    pthread_cond_init(&root->server_cond, &cattr);
+    pthread_cond_init(&root->queue_cond, &cattr);
+    pthread_condattr_destroy(&cattr);
+    root->lock_recoveries = 0;
+    root->queue_waiters = 0;
+    for (SharedMemoryRoot::RequestQueue& q : root->lanes) {
+        q.head = q.tail = 0;
+        q.ready = 0;
+        for (Message& m : q.entries)
+            m.state = MSG_FREE;
+    }
+    for (ClientSlot& c : root->clients) {
+        c.used = false;
+        c.pid = 0;
+        c.has_response = false;
+        c.notify_seq = 0;
+        for (uint16_t& n : c.in_flight)
+            n = 0;
+    }
+}
+
+void reply(SharedMemoryRoot* root, size_t slot, pid_t pid, const char* text) {
+    ClientSlot& c = root->clients[slot];
+    if (!c.used || c.pid != pid)
+        return;
+    std::strncpy(c.response, text, RESP_MAX - 1);
+    c.has_response = true;
+    notify_client(&c);
+}
+
+// Разбор очереди, как в основном цикле сервера: только опубликованные записи
+void run_server(SharedMemoryRoot* root, Stats* stats) {
+    ClientReaper reaper(root);
+    reaper.start();
+    while (!stats->stop.load()) {
+        lock_root(root);
+        while (!requests_pending_root(root) && !stats->stop.load())
+            wait_root_for(root, &root->server_cond, 50 * 1000000ull);
+        if (stats->stop.load()) {
+            pthread_mutex_unlock(&root->mutex);
+            break;
+        }
+        RequestLane lane = root->lanes[LANE_GAME].ready > 0 ? LANE_GAME : LANE_LOBBY;
+        SharedMemoryRoot::RequestQueue& q = root->lanes[lane];
+        size_t index = q.head;
+        while (q.entries[index].state != MSG_READY)
+            index = (index + 1) % QUEUE_SIZE;
+        Message m = q.entries[index];
+        release_entry_root(root, lane, index);
+
+        if (m.type == MSG_REGISTER) {
+            pid_t pid = static_cast<pid_t>(std::atoi(m.payload));
+            size_t slot = MAX_CLIENTS;
+            for (size_t i = 0; i < MAX_CLIENTS && slot == MAX_CLIENTS; ++i) {
+                if (!root->clients[i].used)
+                    slot = i;
+            }
+            if (slot < MAX_CLIENTS) {
+                ClientSlot& c = root->clients[slot];
+                c.used = true;
+                c.pid = pid;
+                std::strncpy(c.login, m.from, LOGIN_MAX - 1);
+                c.has_response = false;
+                pthread_mutex_unlock(&root->mutex);
+                // Процесс уже мог умереть: тогда слот сразу свободен
+                if (!reaper.watch(slot, pid)) {
+                    lock_root(root);
+                    c.used = false;
+                    c.pid = 0;
+                } else {
+                    lock_root(root);
+                    stats->registered++;
+                }
+            }
+        } else if (m.type == MSG_CLIENT_GONE) {
+            pid_t pid = static_cast<pid_t>(std::atoi(m.payload));
+            if (m.sender >= 0 && root->clients[m.sender].pid == pid) {
+                root->clients[m.sender].used = false;
+                root->clients[m.sender].pid = 0;
+                reaper.unwatch(static_cast<size_t>(m.sender));
+                stats->reaped++;
+            }
+            reclaim_abandoned_root(root);
+        } else if (m.sender >= 0) {
+            reply(root, static_cast<size_t>(m.sender), m.claimer, "OK");
+        }
+        pthread_mutex_unlock(&root->mutex);
+        stats->processed++;
+    }
+}
+
+// Клиент: регистрация, затем запросы в обе очереди и ожидание ответов.
+// Паузы под мьютексом и между резервированием и публикацией делают
+// попадание SIGKILL в эти места частым
+void run_client(SharedMemoryRoot* root, uint64_t seed) {
+    pid_t pid = getpid();
+    Message reg;
+    std::memset(&reg, 0, sizeof(reg));
+    reg.type = MSG_REGISTER;
+    reg.sender = NO_SENDER;
+    std::snprintf(reg.from, LOGIN_MAX, "s%d", static_cast<int>(pid));
+    std::snprintf(reg.payload, CMD_MAX, "%d", static_cast<int>(pid));
+    while (!enqueue_root(root, reg))
+        usleep(1000);
+
+    int16_t slot = NO_SENDER;
+    while (slot == NO_SENDER) {
+        lock_root(root);
+        for (size_t i = 0; i < MAX_CLIENTS; ++i) {
+            if (root->clients[i].used && root->clients[i].pid == pid)
+                slot = static_cast<int16_t>(i);
+        }
+        pthread_mutex_unlock(&root->mutex);
+        if (slot == NO_SENDER)
+            usleep(500);
+    }
+    ClientSlot* me = &root->clients[slot];
+
+    for (;;) {
+        uint8_t type = next_rand(seed) % 2 ? MSG_GAME_STATUS : MSG_LIST;
+        RequestLane lane = lane_of(type);
+        uint64_t ticket;
+        Message* m = claim_root(root, lane, slot, true, 500 * 1000000ull, ticket);
+        if (!m)
+            continue;
+        std::strncpy(m->from, reg.from, LOGIN_MAX - 1);
+        std::memset(m->to, 0, LOGIN_MAX);
+        m->type = type;
+        if (next_rand(seed) % 8 == 0)
+            usleep(static_cast<useconds_t>(next_rand(seed) % 1000));
+        std::memset(m->payload, 0, CMD_MAX);
+        commit_root(root, lane, m, ticket);
+
+        for (int tries = 0; tries < 20; ++tries) {
+            lock_root(root);
+            uint32_t seen = notify_counter(me);
+            bool got = me->has_response;
+            me->has_response = false;
+            if (next_rand(seed) % 16 == 0)
+                usleep(static_cast<useconds_t>(next_rand(seed) % 500));
+            pthread_mutex_unlock(&root->mutex);
+            if (got)
+                break;
+            wait_notify(me, seen, 50);
+        }
+    }
+}
+
+// Индексы в диапазоне, вне окна записей нет, ready и in_flight сходятся
+// с записями окна. Под root->mutex
+bool check_queues(SharedMemoryRoot* root, std::string& error) {
+    uint32_t in_flight[MAX_CLIENTS][LANE_COUNT] = {};
+    for (size_t lane = 0; lane < LANE_COUNT; ++lane) {
+        const SharedMemoryRoot::RequestQueue& q = root->lanes[lane];
+        if (q.head >= QUEUE_SIZE || q.tail >= QUEUE_SIZE) {
+            error = "lane " + std::to_string(lane) + ": index out of range";
+            return false;
+        }
+        uint32_t ready = 0;
+        for (size_t i = 0; i < QUEUE_SIZE; ++i) {
+            const Message& m = q.entries[i];
+            bool in_window = q.head <= q.tail ? (i >= q.head && i < q.tail)
+                                              : (i >= q.head || i < q.tail);
+            if (!in_window && m.state != MSG_FREE) {
+                error = "lane " + std::to_string(lane) + ": entry " + std::to_string(i) +
+                        " busy outside [head, tail)";
+                return false;
+            }
+            if (!in_window || m.state == MSG_FREE)
+                continue;
+            ready += m.state == MSG_READY;
+            if (m.sender >= 0 && static_cast<size_t>(m.sender) < MAX_CLIENTS)
+                in_flight[m.sender][lane]++;
+        }
+        if (ready != q.ready) {
+            error = "lane " + std::to_string(lane) + ": ready " + std::to_string(q.ready) +
+                    ", entries " + std::to_string(ready);
+            return false;
+        }
+    }
+    for (size_t i = 0; i < MAX_CLIENTS; ++i) {
+        for (size_t lane = 0; lane < LANE_COUNT; ++lane) {
+            if (root->clients[i].in_flight[lane] != in_flight[i][lane]) {
+                error = "slot " + std::to_string(i) + " lane " + std::to_string(lane) +
+                        ": in_flight " + std::to_string(root->clients[i].in_flight[lane]) +
+                        ", entries " + std::to_string(in_flight[i][lane]);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+pid_t spawn(SharedMemoryRoot* root, uint64_t seed) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        run_client(root, seed);
+        _exit(0);
+    }
+    return pid;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int seconds = 10;
+    int clients = 16;
+    int kill_every_ms = 5;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+            seconds = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--clients") == 0 && i + 1 < argc) {
+            clients = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--kill-every-ms") == 0 && i + 1 < argc) {
+            kill_every_ms = std::atoi(argv[++i]);
+        } else {
+            seconds = 0;
+            break;
+        }
+    }
+    // Место под замену: слот убитого освобождается не мгновенно
+    if (seconds <= 0 || clients <= 0 || clients > static_cast<int>(MAX_CLIENTS) / 2 ||
+        kill_every_ms <= 0) {
+        std::cerr << "Usage: " << argv[0]
+                  << " [--seconds N] [--clients 1-" << MAX_CLIENTS / 2
+                  << "] [--kill-every-ms N]" << std::endl;
+        return 1;
+    }
+
+    ShmOptions opts;
+    opts.name = STRESS_NAME;
+    shm_unlink(opts.name.c_str());
+    SharedMemory owner(true, opts);
+    SharedMemoryRoot* root = owner.root();
+    init_root(root);
+
+    void* shared = mmap(nullptr, sizeof(Stats), PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (shared == MAP_FAILED) {
+        std::cerr << "mmap failed" << std::endl;
+        return 1;
+    }
+    Stats* stats = new (shared) Stats{};
+
+    // Драйвер остаётся однопоточным: потоки есть только у процесса-сервера
+    pid_t server = fork();
+    if (server == 0) {
+        run_server(root, stats);
+        _exit(0);
+    }
+
+    uint64_t rng = 1;
+    std::vector<pid_t> children;
+    for (int i = 0; i < clients; ++i)
+        children.push_back(spawn(root, next_rand(rng) << 20 | i));
+
+    std::cout << "=== SHM STRESS: " << clients << " clients, SIGKILL every " << kill_every_ms
+              << " ms for " << seconds << " s ===" << std::endl;
+
+    bool ok = true;
+    std::string error;
+    uint64_t kills = 0;
+    uint64_t last_processed = 0;
+    uint64_t min_per_check = ~0ull;
+    auto start = Clock::now();
+    auto next_check = start + std::chrono::milliseconds(CHECK_INTERVAL_MS);
+    auto end = start + std::chrono::seconds(seconds);
+    while (ok && Clock::now() < end) {
+        usleep(static_cast<useconds_t>(kill_every_ms) * 1000);
+        size_t victim = next_rand(rng) % children.size();
+        kill(children[victim], SIGKILL);
+        // Зомби ещё считается живым для kill(pid, 0): сразу подбираем
+        waitpid(children[victim], nullptr, 0);
+        kills++;
+        children[victim] = spawn(root, next_rand(rng) << 20 | kills);
+
+        if (Clock::now() < next_check)
+            continue;
+        next_check += std::chrono::milliseconds(CHECK_INTERVAL_MS);
+        lock_root(root);
+        ok = check_queues(root, error);
+        pthread_mutex_unlock(&root->mutex);
+        uint64_t processed = stats->processed.load();
+        min_per_check = std::min(min_per_check, processed - last_processed);
+        if (processed == last_processed) {
+            ok = false;
+            error = "no requests processed in " + std::to_string(CHECK_INTERVAL_MS) + " ms";
+        }
+        last_processed = processed;
+    }
+
+    for (pid_t pid : children) {
+        kill(pid, SIGKILL);
+        waitpid(pid, nullptr, 0);
+    }
+
+    // Все клиенты убиты: по их MSG_CLIENT_GONE слоты и очереди должны опустеть
+    size_t leaked_slots = MAX_CLIENTS;
+    bool drained = false;
+    auto drain_deadline = Clock::now() + std::chrono::seconds(3);
+    while (ok && Clock::now() < drain_deadline) {
+        lock_root(root);
+        ok = check_queues(root, error);
+        leaked_slots = 0;
+        for (const ClientSlot& c : root->clients)
+            leaked_slots += c.used;
+        drained = true;
+        for (const SharedMemoryRoot::RequestQueue& q : root->lanes)
+            drained = drained && q.head == q.tail;
+        pthread_mutex_unlock(&root->mutex);
+        if (leaked_slots == 0 && drained)
+            break;
+        usleep(10000);
+    }
+    if (ok && leaked_slots > 0) {
+        ok = false;
+        error = std::to_string(leaked_slots) + " client slots not reaped";
+    } else if (ok && !drained) {
+        ok = false;
+        error = "queue not drained after all clients died";
+    }
+
+    stats->stop = true;
+    lock_root(root);
+    pthread_cond_signal(&root->server_cond);
+    pthread_mutex_unlock(&root->mutex);
+    waitpid(server, nullptr, 0);
+
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    std::cout << "kills: " << kills << ", mutex recoveries: " << root->lock_recoveries
+              << ", registered: " << stats->registered.load()
+              << ", reaped: " << stats->reaped.load() << "\n"
+              << "requests: " << stats->processed.load() << " ("
+              << static_cast<uint64_t>(stats->processed.load() / elapsed) << "/s, min "
+              << (min_per_check == ~0ull ? 0 : min_per_check) << " per "
+              << CHECK_INTERVAL_MS << " ms)" << std::endl;
+    if (root->lock_recoveries == 0 && ok)
+        std::cout << "warning: no kill landed while the mutex was held" << std::endl;
+    if (!ok) {
+        std::cout << "FAILED: " << error << std::endl;
+        return 1;
+    }
+    std::cout << "OK" << std::endl;
+    return 0;
+}
@@ -0,0 +1,61 @@
+#include "Solver.hpp"
+
+#include <cmath>
+#include <iostream>
+
+// Доски, для которых ответ Solver известен заранее. Возвращает 1, если
+// перебор разошёлся хотя бы с одним ответом.
+
+namespace {
+
+int failures = 0;
+
+void expect(bool ok, const char* what) {
+    std::cout << (ok ? "ok:   " : "FAIL: ") << what << "\n";
+    failures += !ok;
+}
+
+// Открыты только перечисленные клетки, остальное - промахи
+BoardKnowledge open_board(Bitboard unknown, Bitboard hits, int ones, int twos) {
+    BoardKnowledge k{};
+    k.unknown = unknown;
+    k.hits = hits;
+    k.misses = Bitboard(Bitboard::valid().bits & ~(unknown.bits | hits.bits));
+    k.free = unknown | hits;
+    k.remaining[1] = ones;
+    k.remaining[2] = twos;
+    return k;
+}
+
+bool near(double a, double b) {
+    return std::fabs(a - b) < 1e-9;
+}
+
+} // namespace
+
+int main() {
+    Solver solver(SolverOptions{1, 1000000});
+    SolverResult r;
+
+    // Строка 0: ? X ?, в строке 5 две соседние ?; остались 1x1 и 1x2.
+    // Однопалубник на одиноком попадании был бы уже потоплен, поэтому
+    // двухпалубник накрывает попадание: 4 расстановки, везде 0.5
+    Bitboard unknown, hits;
+    unknown.set(0, 0);
+    unknown.set(2, 0);
+    unknown.set(4, 5);
+    unknown.set(5, 5);
+    hits.set(1, 0);
+    bool ok = solver.solve(open_board(unknown, hits, 1, 1), 1, r);
+    expect(ok && r.exact && near(r.configurations, 4), "hit covered by the 2-deck: 4 layouts");
+    expect(ok && near(r.probability[0][0], 0.5) && near(r.probability[0][2], 0.5) &&
+               near(r.probability[5][4], 0.5) && near(r.probability[5][5], 0.5),
+           "hit covered by the 2-deck: every open cell at 0.5");
+
+    // Один однопалубник и одно попадание: согласованных расстановок нет
+    Bitboard lone;
+    lone.set(0, 0);
+    expect(!solver.solve(open_board(lone, hits, 1, 0), 1, r), "lone hit is not a 1-deck");
+
+    return failures ? 1 : 0;
+}